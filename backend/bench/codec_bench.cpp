@@ -0,0 +1,165 @@
+/**
+ * @file codec_bench.cpp
+ * @brief Microbenchmarks for message encoding and decoding
+ *
+ * Compares the DOM-free JsonWriter fast path in MessageCodec against the
+ * nlohmann json-tree + dump() path it replaced, for the hot-path shapes,
+ * and the streaming MessageDecoder against parse-to-DOM for input.
+ *
+ * Run:
+ *   ./collabboard_bench --benchmark_filter=Encode
+ *   ./collabboard_bench --benchmark_filter=Decode
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "protocol/message_codec.hpp"
+#include "protocol/message_decoder.hpp"
+
+using namespace collabboard;
+
+namespace {
+
+std::vector<Point> makePoints(size_t count) {
+    std::vector<Point> points;
+    points.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        points.emplace_back(100.5f + static_cast<float>(i) * 1.37f,
+                            240.25f + static_cast<float>(i) * 0.83f);
+    }
+    return points;
+}
+
+/**
+ * The pre-JsonWriter encoding: build a json tree, wrap it in the envelope,
+ * then dump().
+ */
+std::string dumpMessage(MessageType type, uint64_t seq, const json& data) {
+    return MessageCodec::createMessage(type, seq, data).dump();
+}
+
+std::string dumpCursorMove(const std::string& oderId, float x, float y, uint64_t seq) {
+    json data = {{"userId", oderId}, {"x", x}, {"y", y}};
+    return dumpMessage(MessageType::CursorMove, seq, data);
+}
+
+std::string dumpStrokeAdd(const std::string& strokeId, const std::string& oderId,
+                          const std::vector<Point>& points, uint64_t seq) {
+    json pointsArray = json::array();
+    for (const auto& pt : points) {
+        pointsArray.push_back({pt.x, pt.y});
+    }
+    json data = {{"strokeId", strokeId}, {"userId", oderId}, {"points", pointsArray}};
+    return dumpMessage(MessageType::StrokeAdd, seq, data);
+}
+
+} // namespace
+
+// =============================================================================
+// cursor_move
+// =============================================================================
+
+static void BM_EncodeCursorMove_Dump(benchmark::State& state) {
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dumpCursorMove("user-1234abcd", 812.5f, 377.25f, ++seq));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeCursorMove_Dump);
+
+static void BM_EncodeCursorMove_Writer(benchmark::State& state) {
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        std::string text = MessageCodec::writeMessage(MessageType::CursorMove, ++seq,
+            [](JsonWriter& w) {
+                w.raw(R"({"userId":)").string("user-1234abcd")
+                 .raw(R"(,"x":)").number(812.5f)
+                 .raw(R"(,"y":)").number(377.25f).raw('}');
+            });
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeCursorMove_Writer);
+
+// =============================================================================
+// stroke_add (text only, then the full frame including the binary encoding)
+// =============================================================================
+
+static void BM_EncodeStrokeAdd_Dump(benchmark::State& state) {
+    auto points = makePoints(static_cast<size_t>(state.range(0)));
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dumpStrokeAdd("stroke-1", "user-1", points, ++seq));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeStrokeAdd_Dump)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_EncodeStrokeAdd_Writer(benchmark::State& state) {
+    auto points = makePoints(static_cast<size_t>(state.range(0)));
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        std::string text = MessageCodec::writeMessage(MessageType::StrokeAdd, ++seq,
+            [&](JsonWriter& w) {
+                w.raw(R"({"points":)");
+                MessageCodec::writePoints(w, points);
+                w.raw(R"(,"strokeId":)").string("stroke-1")
+                 .raw(R"(,"userId":)").string("user-1").raw('}');
+            });
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeStrokeAdd_Writer)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_EncodeStrokeAdd_Frame(benchmark::State& state) {
+    auto points = makePoints(static_cast<size_t>(state.range(0)));
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MessageCodec::createStrokeAdd("stroke-1", "user-1", points, ++seq));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeStrokeAdd_Frame)->Arg(8)->Arg(64)->Arg(512);
+
+// =============================================================================
+// Incoming stroke_add (DOM parse + extract vs streaming decode)
+// =============================================================================
+
+static std::string clientStrokeAdd(size_t count) {
+    return dumpStrokeAdd("stroke-1", "user-1", makePoints(count), 7);
+}
+
+static void BM_DecodeStrokeAdd_Dom(benchmark::State& state) {
+    std::string raw = clientStrokeAdd(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        json msg = MessageCodec::parse(raw);
+        json data = MessageCodec::getData(msg);
+        if (MessageCodec::validateStrokeAdd(data)) {
+            std::string strokeId = data["strokeId"].get<std::string>();
+            std::vector<Point> points = MessageCodec::extractPoints(data);
+            benchmark::DoNotOptimize(strokeId);
+            benchmark::DoNotOptimize(points);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeStrokeAdd_Dom)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_DecodeStrokeAdd_Sax(benchmark::State& state) {
+    std::string raw = clientStrokeAdd(static_cast<size_t>(state.range(0)));
+    MessageDecoder decoder;
+    for (auto _ : state) {
+        if (decoder.decode(raw)) {
+            auto msg = decoder.strokeAdd();
+            benchmark::DoNotOptimize(msg);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeStrokeAdd_Sax)->Arg(8)->Arg(64)->Arg(512);
@@ -0,0 +1,469 @@
+/**
+ * @file loadgen.cpp
+ * @brief WebSocket load generator for collabboard_server
+ *
+ * Opens many Beast WebSocket clients spread over a number of rooms. Every
+ * client moves its cursor along a smooth, jittered path; a fraction of
+ * them also draw strokes the way a pen does (a burst of stroke_add
+ * batches of a few points, then a pause). Each stroke_add carries one
+ * marker point encoding its send time, so clients in the same room can
+ * measure end-to-end latency from sender through the server to receiver.
+ * The marker's x is negative, which no trace point is.
+ *
+ * Reports connected clients and messages per second every second, then
+ * totals and stroke latency percentiles at the end.
+ *
+ * Usage:
+ *   ./collabboard_loadgen [--host 127.0.0.1] [--port 8080] [--clients 1000]
+ *                         [--rooms 20] [--duration 30] [--threads 4]
+ *                         [--cursor-hz 20] [--pen-hz 60] [--drawers 0.2]
+ *                         [--ramp-ms 5000] [--deflate 0]
+ *
+ * --deflate 1 offers permessage-deflate, to measure compressed egress.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include "utils/metrics.hpp"
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+using collabboard::Counter;
+using collabboard::Gauge;
+using collabboard::Histogram;
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    size_t clients = 1000;
+    size_t rooms = 20;
+    int durationSeconds = 30;
+    int threads = 4;
+    double cursorHz = 20.0;      // Cursor moves per second per client
+    double penHz = 60.0;         // stroke_add batches per second while drawing
+    double drawers = 0.2;        // Fraction of clients that draw
+    int rampMs = 5000;           // Spread connects over this long
+    bool deflate = false;        // Offer permessage-deflate
+};
+
+struct LoadStats {
+    Gauge connected;
+    Counter sent;
+    Counter received;
+    Counter errors;
+    Counter skipped;             // Sends skipped while a client's queue was backed up
+    Histogram strokeLatencyUs;   // stroke_add sender -> receiver
+};
+
+const auto StartTime = std::chrono::steady_clock::now();
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - StartTime).count();
+}
+
+// Send time as a point both halves of which are exact in a float
+constexpr int64_t MarkerSplit = int64_t{1} << 20;
+
+void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+    out.append(buffer, static_cast<size_t>(n));
+}
+
+void appendMarker(std::string& out, int64_t us) {
+    out += "[-";
+    out += std::to_string(us / MarkerSplit + 1);
+    out += ',';
+    out += std::to_string(us % MarkerSplit);
+    out += ']';
+}
+
+/**
+ * @brief Count messages in a frame and record latency from any markers.
+ */
+void processFrame(std::string_view text, LoadStats& stats) {
+    constexpr std::string_view TypeKey = R"("type":)";
+    uint64_t messages = 0;
+    for (size_t at = text.find(TypeKey); at != std::string_view::npos;
+         at = text.find(TypeKey, at + TypeKey.size())) {
+        ++messages;
+    }
+    if (text.find(R"("type":"batch")") != std::string_view::npos && messages > 0) {
+        --messages;
+    }
+    stats.received.add(messages);
+
+    // Snapshots replay old strokes, markers included
+    if (text.find("stroke_add") == std::string_view::npos ||
+        text.find("room_state") != std::string_view::npos) {
+        return;
+    }
+
+    int64_t now = nowUs();
+    for (size_t at = text.find("[-"); at != std::string_view::npos; at = text.find("[-", at + 2)) {
+        const char* begin = text.data() + at + 2;
+        char* end = nullptr;
+        double high = std::strtod(begin, &end);
+        if (end == begin || *end != ',') continue;
+        double low = std::strtod(end + 1, nullptr);
+        int64_t sentUs = (static_cast<int64_t>(high) - 1) * MarkerSplit + static_cast<int64_t>(low);
+        stats.strokeLatencyUs.record(static_cast<uint64_t>(std::max<int64_t>(now - sentUs, 0)));
+    }
+}
+
+/**
+ * @brief One simulated user.
+ */
+class LoadClient : public std::enable_shared_from_this<LoadClient> {
+public:
+    LoadClient(net::io_context& ioc, const Options& options, LoadStats& stats,
+               const tcp::resolver::results_type& endpoints, size_t index)
+        : ws_(net::make_strand(ioc))
+        , timer_(ws_.get_executor())
+        , options_(options)
+        , stats_(stats)
+        , endpoints_(endpoints)
+        , index_(index)
+        , random_(static_cast<uint32_t>(index * 7919 + 17))
+        , drawer_(std::uniform_real_distribution<double>(0, 1)(random_) < options.drawers)
+    {
+        std::uniform_real_distribution<double> unit(0, 1);
+        phase_ = unit(random_) * 6.283;
+        centerX_ = 200 + unit(random_) * 1200;
+        centerY_ = 150 + unit(random_) * 600;
+        penX_ = centerX_;
+        penY_ = centerY_;
+    }
+
+    void start(std::chrono::milliseconds delay) {
+        timer_.expires_after(delay);
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (!ec) self->connect();
+        });
+    }
+
+    void stop() {
+        net::post(ws_.get_executor(), [self = shared_from_this()]() {
+            self->stopping_ = true;
+            self->timer_.cancel();
+            // A close counts as a write; wait for the one in flight
+            if (self->queue_.empty()) self->close();
+        });
+    }
+
+private:
+    void connect() {
+        if (options_.deflate) {
+            websocket::permessage_deflate pmd;
+            pmd.client_enable = true;
+            ws_.set_option(pmd);
+        }
+        beast::get_lowest_layer(ws_).async_connect(endpoints_,
+            [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&) {
+                if (ec) return self->fail();
+                beast::get_lowest_layer(self->ws_).socket().set_option(tcp::no_delay(true));
+                self->ws_.async_handshake(self->options_.host, "/",
+                    [self](beast::error_code ec) {
+                        if (ec) return self->fail();
+                        self->onOpen();
+                    });
+            });
+    }
+
+    void onOpen() {
+        open_ = true;
+        stats_.connected.add(1);
+        std::string join = R"({"type":"join_room","seq":0,"data":{"roomId":"loadgen-)" +
+                           std::to_string(index_ % options_.rooms) +
+                           R"(","userName":"bot-)" + std::to_string(index_) + R"("}})";
+        send(std::move(join));
+        doRead();
+        scheduleTick();
+    }
+
+    void doRead() {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, size_t) {
+            if (ec) return self->fail();
+            auto bytes = self->buffer_.data();
+            processFrame(std::string_view(static_cast<const char*>(bytes.data()), bytes.size()),
+                         self->stats_);
+            self->buffer_.consume(self->buffer_.size());
+            self->doRead();
+        });
+    }
+
+    // One tick per pen sample; the cursor moves every penHz / cursorHz ticks
+    void scheduleTick() {
+        if (stopping_) return;
+        timer_.expires_after(std::chrono::microseconds(
+            static_cast<int64_t>(1e6 / std::max(options_.penHz, 1.0))));
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (ec || self->stopping_) return;
+            self->tick();
+            self->scheduleTick();
+        });
+    }
+
+    void tick() {
+        ++ticks_;
+        double t = static_cast<double>(ticks_) / options_.penHz;
+
+        cursorCredit_ += options_.cursorHz / options_.penHz;
+        if (cursorCredit_ >= 1.0) {
+            cursorCredit_ -= 1.0;
+            std::normal_distribution<double> jitter(0, 1.5);
+            double x = centerX_ + 180 * std::sin(0.7 * t + phase_) + jitter(random_);
+            double y = centerY_ + 120 * std::sin(1.1 * t + 2 * phase_) + jitter(random_);
+            std::string msg = R"({"type":"cursor_move","data":{"x":)";
+            appendNumber(msg, std::max(x, 0.0));
+            msg += R"(,"y":)";
+            appendNumber(msg, std::max(y, 0.0));
+            msg += "}}";
+            send(std::move(msg));
+        }
+
+        if (drawer_) pen();
+    }
+
+    // Idle for a while, then a stroke of tens of batches of 2-4 points
+    void pen() {
+        if (penIdleTicks_ > 0) {
+            --penIdleTicks_;
+            return;
+        }
+        if (strokeBatchesLeft_ == 0) {
+            strokeId_ = "lg-" + std::to_string(index_) + "-" + std::to_string(++strokes_);
+            strokeBatchesLeft_ = std::uniform_int_distribution<int>(20, 80)(random_);
+            heading_ = std::uniform_real_distribution<double>(0, 6.283)(random_);
+            send(R"({"type":"stroke_start","data":{"strokeId":")" + strokeId_ +
+                 R"(","color":"#3357FF","width":2}})");
+            return;
+        }
+
+        std::normal_distribution<double> turn(0, 0.15);
+        int points = std::uniform_int_distribution<int>(2, 4)(random_);
+        std::string msg = R"({"type":"stroke_add","data":{"strokeId":")" + strokeId_ +
+                          R"(","points":[)";
+        for (int i = 0; i < points; ++i) {
+            heading_ += turn(random_);
+            penX_ = std::clamp(penX_ + 3 * std::cos(heading_), 0.0, 1920.0);
+            penY_ = std::clamp(penY_ + 3 * std::sin(heading_), 0.0, 1080.0);
+            msg += '[';
+            appendNumber(msg, penX_);
+            msg += ',';
+            appendNumber(msg, penY_);
+            msg += "],";
+        }
+        appendMarker(msg, nowUs());
+        msg += "]}}";
+        send(std::move(msg));
+
+        if (--strokeBatchesLeft_ == 0) {
+            send(R"({"type":"stroke_end","data":{"strokeId":")" + strokeId_ + R"("}})");
+            penIdleTicks_ = std::uniform_int_distribution<int>(
+                static_cast<int>(options_.penHz / 2), static_cast<int>(options_.penHz * 2))(random_);
+        }
+    }
+
+    void send(std::string message) {
+        if (!open_ || stopping_) return;
+        if (queue_.size() >= 256) {
+            stats_.skipped.add();
+            return;
+        }
+        queue_.push_back(std::move(message));
+        if (queue_.size() == 1) doWrite();
+    }
+
+    void doWrite() {
+        ws_.text(true);
+        ws_.async_write(net::buffer(queue_.front()),
+            [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) return self->fail();
+                self->stats_.sent.add();
+                self->queue_.pop_front();
+                if (!self->queue_.empty()) {
+                    self->doWrite();
+                } else if (self->stopping_) {
+                    self->close();
+                }
+            });
+    }
+
+    void close() {
+        if (!open_) return;
+        ws_.async_close(websocket::close_code::normal, [self = shared_from_this()](beast::error_code) {});
+    }
+
+    void fail() {
+        if (!stopping_) stats_.errors.add();
+        if (open_) {
+            open_ = false;
+            stats_.connected.add(-1);
+        }
+        stopping_ = true;
+        timer_.cancel();
+        queue_.clear();
+    }
+
+    websocket::stream<beast::tcp_stream> ws_;
+    net::steady_timer timer_;
+    beast::flat_buffer buffer_;
+    std::deque<std::string> queue_;
+
+    const Options& options_;
+    LoadStats& stats_;
+    tcp::resolver::results_type endpoints_;
+    size_t index_;
+    std::mt19937 random_;
+    bool drawer_;
+    bool open_ = false;
+    bool stopping_ = false;
+
+    uint64_t ticks_ = 0;
+    double cursorCredit_ = 0;
+    double phase_ = 0, centerX_ = 0, centerY_ = 0;
+
+    double penX_ = 0, penY_ = 0, heading_ = 0;
+    int penIdleTicks_ = 0;
+    int strokeBatchesLeft_ = 0;
+    uint64_t strokes_ = 0;
+    std::string strokeId_;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view name = argv[i];
+        std::string value = argv[i + 1];
+        try {
+            if (name == "--host") options.host = value;
+            else if (name == "--port") options.port = value;
+            else if (name == "--clients") options.clients = std::stoul(value);
+            else if (name == "--rooms") options.rooms = std::max<size_t>(std::stoul(value), 1);
+            else if (name == "--duration") options.durationSeconds = std::stoi(value);
+            else if (name == "--threads") options.threads = std::max(std::stoi(value), 1);
+            else if (name == "--cursor-hz") options.cursorHz = std::stod(value);
+            else if (name == "--pen-hz") options.penHz = std::max(std::stod(value), 1.0);
+            else if (name == "--drawers") options.drawers = std::stod(value);
+            else if (name == "--ramp-ms") options.rampMs = std::max(std::stoi(value), 0);
+            else if (name == "--deflate") options.deflate = std::stoi(value) != 0;
+            else {
+                std::cerr << "Unknown option " << name << std::endl;
+                return false;
+            }
+        } catch (...) {
+            std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+            return false;
+        }
+    }
+    return argc % 2 == 1;
+}
+
+double ms(uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--host H] [--port P] [--clients N] [--rooms M] [--duration S]"
+                     " [--threads T] [--cursor-hz HZ] [--pen-hz HZ] [--drawers F] [--ramp-ms MS]"
+                     " [--deflate 0|1]"
+                  << std::endl;
+        return 1;
+    }
+
+    net::io_context ioc{options.threads};
+    tcp::resolver resolver(ioc);
+    beast::error_code ec;
+    auto endpoints = resolver.resolve(options.host, options.port, ec);
+    if (ec) {
+        std::cerr << "Cannot resolve " << options.host << ":" << options.port
+                  << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    LoadStats stats;
+    std::vector<std::shared_ptr<LoadClient>> clients;
+    clients.reserve(options.clients);
+    for (size_t i = 0; i < options.clients; ++i) {
+        auto client = std::make_shared<LoadClient>(ioc, options, stats, endpoints, i);
+        client->start(std::chrono::milliseconds(
+            options.clients > 0 ? options.rampMs * static_cast<int64_t>(i) /
+                                  static_cast<int64_t>(options.clients) : 0));
+        clients.push_back(std::move(client));
+    }
+
+    auto work = net::make_work_guard(ioc);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; ++i) {
+        threads.emplace_back([&ioc]() { ioc.run(); });
+    }
+
+    std::cout << "Load: " << options.clients << " clients in " << options.rooms << " rooms, "
+              << options.durationSeconds << " s, " << options.cursorHz << " cursor Hz, "
+              << options.drawers * 100 << "% drawing at " << options.penHz << " Hz" << std::endl;
+
+    uint64_t lastSent = 0, lastReceived = 0;
+    for (int second = 1; second <= options.durationSeconds; ++second) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        uint64_t sent = stats.sent.value(), received = stats.received.value();
+        auto latency = stats.strokeLatencyUs.snapshot();
+        std::cout << std::setw(4) << second << "s  connected " << std::setw(6) << stats.connected.value()
+                  << "  sent/s " << std::setw(8) << sent - lastSent
+                  << "  recv/s " << std::setw(9) << received - lastReceived
+                  << "  stroke p50 " << ms(latency.quantile(0.5)) << " ms"
+                  << "  p99 " << ms(latency.quantile(0.99)) << " ms" << std::endl;
+        lastSent = sent;
+        lastReceived = received;
+    }
+
+    for (auto& client : clients) {
+        client->stop();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    work.reset();
+    ioc.stop();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto latency = stats.strokeLatencyUs.snapshot();
+    double seconds = std::max(options.durationSeconds, 1);
+    std::cout << "\nSent " << stats.sent.value() << " ("
+              << static_cast<double>(stats.sent.value()) / seconds << " msg/s), received "
+              << stats.received.value() << " ("
+              << static_cast<double>(stats.received.value()) / seconds << " msg/s)\n"
+              << "Errors " << stats.errors.value() << ", sends skipped " << stats.skipped.value() << "\n"
+              << "Stroke latency over " << latency.count << " samples: p50 "
+              << ms(latency.quantile(0.5)) << " ms, p99 " << ms(latency.quantile(0.99))
+              << " ms, p999 " << ms(latency.quantile(0.999)) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file room_bench.cpp
+ * @brief Microbenchmarks for room stroke storage
+ *
+ * Measures stroke_add handling (lookup, validation, append, encode) as
+ * the room fills towards MaxStrokesPerRoom, the cost of adding a
+ * stroke to a room that is already at its cap, and building the join
+ * snapshot while one stroke is being drawn.
+ *
+ * Run:
+ *   ./collabboard_bench --benchmark_filter=Room
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "services/board_service.hpp"
+
+using namespace collabboard;
+
+namespace {
+
+void noopSend(std::shared_ptr<WsSession>, const OutboundFrame&) {}
+
+/**
+ * Fill a room with completed strokes, leaving room for one more.
+ */
+void fillRoom(Room& room, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        Stroke stroke("fill-" + std::to_string(i), "user-1", "#000000", 2.0f);
+        stroke.addPoint(static_cast<float>(i), 0.0f);
+        stroke.finish();
+        room.addStroke(stroke);
+    }
+}
+
+} // namespace
+
+// stroke_add against the newest stroke in a room holding N strokes
+static void BM_RoomStrokeAdd(benchmark::State& state) {
+    Room room("bench-room");
+    BoardService board;
+    fillRoom(room, static_cast<size_t>(state.range(0)));
+    board.handleStrokeStart(room, "user-1", "active", "#FF0000", 2.0f, noopSend);
+
+    std::vector<Point> points = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+    const size_t batchesPerStroke = ProtocolConstants::MaxPointsPerStroke / points.size();
+    size_t batches = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(board.handleStrokeAdd(room, "user-1", "active", points, noopSend));
+        // Keep the stroke under its point cap
+        if (++batches == batchesPerStroke) {
+            room.withStroke("active", [](Stroke& stroke) -> std::optional<ErrorCode> {
+                stroke.points.clear();
+                return std::nullopt;
+            });
+            batches = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RoomStrokeAdd)->Arg(0)->Arg(100)->Arg(500)->Arg(999);
+
+// addStroke into a room at its cap (every call evicts the oldest stroke)
+static void BM_RoomAddStrokeAtCap(benchmark::State& state) {
+    Room room("bench-room");
+    fillRoom(room, ProtocolConstants::MaxStrokesPerRoom);
+
+    std::vector<Point> points(static_cast<size_t>(state.range(0)), Point(1.0f, 1.0f));
+    std::vector<std::string> ids;
+    for (int i = 0; i < 1024; ++i) {
+        ids.push_back("new-" + std::to_string(i));
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        Stroke stroke(ids[next++ % ids.size()], "user-1", "#000000", 2.0f);
+        stroke.points = points;
+        room.addStroke(stroke);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RoomAddStrokeAtCap)->Arg(16)->Arg(256);
+
+// Join snapshot of a full room while one stroke keeps growing: a full
+// re-encode of every stroke (0) vs. the room's incremental cache (1)
+static void BM_RoomSnapshot(benchmark::State& state) {
+    Room room("bench-room");
+    BoardService board;
+    for (size_t i = 0; i < ProtocolConstants::SnapshotStrokeLimit; ++i) {
+        Stroke stroke("fill-" + std::to_string(i), "user-1", "#000000", 2.0f);
+        for (int p = 0; p < 64; ++p) {
+            stroke.addPoint(static_cast<float>(p), static_cast<float>(i));
+        }
+        stroke.finish();
+        room.addStroke(stroke);
+    }
+    board.handleStrokeStart(room, "user-1", "active", "#FF0000", 2.0f, noopSend);
+
+    const bool cached = state.range(0) != 0;
+    std::vector<Point> points = {{1.0f, 2.0f}};
+    size_t added = 0;
+    for (auto _ : state) {
+        if (++added == ProtocolConstants::MaxPointsPerStroke) {
+            room.withStroke("active", [](Stroke& stroke) -> std::optional<ErrorCode> {
+                stroke.points.clear();
+                return std::nullopt;
+            });
+            added = 0;
+        }
+        board.handleStrokeAdd(room, "user-1", "active", points, noopSend);
+        if (cached) {
+            benchmark::DoNotOptimize(room.getSnapshotFrame(ProtocolConstants::SnapshotStrokeLimit));
+        } else {
+            benchmark::DoNotOptimize(MessageCodec::createRoomState(
+                room.getStrokesSnapshot(ProtocolConstants::SnapshotStrokeLimit),
+                room.currentSequence()));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RoomSnapshot)->Arg(0)->Arg(1);
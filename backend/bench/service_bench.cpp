@@ -0,0 +1,168 @@
+/**
+ * @file service_bench.cpp
+ * @brief Microbenchmarks for per-message service paths
+ *
+ * Measures stroke lookup by ID as the board grows, RateLimiter checks
+ * from one thread and from several (shard contention),
+ * BoardService::getSnapshot at several board sizes, both served from the
+ * room's cache and rebuilt after the board changed, and one stroke's
+ * start / add / end lifecycle through BoardService.
+ *
+ * Run:
+ *   ./collabboard_bench --benchmark_filter=Service
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "services/board_service.hpp"
+#include "utils/rate_limiter.hpp"
+
+using namespace collabboard;
+
+namespace {
+
+void fillBoard(Room& room, size_t strokes, size_t pointsPerStroke) {
+    for (size_t i = 0; i < strokes; ++i) {
+        Stroke stroke("stroke-" + std::to_string(i), "user-1", "#000000", 2.0f);
+        for (size_t p = 0; p < pointsPerStroke; ++p) {
+            stroke.addPoint(static_cast<float>(p), static_cast<float>(i));
+        }
+        stroke.finish();
+        room.addStroke(stroke);
+    }
+}
+
+std::vector<std::string> makeIds(const std::string& prefix, size_t count) {
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        ids.push_back(prefix + std::to_string(i));
+    }
+    return ids;
+}
+
+} // namespace
+
+// =============================================================================
+// Room::getStroke
+// =============================================================================
+
+// Copy out a stroke by ID from a board of N strokes, cycling through all
+static void BM_ServiceRoomGetStroke(benchmark::State& state) {
+    Room room("bench-room");
+    const size_t strokes = static_cast<size_t>(state.range(0));
+    fillBoard(room, strokes, 32);
+    auto ids = makeIds("stroke-", strokes);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(room.getStroke(ids[next]));
+        next = next + 1 == ids.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ServiceRoomGetStroke)->Arg(10)->Arg(100)->Arg(1000);
+
+// Lookup of an ID that is not on the board
+static void BM_ServiceRoomGetStrokeMiss(benchmark::State& state) {
+    Room room("bench-room");
+    fillBoard(room, ProtocolConstants::MaxStrokesPerRoom, 32);
+    const std::string missing = "no-such-stroke";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(room.getStroke(missing));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ServiceRoomGetStrokeMiss);
+
+// =============================================================================
+// RateLimiter::tryConsume
+// =============================================================================
+
+// Checks spread over N users; a generous rate keeps every call on the
+// allow path, which is what the server sees in normal traffic
+static void BM_ServiceRateLimiter(benchmark::State& state) {
+    static RateLimiter limiter(1e9, 1e9);
+    auto users = makeIds("user-" + std::to_string(state.thread_index()) + "-",
+                         static_cast<size_t>(state.range(0)));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.tryConsume(users[next]));
+        next = next + 1 == users.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ServiceRateLimiter)->Arg(1)->Arg(1000)->Threads(1)->Threads(4)->Threads(16);
+
+// =============================================================================
+// BoardService::getSnapshot
+// =============================================================================
+
+// room_state for a board of N strokes (64 points each). Arg 1 = 0 serves
+// the cached frame; 1 touches one stroke first, so the frame is rebuilt
+// from the per-stroke fragment cache.
+static void BM_ServiceGetSnapshot(benchmark::State& state) {
+    Room room("bench-room");
+    BoardService board;
+    const size_t strokes = static_cast<size_t>(state.range(0));
+    const bool changed = state.range(1) != 0;
+    fillBoard(room, strokes, 64);
+    auto ids = makeIds("stroke-", strokes);
+
+    size_t next = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        if (changed) {
+            state.PauseTiming();
+            room.withStroke(ids[next], [](Stroke& stroke) -> std::optional<ErrorCode> {
+                stroke.translate(0.0f, 0.0f);
+                return std::nullopt;
+            });
+            next = next + 1 == ids.size() ? 0 : next + 1;
+            state.ResumeTiming();
+        }
+        OutboundFrame frame = board.getSnapshot(room);
+        bytes = frame.size();
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_ServiceGetSnapshot)
+    ->Args({10, 0})->Args({100, 0})->Args({500, 0})
+    ->Args({10, 1})->Args({100, 1})->Args({500, 1});
+
+// =============================================================================
+// BoardService stroke lifecycle
+// =============================================================================
+
+// stroke_start, N stroke_adds of 8 points, stroke_end (compacted), with
+// no recipients: the cost of storing, growing and finishing one stroke
+static void BM_ServiceStrokeLifecycle(benchmark::State& state) {
+    Room room("bench-room");
+    BoardService board;
+    board.setStrokeCompaction(StrokeCompaction());
+    auto sendFunc = [](std::shared_ptr<WsSession>, const OutboundFrame&) {};
+    const int batches = static_cast<int>(state.range(0));
+
+    std::vector<Point> batch(8);
+    uint64_t next = 0;
+    for (auto _ : state) {
+        std::string strokeId = "stroke-" + std::to_string(next++);
+        board.handleStrokeStart(room, "user-1", strokeId, "#000000", 2.0f, sendFunc);
+        for (int b = 0; b < batches; ++b) {
+            for (size_t p = 0; p < batch.size(); ++p) {
+                float t = static_cast<float>(b * 8 + static_cast<int>(p));
+                batch[p] = Point(t, t * 0.5f + static_cast<float>(p % 3));
+            }
+            board.handleStrokeAdd(room, "user-1", strokeId, batch, sendFunc);
+        }
+        board.handleStrokeEnd(room, "user-1", strokeId, sendFunc);
+    }
+    state.SetItemsProcessed(state.iterations() * (batches + 2));
+}
+BENCHMARK(BM_ServiceStrokeLifecycle)->Arg(4)->Arg(16)->Arg(64);
@@ -7,6 +7,52 @@
  * Usage:
  *   ./collabboard_server [port]
  *   ./collabboard_server 8080
+ *
+ * Settings come from the environment, or from CONFIG_FILE (KEY=VALUE lines,
+ * same names; the environment wins). They are loaded once at startup and
+ * reported at /metrics as collabboard_config{setting="..."}.
+ *
+ * Environment:
+ *   CONFIG_FILE     Read settings from this file first
+ *   PORT            Port to listen on when no argument is given
+ *   IO_THREADS      io_context threads (default: CPUs allowed by affinity
+ *                   and the cgroup CPU quota)
+ *   IO_PIN_THREADS  1 pins each io thread to its own CPU (default 0)
+ *   REUSE_PORT      1 sets SO_REUSEPORT and opens one acceptor per io
+ *                   thread (default 0: one acceptor)
+ *   ACCEPTORS       Listening sockets when REUSE_PORT=1
+ *   TCP_NODELAY     0 re-enables Nagle on client sockets (default 1)
+ *   SOCKET_SNDBUF   SO_SNDBUF / SO_RCVBUF for client sockets in bytes
+ *   SOCKET_RCVBUF   (default 0 = OS default)
+ *   WS_READ_MAX_BYTES     Largest client message accepted (default 64 KB)
+ *   WS_WRITE_BUFFER_BYTES Beast frame write buffer (default 0 = Beast's 4 KB)
+ *   WS_DEFLATE      permessage-deflate level 1-9 for clients that offer it;
+ *                   compresses every frame, so it costs CPU (default 0 = off)
+ *   CURSOR_TICK_MS  Presence tick interval; 0 broadcasts every cursor move
+ *   CURSOR_RATE_HZ  Cursor updates per user per second (default 20)
+ *   CURSOR_BURST    Cursor updates a user may send at once (default 5)
+ *   SNAPSHOT_STROKES  Newest strokes sent in a room snapshot (default 500)
+ *   SNAPSHOT_THREADS  Threads building join snapshots off the io threads
+ *                     (0 builds them inline; default 2)
+ *   ROOM_MAX_USERS  Participants per room (default 15)
+ *   ROOM_MAX_STROKES  Strokes kept per room; oldest evicted (default 10000)
+ *   ROOM_MEMORY_MB  Stroke memory budget per room; oldest strokes are evicted
+ *                   past it (0 = unlimited; default 16)
+ *   BOARD_MEMORY_MB Stroke memory budget for the whole server, enforced on
+ *                   the reaper timer by trimming the largest rooms (default
+ *                   0 = unlimited)
+ *   STROKE_TOLERANCE  Simplify finished strokes to this many px (0 keeps
+ *                     every point as sent; default 0.5)
+ *   HEARTBEAT_TIMEOUT_MS  Drop participants silent this long; quiet ones are
+ *                         pinged at half of it (0 = off; default 30000)
+ *   ROOM_HIBERNATE_MS  Drop the snapshot caches of rooms whose board has been
+ *                      idle this long, and snapshot them to DATA_DIR
+ *                      (0 = off; default 120000)
+ *   DATA_DIR        Persist boards under this directory (default: memory only)
+ *   CLUSTER_NODES   Cluster members as "id=ws://host:port,id=ws://...";
+ *                   every node gets the same list and serves only the rooms
+ *                   hashed to it (default: single node, serves every room)
+ *   NODE_ID         This node's id in CLUSTER_NODES
  */
 
 #include <iostream>
@@ -16,12 +62,23 @@
 #include <csignal>
 #include <atomic>
 #include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <memory>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
 
 #include "server/ws_server.hpp"
+#include "server/server_config.hpp"
+#include "server/periodic_task.hpp"
+#include "server/room_executor.hpp"
+#include "server/maintenance_service.hpp"
 #include "services/room_service.hpp"
+#include "services/room_router.hpp"
+#include "storage/board_storage.hpp"
 
 namespace net = boost::asio;
 
@@ -46,8 +103,17 @@ void printUsage(const char* programName) {
 }
 
 int main(int argc, char* argv[]) {
-    // Parse port: CLI arg > PORT env var > default 8080
-    unsigned short port = 8080;
+    // Settings: CLI port > environment > CONFIG_FILE > defaults
+    collabboard::Settings settings;
+    if (const char* configFile = std::getenv("CONFIG_FILE"); configFile && *configFile) {
+        auto fromFile = collabboard::ServerConfig::settingsFromFile(configFile);
+        if (!fromFile) {
+            std::cerr << "Cannot read CONFIG_FILE: " << configFile << std::endl;
+            return 1;
+        }
+        settings = std::move(*fromFile);
+    }
+    collabboard::ServerConfig::settingsFromEnvironment(settings);
 
     if (argc > 1) {
         std::string arg = argv[1];
@@ -55,64 +121,202 @@ int main(int argc, char* argv[]) {
             printUsage(argv[0]);
             return 0;
         }
-        try {
-            port = static_cast<unsigned short>(std::stoi(arg));
-        } catch (...) {
+        std::vector<std::string> portErrors;
+        collabboard::ServerConfig::load({{"PORT", arg}}, portErrors, 1);
+        if (!portErrors.empty()) {
             std::cerr << "Invalid port number: " << arg << std::endl;
             printUsage(argv[0]);
             return 1;
         }
-    } else if (const char* envPort = std::getenv("PORT")) {
-        try {
-            port = static_cast<unsigned short>(std::stoi(envPort));
-        } catch (...) {
-            std::cerr << "Invalid PORT env: " << envPort << ", using 8080" << std::endl;
-        }
+        settings["PORT"] = arg;
     }
 
+    std::vector<std::string> warnings;
+    const collabboard::ServerConfig config = collabboard::ServerConfig::load(settings, warnings);
+    for (const auto& warning : warnings) {
+        std::cerr << warning << std::endl;
+    }
+    const int threads = config.ioThreads;
+
     printBanner();
 
     try {
         // Create io_context with thread count
-        const auto threads = std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()));
         net::io_context ioc{threads};
 
-        // Create room service
+        // Board storage, if enabled; declared first so it outlives the rooms
+        // and flushes its log on the way out
+        std::unique_ptr<collabboard::BoardStorage> storage;
+        if (!config.dataDir.empty()) {
+            collabboard::StorageOptions options;
+            options.directory = config.dataDir;
+            storage = std::make_unique<collabboard::BoardStorage>(std::move(options));
+        }
+
+        // Cluster mode: serve only the rooms the ring assigns to this node.
+        // Declared before the room service, which keeps a pointer to it.
+        std::unique_ptr<collabboard::RoomRouter> router;
+        if (!config.clusterNodes.empty()) {
+            router = std::make_unique<collabboard::RoomRouter>(
+                config.nodeId, collabboard::RoomRouter::parseNodes(config.clusterNodes));
+        }
+
+        // Create room service; each room's work runs on its own strand
         collabboard::RoomService roomService;
+        roomService.setExecutorFactory(collabboard::makeStrandExecutorFactory(ioc));
+        roomService.setStorage(storage.get());
+        roomService.getBoardService().setStrokeCompaction(config.compaction);
+        roomService.getBoardService().setSnapshotLimit(config.snapshotStrokes);
+        roomService.getPresenceService().setCursorRate(config.cursorRateHz, config.cursorBurst);
+        roomService.setMemoryBudget(config.memoryBudget);
+        roomService.setRoomLimits(config.roomLimits);
+        roomService.setRouter(router.get());
+
+        // Build join snapshots off the io threads. Declared after the room
+        // service so its threads are joined before the service goes away.
+        std::unique_ptr<net::thread_pool> snapshotPool;
+        if (config.snapshotThreads > 0) {
+            snapshotPool = std::make_unique<net::thread_pool>(config.snapshotThreads);
+            roomService.setSnapshotExecutor([pool = snapshotPool.get()](collabboard::Room::Task task) {
+                net::post(*pool, std::move(task));
+            });
+        }
 
-        // Create and launch the server
-        auto server = std::make_shared<collabboard::WsServer>(
+        // Create and launch the server: one acceptor, or one per
+        // config.socket.acceptors sharing the port through SO_REUSEPORT
+        std::vector<std::shared_ptr<collabboard::WsServer>> servers;
+        for (int i = 0; i < config.socket.acceptors; ++i) {
+            servers.push_back(std::make_shared<collabboard::WsServer>(
+                ioc,
+                boost::asio::ip::tcp::endpoint{
+                    boost::asio::ip::make_address("0.0.0.0"),
+                    config.port
+                },
+                roomService,
+                config
+            ));
+            servers.back()->run();
+        }
+
+        // Aggregate cursor moves into one cursor_batch per room per tick
+        std::shared_ptr<collabboard::PeriodicTask> cursorTick;
+        if (config.cursorTickMs > 0) {
+            roomService.getPresenceService().setCursorTickEnabled(true);
+            cursorTick = std::make_shared<collabboard::PeriodicTask>(
+                ioc,
+                std::chrono::milliseconds(config.cursorTickMs),
+                [&roomService]() {
+                    roomService.flushCursorBatches(collabboard::WsSession::sessionSendFunc());
+                }
+            );
+            cursorTick->start();
+        }
+
+        // Delete rooms left empty past their grace period, then trim boards
+        // if the server is over its memory budget
+        auto roomReaper = std::make_shared<collabboard::PeriodicTask>(
+            ioc,
+            std::chrono::milliseconds(collabboard::ProtocolConstants::RoomReapIntervalMs),
+            [&roomService]() {
+                roomService.reapExpiredRooms();
+                roomService.enforceMemoryBudget();
+            }
+        );
+        roomReaper->start();
+
+        // Heartbeats, ghost cursors and idle-room hibernation
+        collabboard::MaintenanceService maintenance(roomService, config.maintenance);
+        auto maintenanceTask = std::make_shared<collabboard::PeriodicTask>(
             ioc,
-            boost::asio::ip::tcp::endpoint{
-                boost::asio::ip::make_address("0.0.0.0"),
-                port
-            },
-            roomService
+            std::chrono::milliseconds(collabboard::ProtocolConstants::MaintenanceIntervalMs),
+            [&maintenance]() {
+                maintenance.sweep();
+            }
         );
-        server->run();
+        maintenanceTask->start();
 
         // Set up signal handling for graceful shutdown
         net::signal_set signals(ioc, SIGINT, SIGTERM);
         signals.async_wait([&](boost::system::error_code const&, int sig) {
             std::cout << "\nReceived signal " << sig << ", shutting down..." << std::endl;
             g_running = false;
-            server->stop();
+            for (auto& server : servers) {
+                server->stop();
+            }
+            if (cursorTick) {
+                cursorTick->stop();
+            }
+            roomReaper->stop();
+            maintenanceTask->stop();
+            if (snapshotPool) {
+                snapshotPool->stop();
+            }
             ioc.stop();
         });
 
-        std::cout << "Server started with " << threads << " thread(s)" << std::endl;
+        std::cout << "Server started with " << threads << " thread(s)"
+                  << (config.pinThreads ? ", pinned" : "") << ", "
+                  << config.socket.acceptors << " acceptor(s)" << std::endl;
+        if (config.cursorTickMs > 0) {
+            std::cout << "Cursor tick: every " << config.cursorTickMs << " ms" << std::endl;
+        } else {
+            std::cout << "Cursor tick: off (per-move broadcast)" << std::endl;
+        }
+        if (config.compaction.enabled()) {
+            std::cout << "Stroke compaction: " << config.compaction.tolerance << " px tolerance, "
+                      << config.compaction.gridStep << " px grid" << std::endl;
+        } else {
+            std::cout << "Stroke compaction: off" << std::endl;
+        }
+        const collabboard::DeflatePolicy& deflate = config.session.deflate;
+        if (deflate.enabled) {
+            std::cout << "WebSocket deflate: level " << deflate.level << std::endl;
+        } else {
+            std::cout << "WebSocket deflate: off" << std::endl;
+        }
+        if (storage) {
+            std::cout << "Storage: " << storage->directory() << std::endl;
+        } else {
+            std::cout << "Storage: off (boards kept in memory)" << std::endl;
+        }
+        auto printBudget = [](size_t bytes) {
+            return bytes ? std::to_string(bytes >> 20) + " MB" : std::string("unlimited");
+        };
+        std::cout << "Stroke memory: " << printBudget(config.memoryBudget.roomBytes) << " per room, "
+                  << printBudget(config.memoryBudget.totalBytes) << " total" << std::endl;
+        std::cout << "Rooms: " << config.roomLimits.maxUsers << " users, "
+                  << config.roomLimits.maxStrokes << " strokes, snapshots of "
+                  << config.snapshotStrokes << std::endl;
+        std::cout << "Snapshot builders: "
+                  << (config.snapshotThreads > 0 ? std::to_string(config.snapshotThreads) + " thread(s)"
+                                                 : std::string("inline")) << std::endl;
+        auto printMs = [](std::chrono::milliseconds ms) {
+            return ms.count() > 0 ? std::to_string(ms.count() / 1000) + " s" : std::string("off");
+        };
+        std::cout << "Heartbeat timeout: " << printMs(config.maintenance.heartbeatTimeout)
+                  << ", room hibernation: " << printMs(config.maintenance.hibernateAfter) << std::endl;
+        if (router) {
+            std::cout << "Cluster: node " << router->local().id << " of "
+                      << router->nodes().size() << std::endl;
+        } else {
+            std::cout << "Cluster: off (serving every room)" << std::endl;
+        }
         std::cout << "Press Ctrl+C to stop" << std::endl;
         std::cout << std::endl;
 
-        // Run the io_context on multiple threads
+        // Run the io_context on multiple threads, each on its own CPU if pinned
+        auto runThread = [&ioc, &config](int index) {
+            if (config.pinThreads && !collabboard::pinCurrentThread(static_cast<size_t>(index))) {
+                std::cerr << "Could not pin io thread " << index << std::endl;
+            }
+            ioc.run();
+        };
         std::vector<std::thread> v;
         v.reserve(threads - 1);
         for (auto i = threads - 1; i > 0; --i) {
-            v.emplace_back([&ioc] {
-                ioc.run();
-            });
+            v.emplace_back(runThread, i);
         }
-        ioc.run();
+        runThread(0);
 
         // Wait for all threads to complete
         for (auto& t : v) {
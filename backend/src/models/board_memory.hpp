@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Byte budgets for stroke memory (0 = unlimited).
+ */
+struct MemoryBudget {
+    size_t roomBytes = ProtocolConstants::RoomBoardBudgetBytes;  // Enforced as strokes change
+    size_t totalBytes = 0;                                       // Enforced by the server's sweep
+};
+
+/**
+ * @brief Server-wide stroke memory counters, shared by every room.
+ *
+ * Rooms add the change in their Stroke::estimateSize() total as they
+ * mutate, so totalBytes() is the sum over live rooms without a walk.
+ * Shared by shared_ptr because a session can keep its Room alive past
+ * the RoomService.
+ */
+class BoardMemory {
+public:
+    void add(int64_t deltaBytes) {
+        bytes_.fetch_add(deltaBytes, std::memory_order_relaxed);
+    }
+
+    void countEvicted(uint64_t strokes) {
+        evictedStrokes_.fetch_add(strokes, std::memory_order_relaxed);
+    }
+
+    size_t totalBytes() const {
+        int64_t bytes = bytes_.load(std::memory_order_relaxed);
+        return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+    }
+
+    uint64_t evictedStrokes() const {
+        return evictedStrokes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<uint64_t> evictedStrokes_{0};
+};
+
+} // namespace collabboard
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "stroke.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Recycled point buffers for a room's live strokes.
+ *
+ * A stroke being drawn grows by a handful of points per stroke_add. Left
+ * to std::vector it reallocates and copies at 1, 2, 4, ... points; started
+ * on a slab of StrokePointSlab points, most strokes never reallocate at
+ * all. When a stroke finishes, Room moves its points into an exact-size
+ * vector and hands the slab back here, so a room with steady drawing
+ * reuses a few slabs instead of going to malloc for every stroke.
+ *
+ * Holds at most maxBuffers slabs, and only slab-sized ones (a buffer that
+ * grew past the slab is freed, not kept). Not thread-safe; Room uses it
+ * under its lock.
+ */
+class PointPool {
+public:
+    explicit PointPool(size_t slabPoints = ProtocolConstants::StrokePointSlab,
+                       size_t maxBuffers = ProtocolConstants::PointPoolBuffers)
+        : slabPoints_(std::max<size_t>(slabPoints, 1))
+        , maxBuffers_(maxBuffers)
+    {}
+
+    /**
+     * @brief An empty buffer with room for at least one slab of points.
+     */
+    std::vector<Point> acquire() {
+        if (!free_.empty()) {
+            std::vector<Point> buffer = std::move(free_.back());
+            free_.pop_back();
+            ++reused_;
+            return buffer;
+        }
+        std::vector<Point> buffer;
+        buffer.reserve(slabPoints_);
+        ++allocated_;
+        return buffer;
+    }
+
+    /**
+     * @brief Return a buffer; kept for reuse if it is still slab-sized
+     *        and the pool is not full, freed otherwise.
+     */
+    void release(std::vector<Point>&& buffer) {
+        if (buffer.capacity() != slabPoints_ || free_.size() >= maxBuffers_) {
+            return;
+        }
+        buffer.clear();
+        free_.push_back(std::move(buffer));
+    }
+
+    /**
+     * @brief Give a live stroke a slab to grow in, keeping its points.
+     */
+    void adopt(Stroke& stroke) {
+        if (stroke.points.capacity() >= slabPoints_) return;
+        std::vector<Point> buffer = acquire();
+        buffer.insert(buffer.end(), stroke.points.begin(), stroke.points.end());
+        stroke.points.swap(buffer);
+    }
+
+    /**
+     * @brief Move a finished stroke's points into an exact-size vector and
+     *        recycle the slab it grew in.
+     */
+    void settle(Stroke& stroke) {
+        if (stroke.points.capacity() == stroke.points.size()) return;
+        std::vector<Point> exact(stroke.points.begin(), stroke.points.end());
+        stroke.points.swap(exact);
+        release(std::move(exact));
+    }
+
+    /**
+     * @brief Free every cached slab.
+     * @return Number of slabs freed
+     */
+    size_t clear() {
+        size_t freed = free_.size();
+        free_.clear();
+        free_.shrink_to_fit();
+        return freed;
+    }
+
+    size_t slabPoints() const { return slabPoints_; }
+    size_t cached() const { return free_.size(); }
+    uint64_t reused() const { return reused_; }
+    uint64_t allocated() const { return allocated_; }
+
+private:
+    size_t slabPoints_;
+    size_t maxBuffers_;
+    std::vector<std::vector<Point>> free_;
+    uint64_t reused_ = 0;
+    uint64_t allocated_ = 0;
+};
+
+} // namespace collabboard
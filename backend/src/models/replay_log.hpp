@@ -0,0 +1,100 @@
+#pragma once
+
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "../protocol/outbound_frame.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Bounded log of a room's recent board broadcasts, by seq.
+ *
+ * Frames are kept as shared OutboundFrames, so logging one costs a
+ * reference count. The byte budget counts both of a frame's encodings. Once the log holds more than its frame or byte budget,
+ * the oldest frames are dropped and floorSeq() advances past them: a
+ * client that has seen everything up to lastSeq can be caught up from the
+ * log exactly when lastSeq >= floorSeq().
+ *
+ * Not thread-safe; Room guards it with its mutex.
+ */
+class ReplayLog {
+public:
+    explicit ReplayLog(size_t maxFrames = ProtocolConstants::ReplayLogFrames,
+                       size_t maxBytes = ProtocolConstants::ReplayLogBytes)
+        : maxFrames_(std::max<size_t>(maxFrames, 1))
+        , maxBytes_(maxBytes)
+    {}
+
+    /**
+     * @brief Record a frame broadcast with the given seq.
+     *
+     * Frames normally arrive in seq order; one that arrives late is
+     * inserted in place.
+     */
+    void append(uint64_t seq, const OutboundFrame& frame) {
+        if (seq <= floorSeq_) {
+            return;  // Already older than the window
+        }
+        auto pos = entries_.end();
+        while (pos != entries_.begin() && std::prev(pos)->seq > seq) {
+            --pos;
+        }
+        entries_.insert(pos, Entry{seq, frame});
+        bytes_ += frame.payloadBytes();
+
+        while (entries_.size() > maxFrames_ || (bytes_ > maxBytes_ && entries_.size() > 1)) {
+            floorSeq_ = entries_.front().seq;
+            bytes_ -= entries_.front().frame.payloadBytes();
+            entries_.pop_front();
+        }
+    }
+
+    /**
+     * @brief Check that every logged frame after lastSeq is still held.
+     */
+    bool covers(uint64_t lastSeq) const {
+        return lastSeq >= floorSeq_;
+    }
+
+    /**
+     * @brief Visit the frames with seq > lastSeq, oldest first.
+     * @param fn Called as fn(const OutboundFrame&)
+     * @return Number of frames visited
+     */
+    template<typename Fn>
+    size_t forEachAfter(uint64_t lastSeq, Fn&& fn) const {
+        auto it = std::upper_bound(entries_.begin(), entries_.end(), lastSeq,
+                                   [](uint64_t seq, const Entry& e) { return seq < e.seq; });
+        size_t count = 0;
+        for (; it != entries_.end(); ++it, ++count) {
+            fn(it->frame);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Highest seq dropped from the log (0 if none).
+     */
+    uint64_t floorSeq() const { return floorSeq_; }
+
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+
+private:
+    struct Entry {
+        uint64_t seq;
+        OutboundFrame frame;
+    };
+
+    size_t maxFrames_;
+    size_t maxBytes_;
+    std::deque<Entry> entries_;
+    size_t bytes_ = 0;
+    uint64_t floorSeq_ = 0;
+};
+
+} // namespace collabboard
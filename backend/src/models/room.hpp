@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <memory>
@@ -8,31 +9,70 @@
 #include <atomic>
 #include <functional>
 #include <algorithm>
+#include <optional>
+#include <chrono>
 
 #include "user_info.hpp"
 #include "stroke.hpp"
+#include "stroke_store.hpp"
+#include "point_pool.hpp"
+#include "replay_log.hpp"
+#include "board_memory.hpp"
+#include "../utils/metrics.hpp"
 #include "../protocol/message_types.hpp"
+#include "../protocol/outbound_frame.hpp"
+#include "../protocol/snapshot_cache.hpp"
+#include "../utils/uuid.hpp"
+#include "../utils/id128.hpp"
 
 namespace collabboard {
 
 // Forward declaration
 class WsSession;
 
+/**
+ * @brief Where a reconnecting client left off (from a resume message).
+ */
+struct ResumePoint {
+    std::string userId;       // ID to reclaim, if nobody in the room holds it
+    std::string epoch;        // Room epoch from the earlier welcome
+    uint64_t lastSeq = 0;     // Highest board seq the client has applied
+    std::string token;        // resumeToken from the earlier welcome
+};
+
+/**
+ * @brief Per-room caps, fixed when the room is created.
+ */
+struct RoomLimits {
+    size_t maxUsers = ProtocolConstants::MaxUsersPerRoom;
+    size_t maxStrokes = ProtocolConstants::MaxStrokesPerRoom;  // Oldest evicted past this
+};
+
 /**
  * @brief Represents a collaborative room with participants and board state.
  */
 class Room {
 public:
-    using BroadcastCallback = std::function<void(const std::string&)>;
+    using BroadcastCallback = std::function<void(const OutboundFrame&)>;
+    using Task = std::function<void()>;
+    using Executor = std::function<void(Task)>;
 
-    explicit Room(const std::string& id, const std::string& password = "")
+    explicit Room(const std::string& id, const std::string& password = "",
+                  const RoomLimits& limits = RoomLimits())
         : roomId_(id)
         , password_(password)
+        , epoch_(generateShortId())
+        , strokes_(limits.maxStrokes)
         , nextSeq_(1)
-        , maxStrokes_(ProtocolConstants::MaxStrokesPerRoom)
-        , maxUsers_(ProtocolConstants::MaxUsersPerRoom)
+        , maxUsers_(limits.maxUsers)
     {}
 
+    ~Room() {
+        if (memory_) {
+            memory_->add(-static_cast<int64_t>(boardBytes_));
+        }
+    }
+
     // Non-copyable
     Room(const Room&) = delete;
     Room& operator=(const Room&) = delete;
@@ -46,6 +86,21 @@ public:
     // =========================================================================
 
     const std::string& getId() const { return roomId_; }
+
+    /**
+     * @brief Random ID of this Room instance.
+     * Sequence numbers restart when a room is reaped and recreated; the
+     * epoch tells a resuming client which run its seqs belong to.
+     */
+    const std::string& getEpoch() const { return epoch_; }
+
+    /**
+     * @brief Check if any participant negotiated the binary protocol.
+     * Broadcast frames skip their binary encoding otherwise. Lock-free; a
+     * binary client joining meanwhile gets the JSON text of a frame built
+     * just before.
+     */
+    bool wantsBinary() const { return binaryMembers_.load(std::memory_order_relaxed) > 0; }
     bool hasPassword() const { return !password_.empty(); }
     
     bool validatePassword(const std::string& pwd) const {
@@ -53,6 +108,32 @@ public:
         return password_ == pwd;
     }
 
+    // =========================================================================
+    // Execution
+    // =========================================================================
+
+    /**
+     * @brief Set the executor that owns this room's message handling.
+     *
+     * Must be called before the room is shared. The server gives each room
+     * its own strand, so one room's handlers never run concurrently and
+     * its mutex is uncontended.
+     */
+    void setExecutor(Executor executor) {
+        executor_ = std::move(executor);
+    }
+
+    /**
+     * @brief Run a task on the room's executor, or inline if it has none.
+     */
+    void post(Task task) {
+        if (executor_) {
+            executor_(std::move(task));
+        } else {
+            task();
+        }
+    }
+
     // =========================================================================
     // Participant Management
     // =========================================================================
@@ -66,28 +147,131 @@ public:
         if (participants_.size() >= maxUsers_) {
             return false;
         }
-        participants_[oderId] = info;
-        cursors_[oderId] = CursorState(oderId, 0, 0);
+        Id128 key = Id128::fromText(oderId);
+        putParticipant(key, info);
+        cursors_[key] = CursorState(oderId, 0, 0);
         return true;
     }
 
+    /**
+     * @brief Outcome of admitParticipant().
+     */
+    enum class Admission {
+        Full,            // Room at capacity; not added
+        Replayed,        // Added and caught up from the replay log
+        NeedsSnapshot    // Added; caller must send a board snapshot
+    };
+
+    /**
+     * @brief Add a participant, catching it up from the replay log if it can.
+     *
+     * A resume reclaims its old user ID only if its epoch is this room's,
+     * its token is the one the room last issued for that ID, and nobody
+     * holds the ID now; otherwise info keeps its fresh ID and the
+     * participant joins as new. info.userId is updated to the ID used.
+     * The check runs under the room lock, so two resumes of one ID cannot
+     * both win.
+     *
+     * welcome(participants, resumed, token) is called once the participant
+     * is in, to send the welcome; token is a new resume token for it, which
+     * replaces the old one. If the ID was reclaimed and the log still holds
+     * everything after lastSeq, each logged frame after lastSeq then goes
+     * to replay(frame).
+     *
+     * Both run in one critical section with publish(), so a board event
+     * published concurrently is either replayed or delivered live, never
+     * both, and never ahead of the welcome or the replay. Neither callback
+     * may call back into this Room (nextSequence() and getEpoch() are
+     * lock-free and fine).
+     *
+     * On NeedsSnapshot, the participant's board events are held from here
+     * until deliverSnapshot() hands it the snapshot.
+     */
+    template<typename Welcome, typename Replay>
+    Admission admitParticipant(UserInfo& info, const ResumePoint* resume,
+                               Welcome&& welcome, Replay&& replay) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (participants_.size() >= maxUsers_) {
+            return Admission::Full;
+        }
+        bool reclaimed = resume && canReclaim(*resume);
+        if (reclaimed) {
+            info.userId = resume->userId;
+        }
+        Id128 key = Id128::fromText(info.userId);
+        putParticipant(key, info);
+        cursors_[key] = CursorState(info.userId, 0, 0);
+        std::string token = issueResumeToken(key);
+
+        std::vector<UserInfo> users;
+        users.reserve(participants_.size());
+        for (const auto& [_, user] : participants_) {
+            users.push_back(user);
+        }
+
+        bool resumed = reclaimed && resume->lastSeq < currentSequence() &&
+                       replayLog_.covers(resume->lastSeq);
+        welcome(users, resumed, token);
+        if (!resumed) {
+            held_[key].clear();
+            return Admission::NeedsSnapshot;
+        }
+        replayLog_.forEachAfter(resume->lastSeq, replay);
+        return Admission::Replayed;
+    }
+
     /**
      * @brief Remove a participant from the room.
      */
     void removeParticipant(const std::string& oderId) {
         std::lock_guard<std::mutex> lock(mutex_);
-        participants_.erase(oderId);
-        cursors_.erase(oderId);
+        Id128 key = Id128::fromText(oderId);
+        auto it = participants_.find(key);
+        if (it != participants_.end()) {
+            if (it->second.binary) --binaryMembers_;
+            participants_.erase(it);
+        }
+        cursors_.erase(key);
+        held_.erase(key);
+    }
+
+    /**
+     * @brief Get a copy of a participant by ID.
+     * @return UserInfo, or nullopt if not found
+     */
+    std::optional<UserInfo> getParticipant(const std::string& oderId) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = participants_.find(Id128::fromText(oderId));
+        if (it == participants_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Run fn(UserInfo&) on a participant under the room lock.
+     *
+     * fn must not call back into this Room.
+     *
+     * @return false if the participant is not in the room
+     */
+    template<typename Fn>
+    bool withParticipant(const std::string& oderId, Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = participants_.find(Id128::fromText(oderId));
+        if (it == participants_.end()) {
+            return false;
+        }
+        fn(it->second);
+        return true;
     }
 
     /**
-     * @brief Get a participant by ID.
-     * @return Pointer to UserInfo, or nullptr if not found
+     * @brief Check if a user is in the room.
      */
-    UserInfo* getParticipant(const std::string& oderId) {
+    bool hasParticipant(const std::string& oderId) const {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = participants_.find(oderId);
-        return (it != participants_.end()) ? &it->second : nullptr;
+        return participants_.count(Id128::fromText(oderId)) > 0;
     }
 
     /**
@@ -121,8 +305,8 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         std::vector<std::string> ids;
         ids.reserve(participants_.size());
-        for (const auto& [id, _] : participants_) {
-            ids.push_back(id);
+        for (const auto& [_, info] : participants_) {
+            ids.push_back(info.userId);
         }
         return ids;
     }
@@ -140,41 +324,109 @@ public:
         return users;
     }
 
+    /**
+     * @brief Get the live session of every participant.
+     */
+    std::vector<std::shared_ptr<WsSession>> getSessions() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<WsSession>> sessions;
+        sessions.reserve(participants_.size());
+        for (const auto& [_, info] : participants_) {
+            if (auto session = info.session.lock()) {
+                sessions.push_back(std::move(session));
+            }
+        }
+        return sessions;
+    }
+
     // =========================================================================
     // Cursor Management
     // =========================================================================
 
+    /**
+     * @brief Update a user's cursor position if their cursor bucket allows.
+     *
+     * The bucket lives with the participant, so the check rides on the
+     * lookup and lock this update needs anyway.
+     *
+     * @return false if the user is not in the room or is over the rate
+     */
+    bool updateCursor(const std::string& oderId, float x, float y,
+                      const TokenRate& rate) {
+        Id128 key = Id128::fromText(oderId);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto userIt = participants_.find(key);
+        if (userIt == participants_.end() ||
+            !userIt->second.cursorBucket.tryConsume(rate, CoarseClock::nowNs())) {
+            return false;
+        }
+        auto it = cursors_.find(key);
+        if (it != cursors_.end()) {
+            it->second.update(x, y);
+        }
+        userIt->second.touch();
+        return true;
+    }
+
     /**
      * @brief Update a user's cursor position.
+     * @return false if the user is not in the room
      */
-    void updateCursor(const std::string& oderId, float x, float y) {
+    bool updateCursor(const std::string& oderId, float x, float y) {
+        Id128 key = Id128::fromText(oderId);
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = cursors_.find(oderId);
+        auto it = cursors_.find(key);
         if (it != cursors_.end()) {
             it->second.update(x, y);
         }
         // Also update user's last activity
-        auto userIt = participants_.find(oderId);
-        if (userIt != participants_.end()) {
-            userIt->second.touch();
+        auto userIt = participants_.find(key);
+        if (userIt == participants_.end()) {
+            return false;
         }
+        userIt->second.touch();
+        return true;
     }
 
     /**
-     * @brief Get a user's cursor state.
+     * @brief Get a copy of a user's cursor state.
      */
-    CursorState* getCursor(const std::string& oderId) {
+    std::optional<CursorState> getCursor(const std::string& oderId) const {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = cursors_.find(oderId);
-        return (it != cursors_.end()) ? &it->second : nullptr;
+        auto it = cursors_.find(Id128::fromText(oderId));
+        if (it == cursors_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
     }
 
     /**
      * @brief Get all cursors.
      */
-    std::unordered_map<std::string, CursorState> getCursors() const {
+    std::vector<CursorState> getCursors() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<CursorState> cursors;
+        cursors.reserve(cursors_.size());
+        for (const auto& [_, cursor] : cursors_) {
+            cursors.push_back(cursor);
+        }
+        return cursors;
+    }
+
+    /**
+     * @brief Collect cursors that moved since the last call and clear their
+     * dirty flags.
+     */
+    std::vector<CursorState> takeDirtyCursors() {
         std::lock_guard<std::mutex> lock(mutex_);
-        return cursors_;
+        std::vector<CursorState> dirty;
+        for (auto& [id, cursor] : cursors_) {
+            if (cursor.dirty) {
+                dirty.push_back(cursor);
+                cursor.dirty = false;
+            }
+        }
+        return dirty;
     }
 
     // =========================================================================
@@ -182,25 +434,87 @@ public:
     // =========================================================================
 
     /**
-     * @brief Add a stroke to the room.
+     * @brief Add a stroke to the room, evicting the oldest if at the cap.
+     *
+     * If a stroke with the same ID is already stored, lookups keep
+     * resolving to the earlier one.
      */
     void addStroke(const Stroke& stroke) {
         std::lock_guard<std::mutex> lock(mutex_);
-        strokes_.push_back(stroke);
-        pruneStrokesIfNeeded();
+        pushStroke(stroke);
+        enforceBudget();
+        ++boardVersion_;
     }
 
     /**
-     * @brief Get a stroke by ID.
+     * @brief Assign the stroke's seq and add it in one critical section,
+     * so stored order always matches seq order. The stroke grows in a
+     * pooled slab until it finishes.
+     * @return The assigned sequence number
      */
-    Stroke* getStroke(const std::string& strokeId) {
+    uint64_t startStroke(Stroke stroke) {
+        return startStroke(std::move(stroke), [](const Stroke&) {});
+    }
+
+    /**
+     * @brief startStroke() that also runs onStored(const Stroke&) on the
+     * stored stroke before the lock is released (e.g. to journal it).
+     */
+    template<typename Fn>
+    uint64_t startStroke(Stroke stroke, Fn&& onStored) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t seq = nextSequence();
+        stroke.seq = seq;
+        pointPool_.adopt(stroke);
+        onStored(pushStroke(std::move(stroke)));
+        enforceBudget();
+        ++boardVersion_;
+        return seq;
+    }
+
+    /**
+     * @brief Look up a stroke and run fn(Stroke&) on it under the room lock.
+     *
+     * Lookup, validation and mutation happen in one critical section, so
+     * no other thread can touch or evict the stroke meanwhile. fn returns
+     * an error to reject the operation; it must not call back into this
+     * Room (nextSequence() is lock-free and fine).
+     *
+     * @return InvalidStroke if not found, otherwise fn's result
+     */
+    template<typename Fn>
+    std::optional<ErrorCode> withStroke(const std::string& strokeId, Fn&& fn) {
         std::lock_guard<std::mutex> lock(mutex_);
-        for (auto& stroke : strokes_) {
-            if (stroke.strokeId == strokeId) {
-                return &stroke;
+        auto stroke = strokes_.find(strokeId);
+        if (!stroke) {
+            return ErrorCode::InvalidStroke;
+        }
+        size_t before = stroke->estimateSize();
+        bool wasComplete = stroke->complete;
+        std::optional<ErrorCode> error = fn(*stroke);
+        if (!error) {
+            if (!wasComplete && stroke->complete) {
+                pointPool_.settle(*stroke);  // Trim to size, recycle the slab
             }
+            account(static_cast<int64_t>(stroke->estimateSize()) - static_cast<int64_t>(before));
+            strokes_.reindex(strokeId);
+            enforceBudget();
+            ++boardVersion_;
         }
-        return nullptr;
+        return error;
+    }
+
+    /**
+     * @brief Get a copy of a stroke by ID.
+     * @return Stroke, or nullopt if not stored
+     */
+    std::optional<Stroke> getStroke(const std::string& strokeId) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto stroke = strokes_.find(strokeId);
+        if (!stroke) {
+            return std::nullopt;
+        }
+        return *stroke;
     }
 
     /**
@@ -208,21 +522,135 @@ public:
      */
     std::vector<Stroke> getStrokes() const {
         std::lock_guard<std::mutex> lock(mutex_);
-        return strokes_;
+        return strokes_.copyNewest(strokes_.size());
     }
 
     /**
-     * @brief Get recent strokes for snapshot (up to limit).
+     * @brief Run fn(const StrokeStore&) on the whole board under the room lock.
+     * Like withStroke(), fn must not call back into this Room.
+     */
+    template<typename Fn>
+    void withStrokes(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn(static_cast<const StrokeStore&>(strokes_));
+    }
+
+    /**
+     * @brief Get recent strokes for snapshot (up to limit), oldest first.
      */
     std::vector<Stroke> getStrokesSnapshot(size_t limit = 500) const {
         std::lock_guard<std::mutex> lock(mutex_);
-        if (strokes_.size() <= limit) {
-            return strokes_;
+        return strokes_.copyNewest(limit);
+    }
+
+    /**
+     * @brief Get the room_state frame for the newest strokes (up to limit).
+     *
+     * Served from the room's SnapshotCache: the same frame is returned
+     * until a stroke is added or changed, and rebuilding it only encodes
+     * strokes that changed since the last build. The frame's snapshotSeq
+     * is the sequence number at build time.
+     */
+    OutboundFrame getSnapshotFrame(size_t limit = 500) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshotCache_.get(strokes_, limit, boardVersion_, currentSequence());
+    }
+
+    /**
+     * @brief Get the same snapshot split into room_state_chunk frames.
+     * Cached like getSnapshotFrame().
+     */
+    std::shared_ptr<const SnapshotChunks> getSnapshotChunks(size_t limit = 500) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshotCache_.getChunks(strokes_, limit, boardVersion_, currentSequence());
+    }
+
+    /**
+     * @brief Build the snapshot for a joining participant.
+     *
+     * The newest strokes (up to limit), or with a viewport the newest of
+     * those in it; chunked if asked. Built from the SnapshotCache, so a
+     * full snapshot is shared while the board is unchanged.
+     *
+     * The lock is held only to take the job (shared encodings, copies of
+     * stale strokes) and to hand the result back; encoding and assembling
+     * the frames happen outside it, so a large snapshot does not stall the
+     * room's live traffic.
+     *
+     * @param binary Include the binary encoding (for a binary client)
+     */
+    BoardSnapshot getJoinSnapshot(size_t limit, bool chunked,
+                                  const std::optional<Bounds>& viewport, bool binary = true) {
+        SnapshotJob job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job = snapshotCache_.prepare(strokes_, limit, chunked, viewport, boardVersion_,
+                                         currentSequence(), ProtocolConstants::SnapshotChunkBytes,
+                                         binary);
+            if (job.built) {
+                return std::move(job.snapshot);
+            }
+        }
+        SnapshotCache::build(job);
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshotCache_.adopt(strokes_, job, boardVersion_);
+        return std::move(job.snapshot);
+    }
+
+    /**
+     * @brief Send a participant admitted with NeedsSnapshot its snapshot,
+     *        then the board events held back since.
+     *
+     * Held events with a seq below snapshotSeq are already in the
+     * snapshot and are dropped; the rest follow it in order. Both go out
+     * under the room lock, so no live event can slip in between. An event
+     * whose seq was assigned before the build but that is published only
+     * after this call is in the snapshot too, so publish() skips board
+     * events below snapshotSeq for this participant from then on.
+     *
+     * @param session The session the snapshot was built for; nothing is
+     *        sent if the participant left or rejoined on another one
+     * @return false if nothing was sent
+     */
+    bool deliverSnapshot(const std::string& oderId, const std::shared_ptr<WsSession>& session,
+                         const BoardSnapshot& snapshot, const FrameSendFunc& sendFunc) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Id128 key = Id128::fromText(oderId);
+        auto held = held_.find(key);
+        auto it = participants_.find(key);
+        if (held == held_.end() || it == participants_.end() ||
+            it->second.session.lock() != session) {
+            return false;
+        }
+        for (const OutboundFrame& frame : snapshot.frames) {
+            sendFunc(session, frame);
         }
-        return std::vector<Stroke>(
-            strokes_.end() - static_cast<std::ptrdiff_t>(limit),
-            strokes_.end()
-        );
+        for (const auto& [seq, frame] : held->second) {
+            if (seq >= snapshot.snapshotSeq) {
+                sendFunc(session, frame);
+            }
+        }
+        held_.erase(held);
+        it->second.snapshotSeq = snapshot.snapshotSeq;
+        return true;
+    }
+
+    /**
+     * @brief Number of participants still waiting for their snapshot.
+     */
+    size_t getPendingSnapshots() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return held_.size();
+    }
+
+    /**
+     * @brief Get a region_state with every stroke whose extent overlaps area.
+     * @param binary Include the binary encoding (for a binary client)
+     * @return nullopt if there are none
+     */
+    std::optional<OutboundFrame> getRegionFrame(const Bounds& area, bool binary = true) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshotCache_.getRegion(strokes_, area, std::nullopt, currentSequence(), binary);
     }
 
     /**
@@ -233,6 +661,90 @@ public:
         return strokes_.size();
     }
 
+    // =========================================================================
+    // Memory Accounting
+    // =========================================================================
+
+    /**
+     * @brief Track stroke bytes in a shared counter and cap this room's.
+     *
+     * Must be called before the room is shared (or strokes are added).
+     * Once the room's Stroke::estimateSize() total passes budgetBytes,
+     * the oldest strokes are evicted until it fits again.
+     *
+     * @param budgetBytes Room budget (0 = unlimited)
+     */
+    void setMemoryBudget(size_t budgetBytes, std::shared_ptr<BoardMemory> memory) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (memory_) memory_->add(-static_cast<int64_t>(boardBytes_));
+        byteBudget_ = budgetBytes;
+        memory_ = std::move(memory);
+        if (memory_) memory_->add(static_cast<int64_t>(boardBytes_));
+        enforceBudget();
+    }
+
+    /**
+     * @brief Estimated bytes held by this room's strokes.
+     */
+    size_t getBoardBytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return boardBytes_;
+    }
+
+    /**
+     * @brief Point slabs waiting for the next live stroke.
+     */
+    size_t getPooledPointBuffers() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pointPool_.cached();
+    }
+
+    /**
+     * @brief Evict the oldest strokes until the board fits in maxBytes.
+     * The newest stroke is always kept.
+     * @return Number of strokes evicted
+     */
+    size_t trimToBytes(size_t maxBytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t evicted = evictOldestUntil(maxBytes);
+        if (evicted > 0) {
+            ++boardVersion_;
+        }
+        return evicted;
+    }
+
+    /**
+     * @brief Release the memory a quiet board only needs to serve joins:
+     *        cached snapshots, stroke fragments, pooled point slabs.
+     *
+     * Called periodically. The room counts as active when its board
+     * changed or a snapshot was encoded since the previous call, and is
+     * hibernated once it has stayed inactive for idleFor, then not again
+     * until it is next active. The strokes and replay log are kept, so
+     * nothing a client sees changes; the next join just encodes again.
+     *
+     * @return true if the room was hibernated by this call
+     */
+    bool hibernate(std::chrono::milliseconds idleFor,
+                   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t activity = boardVersion_ + snapshotCache_.fragmentsEncoded() +
+                            snapshotCache_.framesBuilt();
+        if (activity != lastActivity_) {
+            lastActivity_ = activity;
+            lastActiveAt_ = now;
+            return false;
+        }
+        if (activity == hibernatedActivity_ || now - lastActiveAt_ < idleFor) {
+            return false;
+        }
+        snapshotCache_.clear();
+        strokes_.compact();
+        pointPool_.clear();
+        hibernatedActivity_ = activity;
+        return true;
+    }
+
     // =========================================================================
     // Sequence Numbers
     // =========================================================================
@@ -255,22 +767,106 @@ public:
     // Broadcasting
     // =========================================================================
 
+    /**
+     * @brief Record a board event in the replay log and broadcast it.
+     * @param seq The event's sequence number
+     */
+    void publish(uint64_t seq, const OutboundFrame& message,
+                 const std::string& excludeUserId,
+                 std::function<void(std::shared_ptr<WsSession>)> sendFunc) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replayLog_.append(seq, message);
+        fanOut(Id128::fromText(excludeUserId), sendFunc, &message, seq);
+    }
+
+    /**
+     * @brief publish() for an event on one stroke, sent only to the
+     *        participants who can see it.
+     *
+     * before and after are the stroke's extent around the event. A
+     * participant with a viewport gets the event if the stroke was in
+     * view (so the client holds it), the whole stroke as a region_state
+     * if the event brought it into view, and nothing otherwise.
+     * Participants without a viewport get every event.
+     */
+    void publishStroke(uint64_t seq, const OutboundFrame& message,
+                       const std::string& excludeUserId, const std::string& strokeId,
+                       const Bounds& before, const Bounds& after,
+                       const FrameSendFunc& sendFunc) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replayLog_.append(seq, message);
+
+        int64_t startNs = metricNowNs();
+        uint64_t recipients = 0;
+        Id128 exclude = Id128::fromText(excludeUserId);
+        std::optional<OutboundFrame> region;   // Built for the first viewer that needs it
+        bool regionBuilt = false;
+        for (auto& [key, info] : participants_) {
+            if (key == exclude || seq < info.snapshotSeq) continue;
+            const OutboundFrame* frame = nullptr;
+            if (!info.viewport || before.intersects(*info.viewport)) {
+                frame = &message;
+            } else if (after.intersects(*info.viewport)) {
+                if (!regionBuilt) {
+                    region = snapshotCache_.getStrokeRegion(strokes_, strokeId, currentSequence(),
+                                                            binaryMembers_ > 0);
+                    regionBuilt = true;
+                }
+                if (region) frame = &*region;
+            }
+            if (!frame || hold(key, seq, *frame)) continue;
+            if (auto session = info.session.lock()) {
+                sendFunc(session, *frame);
+                ++recipients;
+            }
+        }
+        ServerMetrics& metrics = ServerMetrics::global();
+        metrics.fanoutNs.recordSince(startNs);
+        metrics.fanoutRecipients.record(recipients);
+    }
+
+    /**
+     * @brief Set the board area a participant is looking at.
+     *
+     * The area is padded by ViewportMargin. If the participant already had
+     * a viewport, the strokes that come into view are sent to it as one
+     * region_state first, in the same critical section, so no event on
+     * them can slip between the frame and the switch.
+     *
+     * @return false if the participant is not in the room
+     */
+    bool setViewport(const std::string& oderId, const Bounds& area,
+                     const FrameSendFunc& sendFunc) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = participants_.find(Id128::fromText(oderId));
+        if (it == participants_.end()) {
+            return false;
+        }
+        UserInfo& info = it->second;
+        Bounds padded = area.expanded(ProtocolConstants::ViewportMargin);
+        if (info.viewport) {
+            auto region = snapshotCache_.getRegion(strokes_, padded, info.viewport,
+                                                   currentSequence(), info.binary);
+            auto session = info.session.lock();
+            if (region && session) {
+                sendFunc(session, *region);
+            }
+        }
+        info.viewport = padded;
+        return true;
+    }
+
     /**
      * @brief Broadcast a message to all participants except one.
-     * @param message The message to send
+     * @param message The serialized frame, shared by all recipients
      * @param excludeUserId User ID to exclude (empty = send to all)
      * @param sendFunc Function to call for each recipient session
      */
-    void broadcast(const std::string& message, 
+    void broadcast(const OutboundFrame& message,
                    const std::string& excludeUserId,
                    std::function<void(std::shared_ptr<WsSession>)> sendFunc) {
         std::lock_guard<std::mutex> lock(mutex_);
-        for (auto& [oderId, info] : participants_) {
-            if (oderId == excludeUserId) continue;
-            if (auto session = info.session.lock()) {
-                sendFunc(session);
-            }
-        }
+        fanOut(Id128::fromText(excludeUserId), sendFunc);
     }
 
     /**
@@ -279,7 +875,7 @@ public:
     void sendTo(const std::string& oderId,
                 std::function<void(std::shared_ptr<WsSession>)> sendFunc) {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = participants_.find(oderId);
+        auto it = participants_.find(Id128::fromText(oderId));
         if (it != participants_.end()) {
             if (auto session = it->second.session.lock()) {
                 sendFunc(session);
@@ -288,25 +884,155 @@ public:
     }
 
 private:
-    /**
-     * @brief Prune old strokes if over limit.
-     * Must be called with mutex held.
-     */
-    void pruneStrokesIfNeeded() {
-        if (strokes_.size() > maxStrokes_) {
-            size_t toRemove = strokes_.size() - maxStrokes_;
-            strokes_.erase(strokes_.begin(), strokes_.begin() + static_cast<std::ptrdiff_t>(toRemove));
+    // Insert or replace a participant, keeping binaryMembers_ in step;
+    // called with mutex_ held
+    void putParticipant(const Id128& key, const UserInfo& info) {
+        auto [it, added] = participants_.try_emplace(key, info);
+        if (!added) {
+            if (it->second.binary) --binaryMembers_;
+            it->second = info;
+        }
+        if (info.binary) ++binaryMembers_;
+    }
+
+    // A resume may take back its old ID; called with mutex_ held
+    bool canReclaim(const ResumePoint& resume) const {
+        if (resume.userId.empty() || resume.epoch != epoch_) {
+            return false;
+        }
+        Id128 key = Id128::fromText(resume.userId);
+        if (participants_.count(key)) {
+            return false;
+        }
+        auto it = resumeTokens_.find(key);
+        if (it == resumeTokens_.end() || it->second.userId != resume.userId) {
+            return false;
+        }
+        // Compare in constant time so the token cannot be probed byte by byte
+        const std::string& expected = it->second.token;
+        if (resume.token.size() != expected.size()) {
+            return false;
+        }
+        unsigned char diff = 0;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            diff |= static_cast<unsigned char>(expected[i] ^ resume.token[i]);
+        }
+        return diff == 0;
+    }
+
+    // New resume token for a participant just admitted; called with
+    // mutex_ held. Tokens outlive their participant (that is what they
+    // are for), so past the cap those of departed users are dropped.
+    std::string issueResumeToken(const Id128& key) {
+        if (resumeTokens_.size() >= ProtocolConstants::ResumeTokensPerRoom) {
+            std::erase_if(resumeTokens_, [this](const auto& entry) {
+                return !participants_.count(entry.first);
+            });
+        }
+        ResumeToken& entry = resumeTokens_[key];
+        entry.userId = participants_.at(key).userId;
+        entry.token = generateSecretToken();
+        return entry.token;
+    }
+
+    // Keep a board event for a participant still waiting for its
+    // snapshot; called with mutex_ held
+    bool hold(const Id128& key, uint64_t seq, const OutboundFrame& frame) {
+        if (held_.empty()) return false;
+        auto it = held_.find(key);
+        if (it == held_.end()) return false;
+        it->second.emplace_back(seq, frame);
+        return true;
+    }
+
+    // Hand a frame to every participant but one; called with mutex_ held.
+    // A board event (with its seq) is held for participants awaiting a
+    // snapshot instead, and skipped for those whose snapshot has it.
+    void fanOut(const Id128& exclude,
+                const std::function<void(std::shared_ptr<WsSession>)>& sendFunc,
+                const OutboundFrame* boardEvent = nullptr, uint64_t seq = 0) {
+        int64_t startNs = metricNowNs();
+        uint64_t recipients = 0;
+        for (auto& [key, info] : participants_) {
+            if (key == exclude) continue;
+            if (boardEvent && (seq < info.snapshotSeq || hold(key, seq, *boardEvent))) continue;
+            if (auto session = info.session.lock()) {
+                sendFunc(session);
+                ++recipients;
+            }
+        }
+        ServerMetrics& metrics = ServerMetrics::global();
+        metrics.fanoutNs.recordSince(startNs);
+        metrics.fanoutRecipients.record(recipients);
+    }
+
+    // Stroke bookkeeping; all called with mutex_ held
+
+    Stroke& pushStroke(Stroke stroke) {
+        if (strokes_.size() == strokes_.capacity()) {
+            account(-static_cast<int64_t>(strokes_.at(0).estimateSize()));
+        }
+        Stroke& stored = *strokes_.push(std::move(stroke));
+        account(static_cast<int64_t>(stored.estimateSize()));
+        return stored;
+    }
+
+    void enforceBudget() {
+        if (byteBudget_ > 0 && boardBytes_ > byteBudget_) {
+            evictOldestUntil(byteBudget_);
+        }
+    }
+
+    size_t evictOldestUntil(size_t maxBytes) {
+        size_t evicted = 0;
+        while (boardBytes_ > maxBytes && strokes_.size() > 1) {
+            auto stroke = strokes_.popOldest();
+            account(-static_cast<int64_t>(stroke->estimateSize()));
+            ++evicted;
+        }
+        if (evicted > 0 && memory_) {
+            memory_->countEvicted(evicted);
+        }
+        return evicted;
+    }
+
+    void account(int64_t deltaBytes) {
+        boardBytes_ = static_cast<size_t>(static_cast<int64_t>(boardBytes_) + deltaBytes);
+        if (memory_) {
+            memory_->add(deltaBytes);
         }
     }
 
     std::string roomId_;
     std::string password_;
-    std::unordered_map<std::string, UserInfo> participants_;
-    std::unordered_map<std::string, CursorState> cursors_;
-    std::vector<Stroke> strokes_;
+    std::string epoch_;
+    std::unordered_map<Id128, UserInfo, Id128Hash> participants_;    // Keyed by Id128 of oderId
+    std::unordered_map<Id128, CursorState, Id128Hash> cursors_;
+    StrokeStore strokes_;
+    PointPool pointPool_;             // Slabs for live strokes (under mutex_)
+    uint64_t boardVersion_ = 0;       // Bumped on every stroke mutation
+    size_t boardBytes_ = 0;           // Sum of estimateSize() over strokes_
+    size_t byteBudget_ = 0;           // 0 = unlimited
+    std::shared_ptr<BoardMemory> memory_;
+    SnapshotCache snapshotCache_;
+    ReplayLog replayLog_;
+    // Last resume token issued per user ID, kept after the user leaves
+    struct ResumeToken {
+        std::string userId;
+        std::string token;
+    };
+    std::unordered_map<Id128, ResumeToken, Id128Hash> resumeTokens_;
+    // Board events (with seqs) for participants awaiting their snapshot
+    std::unordered_map<Id128, std::vector<std::pair<uint64_t, OutboundFrame>>, Id128Hash> held_;
     std::atomic<uint64_t> nextSeq_;
-    size_t maxStrokes_;
+    std::atomic<size_t> binaryMembers_{0};    // Participants with info.binary set
     size_t maxUsers_;
+    Executor executor_;
+    // hibernate(): activity count last seen, when it last changed, and
+    // the count the room was last hibernated at
+    uint64_t lastActivity_ = 0;
+    std::chrono::steady_clock::time_point lastActiveAt_;
+    uint64_t hibernatedActivity_ = 0;
     mutable std::mutex mutex_;
 };
 
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "stroke.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Uniform grid over board space, mapping cells to the keys of the
+ *        boxes that overlap them.
+ *
+ * A box is listed in every cell it touches, so a query only visits the
+ * cells under the query box. Boxes spanning more than MaxCellsPerEntry
+ * cells (a stroke scribbled across the whole board, or one with
+ * non-finite coordinates) go on a side list that every query checks
+ * instead of being copied into thousands of cells.
+ *
+ * Callers pass the same box to erase() that they inserted, and keys must
+ * be unique. Results are candidates: boxes near a query may be returned,
+ * so callers test the real bounds. Not thread-safe.
+ */
+class SpatialGrid {
+public:
+    static constexpr int64_t MaxCellsPerEntry = 64;
+
+    explicit SpatialGrid(float cellSize = ProtocolConstants::SpatialCellSize)
+        : cellSize_(cellSize > 0.0f ? cellSize : ProtocolConstants::SpatialCellSize)
+    {}
+
+    void insert(uint64_t key, const Bounds& box) {
+        if (box.empty()) return;
+        CellRange range = cellsOf(box);
+        if (!range.small()) {
+            large_.push_back(key);
+            return;
+        }
+        for (int64_t cy = range.y0; cy <= range.y1; ++cy) {
+            for (int64_t cx = range.x0; cx <= range.x1; ++cx) {
+                cells_[cellKey(cx, cy)].push_back(key);
+            }
+        }
+        ++entries_;
+    }
+
+    void erase(uint64_t key, const Bounds& box) {
+        if (box.empty()) return;
+        CellRange range = cellsOf(box);
+        if (!range.small()) {
+            removeKey(large_, key);
+            return;
+        }
+        for (int64_t cy = range.y0; cy <= range.y1; ++cy) {
+            for (int64_t cx = range.x0; cx <= range.x1; ++cx) {
+                auto it = cells_.find(cellKey(cx, cy));
+                if (it == cells_.end()) continue;
+                removeKey(it->second, key);
+                if (it->second.empty()) cells_.erase(it);
+            }
+        }
+        --entries_;
+    }
+
+    /**
+     * @brief Re-file a key whose box changed from one to the other. Cheap
+     *        when the box stays within the same cells, as a growing stroke
+     *        mostly does.
+     */
+    void move(uint64_t key, const Bounds& from, const Bounds& to) {
+        if (from.empty() == to.empty() &&
+            (from.empty() || cellsOf(from) == cellsOf(to))) {
+            return;
+        }
+        erase(key, from);
+        insert(key, to);
+    }
+
+    /**
+     * @brief Keys whose boxes may overlap area, ascending, without duplicates.
+     */
+    std::vector<uint64_t> query(const Bounds& area) const {
+        std::vector<uint64_t> keys(large_.begin(), large_.end());
+        if (!area.empty()) {
+            CellRange range = cellsOf(area);
+            if (range.small()) {
+                for (int64_t cy = range.y0; cy <= range.y1; ++cy) {
+                    for (int64_t cx = range.x0; cx <= range.x1; ++cx) {
+                        auto it = cells_.find(cellKey(cx, cy));
+                        if (it != cells_.end()) {
+                            keys.insert(keys.end(), it->second.begin(), it->second.end());
+                        }
+                    }
+                }
+            } else {
+                // Query covers more cells than exist: walk the cells instead
+                for (const auto& [cell, entries] : cells_) {
+                    if (range.contains(cell)) {
+                        keys.insert(keys.end(), entries.begin(), entries.end());
+                    }
+                }
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    size_t size() const { return entries_ + large_.size(); }
+    size_t cellCount() const { return cells_.size(); }
+    float cellSize() const { return cellSize_; }
+
+private:
+    // Cell coordinates are clamped well inside int32 so they pack into one key
+    static constexpr int64_t CellLimit = int64_t{1} << 30;
+
+    struct CellRange {
+        int64_t x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+        bool finite = true;
+
+        bool small() const {
+            return finite && (x1 - x0 + 1) * (y1 - y0 + 1) <= MaxCellsPerEntry;
+        }
+        bool contains(uint64_t key) const {
+            int64_t cx = static_cast<int32_t>(key >> 32);
+            int64_t cy = static_cast<int32_t>(key & 0xFFFFFFFFu);
+            return cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1;
+        }
+        bool operator==(const CellRange&) const = default;
+    };
+
+    CellRange cellsOf(const Bounds& box) const {
+        CellRange range;
+        if (!std::isfinite(box.minX) || !std::isfinite(box.minY) ||
+            !std::isfinite(box.maxX) || !std::isfinite(box.maxY)) {
+            range.finite = false;
+            range.x0 = range.y0 = -CellLimit;
+            range.x1 = range.y1 = CellLimit;
+            return range;
+        }
+        range.x0 = cellOf(box.minX);
+        range.y0 = cellOf(box.minY);
+        range.x1 = cellOf(box.maxX);
+        range.y1 = cellOf(box.maxY);
+        return range;
+    }
+
+    int64_t cellOf(float v) const {
+        double cell = std::floor(static_cast<double>(v) / cellSize_);
+        return static_cast<int64_t>(std::clamp(cell, -static_cast<double>(CellLimit),
+                                               static_cast<double>(CellLimit)));
+    }
+
+    static uint64_t cellKey(int64_t cx, int64_t cy) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) |
+               static_cast<uint32_t>(cy);
+    }
+
+    static void removeKey(std::vector<uint64_t>& keys, uint64_t key) {
+        auto it = std::find(keys.begin(), keys.end(), key);
+        if (it != keys.end()) {
+            *it = keys.back();
+            keys.pop_back();
+        }
+    }
+
+    float cellSize_;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> cells_;
+    std::vector<uint64_t> large_;
+    size_t entries_ = 0;
+};
+
+} // namespace collabboard
@@ -2,7 +2,9 @@
 
 #include <string>
 #include <vector>
+#include <span>
 #include <utility>
+#include <algorithm>
 #include <cstdint>
 
 namespace collabboard {
@@ -18,6 +20,47 @@ struct Point {
     Point(float xPos, float yPos) : x(xPos), y(yPos) {}
 };
 
+/**
+ * @brief Axis-aligned box in board coordinates. Default-constructed it is
+ *        empty: it contains nothing and intersects nothing.
+ */
+struct Bounds {
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = -1.0f;
+    float maxY = -1.0f;
+
+    static Bounds of(float x, float y, float width, float height) {
+        return Bounds{x, y, x + width, y + height};
+    }
+
+    bool empty() const { return !(minX <= maxX && minY <= maxY); }
+
+    bool intersects(const Bounds& other) const {
+        return !empty() && !other.empty() &&
+               minX <= other.maxX && other.minX <= maxX &&
+               minY <= other.maxY && other.minY <= maxY;
+    }
+
+    void include(const Point& pt) {
+        if (empty()) {
+            *this = Bounds{pt.x, pt.y, pt.x, pt.y};
+            return;
+        }
+        minX = std::min(minX, pt.x);
+        minY = std::min(minY, pt.y);
+        maxX = std::max(maxX, pt.x);
+        maxY = std::max(maxY, pt.y);
+    }
+
+    Bounds expanded(float margin) const {
+        if (empty()) return *this;
+        return Bounds{minX - margin, minY - margin, maxX + margin, maxY + margin};
+    }
+
+    bool operator==(const Bounds&) const = default;
+};
+
 /**
  * @brief Represents a drawing stroke on the whiteboard.
  */
@@ -29,11 +72,14 @@ struct Stroke {
     float width;                 // Stroke width in pixels
     bool complete;               // true if stroke_end received
     uint64_t seq;                // Sequence number for ordering
+    uint64_t version;            // Bumped by every mutation (cache key)
+    Bounds bounds;               // Of points; kept by the mutators below
 
     Stroke()
         : width(2.0f)
         , complete(false)
         , seq(0)
+        , version(0)
     {}
 
     Stroke(const std::string& id, const std::string& oderId, 
@@ -44,6 +90,7 @@ struct Stroke {
         , width(w)
         , complete(false)
         , seq(0)
+        , version(0)
     {}
 
     /**
@@ -51,13 +98,28 @@ struct Stroke {
      */
     void addPoint(float x, float y) {
         points.emplace_back(x, y);
+        bounds.include(points.back());
+        ++version;
     }
 
     /**
      * @brief Add multiple points to the stroke.
      */
-    void addPoints(const std::vector<Point>& newPoints) {
+    void addPoints(std::span<const Point> newPoints) {
         points.insert(points.end(), newPoints.begin(), newPoints.end());
+        for (const auto& pt : newPoints) {
+            bounds.include(pt);
+        }
+        ++version;
+    }
+
+    /**
+     * @brief Replace all points (e.g. with a simplified path).
+     */
+    void replacePoints(std::vector<Point> newPoints) {
+        points = std::move(newPoints);
+        recomputeBounds();
+        ++version;
     }
 
     /**
@@ -65,6 +127,7 @@ struct Stroke {
      */
     void finish() {
         complete = true;
+        ++version;
     }
 
     /**
@@ -75,6 +138,28 @@ struct Stroke {
             pt.x += dx;
             pt.y += dy;
         }
+        if (!bounds.empty()) {
+            bounds = Bounds{bounds.minX + dx, bounds.minY + dy, bounds.maxX + dx, bounds.maxY + dy};
+        }
+        ++version;
+    }
+
+    /**
+     * @brief Rebuild bounds after points were assigned or edited directly.
+     */
+    void recomputeBounds() {
+        bounds = Bounds();
+        for (const auto& pt : points) {
+            bounds.include(pt);
+        }
+    }
+
+    /**
+     * @brief Area the stroke covers once drawn: its points' bounds
+     *        widened by half the pen width.
+     */
+    Bounds extent() const {
+        return bounds.expanded(width / 2);
     }
 
     /**
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+#include "stroke.hpp"
+#include "../protocol/message_types.hpp"
+#include "../utils/scratch_arena.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief How finished strokes are compacted before they are stored.
+ *
+ * Pen input arrives at 100+ Hz, mostly as near-collinear runs. Dropping
+ * points that lie within tolerance of the simplified path, and snapping
+ * the rest to a coarse grid, shrinks the stroke in memory and in every
+ * snapshot (a snapped coordinate prints as "12.25", not as the 17 digits
+ * of an arbitrary float). Live stroke_add broadcasts are not affected.
+ */
+struct StrokeCompaction {
+    float tolerance = ProtocolConstants::StrokeSimplifyTolerance;  // px; 0 keeps every point
+    float gridStep = ProtocolConstants::StrokeGridStep;            // px; 0 keeps full precision
+
+    bool enabled() const { return tolerance > 0.0f || gridStep > 0.0f; }
+
+    static StrokeCompaction none() { return StrokeCompaction{0.0f, 0.0f}; }
+};
+
+/**
+ * @brief Ramer-Douglas-Peucker: flag the points of a polyline to keep.
+ *
+ * Keeps the endpoints and every point needed to stay within tolerance of
+ * the input. Iterative, so long strokes cannot overflow the stack; the
+ * distance scan runs over contiguous floats with the segment terms
+ * hoisted, which the compiler can vectorize. keep and ranges are scratch
+ * (any vector type, e.g. std::pmr on a ScratchArena).
+ *
+ * @return Number of points kept
+ */
+template <typename KeepVec, typename RangeVec>
+size_t markSimplified(std::span<const Point> points, float tolerance,
+                      KeepVec& keep, RangeVec& ranges) {
+    keep.assign(points.size(), 0);
+    if (points.size() <= 2 || tolerance <= 0.0f) {
+        std::fill(keep.begin(), keep.end(), 1);
+        return points.size();
+    }
+
+    keep.front() = keep.back() = 1;
+    size_t kept = 2;
+    const float toleranceSq = tolerance * tolerance;
+
+    ranges.clear();
+    ranges.emplace_back(0, points.size() - 1);
+    while (!ranges.empty()) {
+        auto [first, last] = ranges.back();
+        ranges.pop_back();
+        if (last - first < 2) continue;
+
+        // Squared distance from each point to the line through first and last
+        const float ax = points[first].x, ay = points[first].y;
+        const float dx = points[last].x - ax, dy = points[last].y - ay;
+        const float lengthSq = dx * dx + dy * dy;
+
+        size_t farthest = first;
+        float farthestSq = 0.0f;
+        for (size_t i = first + 1; i < last; ++i) {
+            const float px = points[i].x - ax, py = points[i].y - ay;
+            float distSq;
+            if (lengthSq > 0.0f) {
+                const float cross = px * dy - py * dx;
+                distSq = cross * cross / lengthSq;
+            } else {
+                distSq = px * px + py * py;  // Closed loop: distance to the endpoint
+            }
+            if (distSq > farthestSq) {
+                farthestSq = distSq;
+                farthest = i;
+            }
+        }
+
+        if (farthestSq > toleranceSq) {
+            keep[farthest] = 1;
+            ++kept;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Ramer-Douglas-Peucker simplification of a polyline, as a copy.
+ */
+inline std::vector<Point> simplifyPolyline(std::span<const Point> points, float tolerance) {
+    ScratchArena::Scope scratch;
+    std::pmr::vector<uint8_t> keep(scratch.resource());
+    std::pmr::vector<std::pair<size_t, size_t>> ranges(scratch.resource());
+    std::vector<Point> result;
+    result.reserve(markSimplified(points, tolerance, keep, ranges));
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) result.push_back(points[i]);
+    }
+    return result;
+}
+
+/**
+ * @brief Snap points to a grid of the given step and drop repeats.
+ * @return true if any point moved or was dropped
+ */
+inline bool quantizePoints(std::vector<Point>& points, float step) {
+    if (step <= 0.0f || points.empty()) return false;
+
+    const float inverse = 1.0f / step;
+    bool moved = false;
+    size_t out = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        Point snapped(std::nearbyint(points[i].x * inverse) * step,
+                      std::nearbyint(points[i].y * inverse) * step);
+        moved = moved || snapped.x != points[i].x || snapped.y != points[i].y;
+        if (out > 0 && snapped.x == points[out - 1].x && snapped.y == points[out - 1].y) {
+            continue;
+        }
+        points[out++] = snapped;
+    }
+    bool dropped = out != points.size();
+    points.resize(out);
+    return moved || dropped;
+}
+
+/**
+ * @brief Simplify then quantize a stroke's points in place.
+ *
+ * Works inside the stroke's own buffer, with the simplification's scratch
+ * on the thread's ScratchArena, so compacting allocates nothing.
+ *
+ * @return true if the points changed
+ */
+inline bool compactStroke(Stroke& stroke, const StrokeCompaction& compaction) {
+    if (!compaction.enabled() || stroke.points.empty()) {
+        return false;
+    }
+
+    bool changed = false;
+    if (compaction.tolerance > 0.0f) {
+        ScratchArena::Scope scratch;
+        std::pmr::vector<uint8_t> keep(scratch.resource());
+        std::pmr::vector<std::pair<size_t, size_t>> ranges(scratch.resource());
+        size_t kept = markSimplified(stroke.points, compaction.tolerance, keep, ranges);
+        if (kept != stroke.points.size()) {
+            size_t out = 0;
+            for (size_t i = 0; i < stroke.points.size(); ++i) {
+                if (keep[i]) stroke.points[out++] = stroke.points[i];
+            }
+            stroke.points.resize(out);
+            changed = true;
+        }
+    }
+    changed = quantizePoints(stroke.points, compaction.gridStep) || changed;
+
+    if (changed) {
+        stroke.recomputeBounds();
+        ++stroke.version;
+    }
+    return changed;
+}
+
+} // namespace collabboard
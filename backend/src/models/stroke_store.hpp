@@ -0,0 +1,292 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+#include "stroke.hpp"
+#include "spatial_grid.hpp"
+#include "../utils/id128.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief One stroke's snapshot entry as of version: JSON, and binary if
+ *        a binary client has needed it (empty otherwise).
+ *
+ * Never changed once built, so a snapshot being assembled outside the
+ * room lock can hold on to it while the slot moves on.
+ */
+struct EncodedStroke {
+    uint64_t version = 0;
+    std::string json;
+    std::string binary;
+};
+
+/**
+ * @brief A slot's cached encoding, kept by the snapshot encoder.
+ *
+ * Current while encoded->version matches the stroke's (and, for a
+ * binary snapshot, it has the binary entry); cleared when the slot is
+ * reused for a new stroke.
+ */
+struct StrokeFragment {
+    std::shared_ptr<const EncodedStroke> encoded;
+
+    bool current(const Stroke& stroke, bool binary) const {
+        return encoded && encoded->version == stroke.version &&
+               (!binary || !encoded->binary.empty());
+    }
+};
+
+/**
+ * @brief Fixed-capacity circular store of strokes with an id index.
+ *
+ * Strokes are kept oldest to newest in a ring of slots. Appending to a full
+ * store evicts the oldest stroke in O(1): its slot is reused and no other
+ * stroke moves. popOldest() frees the oldest slot the same way. Each stroke lives in its own heap allocation, so a handle
+ * (shared_ptr) taken from the store stays valid even after eviction.
+ *
+ * Each slot also carries the stroke's cached StrokeFragment, so a completed
+ * stroke is encoded once for all the snapshots it appears in.
+ *
+ * The index maps the stroke's Id128 to its ordinal (its insertion count);
+ * the stroke sits ordinal - firstOrdinal_ places after the oldest, so
+ * eviction never reindexes. Stroke IDs come from clients, so a hit is
+ * checked against the stroke's own text before it is returned.
+ *
+ * A SpatialGrid keyed by the same ordinals indexes each stroke's extent().
+ * The store files a stroke when it is pushed; whoever changes a stored
+ * stroke's points calls reindex() afterwards (Room does, in withStroke()).
+ *
+ * Not thread-safe; Room guards it with its mutex.
+ */
+class StrokeStore {
+public:
+    explicit StrokeStore(size_t capacity)
+        : capacity_(std::max<size_t>(capacity, 1))
+    {}
+
+    /**
+     * @brief Append a stroke, evicting the oldest one if full.
+     *
+     * If a stroke with the same ID is already stored, find() keeps
+     * resolving to the earlier one.
+     *
+     * @return Handle to the stored stroke
+     */
+    std::shared_ptr<Stroke> push(Stroke stroke) {
+        auto handle = std::make_shared<Stroke>(std::move(stroke));
+        uint64_t ordinal = firstOrdinal_ + count_;
+        Bounds extent = handle->extent();
+
+        if (count_ == capacity_) {
+            // Full: the oldest slot becomes the newest. Unindex it first,
+            // or a new stroke reusing its ID would lose its index entry.
+            Slot& slot = slots_[head_];
+            evictIndexEntry(slot, firstOrdinal_);
+            index(handle->strokeId, ordinal, extent);
+            slot.stroke = handle;
+            slot.fragment = StrokeFragment{};
+            slot.indexed = extent;
+            head_ = (head_ + 1) % capacity_;
+            ++firstOrdinal_;
+            return handle;
+        }
+
+        index(handle->strokeId, ordinal, extent);
+        if (count_ == slots_.size()) {
+            // Grow; only after popOldest() does the ring not start at 0
+            std::rotate(slots_.begin(), slots_.begin() + head_, slots_.end());
+            head_ = 0;
+            slots_.push_back(Slot{handle, {}, extent});
+        } else {
+            Slot& slot = slots_[(head_ + count_) % slots_.size()];
+            slot.stroke = handle;
+            slot.fragment = StrokeFragment{};
+            slot.indexed = extent;
+        }
+        ++count_;
+        return handle;
+    }
+
+    /**
+     * @brief Evict the oldest stroke (e.g. to stay within a byte budget).
+     * @return Handle to the evicted stroke, or nullptr if empty
+     */
+    std::shared_ptr<Stroke> popOldest() {
+        if (count_ == 0) {
+            return nullptr;
+        }
+        Slot& slot = slots_[head_];
+        evictIndexEntry(slot, firstOrdinal_);
+        std::shared_ptr<Stroke> evicted = std::move(slot.stroke);
+        slot.fragment = StrokeFragment{};
+        head_ = (head_ + 1) % slots_.size();
+        --count_;
+        ++firstOrdinal_;
+        return evicted;
+    }
+
+    /**
+     * @brief Look up a stroke by ID.
+     * @return Handle, or nullptr if not stored
+     */
+    std::shared_ptr<Stroke> find(const std::string& strokeId) const {
+        auto it = index_.find(Id128::fromText(strokeId));
+        if (it == index_.end()) {
+            return nullptr;
+        }
+        const auto& stroke = slotAt(static_cast<size_t>(it->second - firstOrdinal_)).stroke;
+        return stroke->strokeId == strokeId ? stroke : nullptr;
+    }
+
+    /**
+     * @brief Re-file a stroke in the spatial index after its points changed.
+     */
+    void reindex(const std::string& strokeId) {
+        auto it = index_.find(Id128::fromText(strokeId));
+        if (it == index_.end()) {
+            return;
+        }
+        Slot& slot = slotAt(static_cast<size_t>(it->second - firstOrdinal_));
+        Bounds extent = slot.stroke->extent();
+        grid_.move(it->second, slot.indexed, extent);
+        slot.indexed = extent;
+    }
+
+    /**
+     * @brief Visit the strokes whose extent overlaps area, oldest first,
+     *        with their fragments.
+     * @param fn Called as fn(const Stroke&, StrokeFragment&)
+     */
+    template<typename Fn>
+    void forEachIn(const Bounds& area, Fn&& fn) {
+        for (uint64_t ordinal : grid_.query(area)) {
+            Slot& slot = slotAt(static_cast<size_t>(ordinal - firstOrdinal_));
+            if (slot.indexed.intersects(area)) {
+                fn(static_cast<const Stroke&>(*slot.stroke), slot.fragment);
+            }
+        }
+    }
+
+    /**
+     * @brief Run fn(const Stroke&, StrokeFragment&) on one stroke.
+     * @return false if it is not stored
+     */
+    template<typename Fn>
+    bool withFragment(const std::string& strokeId, Fn&& fn) {
+        auto it = index_.find(Id128::fromText(strokeId));
+        if (it == index_.end()) {
+            return false;
+        }
+        Slot& slot = slotAt(static_cast<size_t>(it->second - firstOrdinal_));
+        if (slot.stroke->strokeId != strokeId) {
+            return false;
+        }
+        fn(static_cast<const Stroke&>(*slot.stroke), slot.fragment);
+        return true;
+    }
+
+    /**
+     * @brief Stroke at a position, 0 being the oldest.
+     */
+    const Stroke& at(size_t position) const {
+        return *slotAt(position).stroke;
+    }
+
+    /**
+     * @brief Visit the newest strokes, oldest first, with their fragments.
+     * @param fn Called as fn(const Stroke&, StrokeFragment&)
+     */
+    template<typename Fn>
+    void forEachNewest(size_t limit, Fn&& fn) {
+        size_t count = std::min(limit, size());
+        for (size_t i = size() - count; i < size(); ++i) {
+            Slot& slot = slotAt(i);
+            fn(static_cast<const Stroke&>(*slot.stroke), slot.fragment);
+        }
+    }
+
+    /**
+     * @brief Copy out the newest strokes, oldest first.
+     */
+    std::vector<Stroke> copyNewest(size_t limit) const {
+        size_t count = std::min(limit, size());
+        std::vector<Stroke> strokes;
+        strokes.reserve(count);
+        for (size_t i = size() - count; i < size(); ++i) {
+            strokes.push_back(at(i));
+        }
+        return strokes;
+    }
+
+    /**
+     * @brief Drop every cached fragment and give back the slots popOldest()
+     *        left empty, for a room that has gone quiet.
+     * @return Bytes of fragment text released
+     */
+    size_t compact() {
+        size_t released = 0;
+        for (Slot& slot : slots_) {
+            if (slot.fragment.encoded) {
+                released += slot.fragment.encoded->json.capacity() +
+                            slot.fragment.encoded->binary.capacity();
+            }
+            slot.fragment = StrokeFragment{};
+        }
+        if (count_ < slots_.size()) {
+            std::rotate(slots_.begin(), slots_.begin() + head_, slots_.end());
+            head_ = 0;
+            slots_.erase(slots_.begin() + count_, slots_.end());
+            slots_.shrink_to_fit();
+        }
+        return released;
+    }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return count_ == 0; }
+
+private:
+    struct Slot {
+        std::shared_ptr<Stroke> stroke;
+        StrokeFragment fragment;
+        Bounds indexed;               // Extent the grid has on file
+    };
+
+    const Slot& slotAt(size_t position) const {
+        return slots_[(head_ + position) % slots_.size()];
+    }
+
+    Slot& slotAt(size_t position) {
+        return slots_[(head_ + position) % slots_.size()];
+    }
+
+    void index(const std::string& strokeId, uint64_t ordinal, const Bounds& extent) {
+        index_.try_emplace(Id128::fromText(strokeId), ordinal);
+        grid_.insert(ordinal, extent);
+    }
+
+    void evictIndexEntry(const Slot& slot, uint64_t ordinal) {
+        grid_.erase(ordinal, slot.indexed);
+        // Only drop the entry if it points at this stroke (IDs may repeat)
+        auto it = index_.find(Id128::fromText(slot.stroke->strokeId));
+        if (it != index_.end() && it->second == ordinal) {
+            index_.erase(it);
+        }
+    }
+
+    size_t capacity_;
+    std::vector<Slot> slots_;
+    size_t head_ = 0;                 // Slot of the oldest stroke
+    size_t count_ = 0;                // Strokes stored (slots_ may hold more)
+    uint64_t firstOrdinal_ = 0;       // Ordinal of the oldest stroke
+    std::unordered_map<Id128, uint64_t, Id128Hash> index_;
+    SpatialGrid grid_;
+};
+
+} // namespace collabboard
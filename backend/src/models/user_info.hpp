@@ -3,6 +3,10 @@
 #include <string>
 #include <chrono>
 #include <memory>
+#include <optional>
+
+#include "stroke.hpp"
+#include "../utils/token_bucket.hpp"
 
 namespace collabboard {
 
@@ -19,6 +23,10 @@ struct UserInfo {
     std::weak_ptr<WsSession> session;  // Connection reference
     std::chrono::steady_clock::time_point lastActivity;  // For ghost detection
     bool isActive;               // false if ghost/disconnected
+    TokenBucket cursorBucket;    // Cursor move rate limit (guarded by the room)
+    std::optional<Bounds> viewport;  // Board area the client shows, with margin (none = all)
+    uint64_t snapshotSeq = 0;    // Board events below this came in its snapshot (guarded by the room)
+    bool binary = false;         // Negotiated the binary protocol
 
     UserInfo() 
         : lastActivity(std::chrono::steady_clock::now())
@@ -74,6 +82,7 @@ struct CursorState {
     float y = 0.0f;
     std::chrono::steady_clock::time_point lastUpdate;
     bool visible = true;
+    bool dirty = false;   // Moved since the last presence tick
 
     CursorState() : lastUpdate(std::chrono::steady_clock::now()) {}
 
@@ -90,6 +99,7 @@ struct CursorState {
         y = newY;
         lastUpdate = std::chrono::steady_clock::now();
         visible = true;
+        dirty = true;
     }
 
     bool isStale(int64_t timeoutMs = 3000) const {
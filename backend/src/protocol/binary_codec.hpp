@@ -0,0 +1,478 @@
+#pragma once
+
+#include <bit>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstdint>
+#include <cstring>
+
+#include "message_types.hpp"
+#include "client_messages.hpp"
+#include "../models/user_info.hpp"
+#include "../models/stroke.hpp"
+#include "../utils/id128.hpp"
+
+namespace collabboard {
+
+/**
+ * Binary wire format (WebSocket binary frames), negotiated per session by
+ * sending "binary": true in join_room. Control messages stay JSON.
+ *
+ *   header  := u8 tag, varint seq
+ *   varint  := unsigned LEB128
+ *   f32     := IEEE-754 float, little-endian
+ *   str     := varint length, UTF-8 bytes
+ *   id      := varint 2n, n UTF-8 bytes
+ *            | varint 2n+1, n prefix bytes, 16 UUID bytes
+ *   points  := varint count, count x (f32 x, f32 y)
+ *
+ * An id ending in a lowercase canonical UUID ("3f2a...", "user-3f2a...")
+ * is sent as its prefix and the UUID's raw 16 bytes, 17-22 bytes instead
+ * of 37-42; the receiver rebuilds the exact text. Other ids go as text.
+ *
+ * Server -> client bodies:
+ *   cursor_move   id userId, f32 x, f32 y
+ *   cursor_batch  varint n, n x (id userId, f32 x, f32 y)
+ *   stroke_start  id strokeId, id userId, str color, f32 width
+ *   stroke_add    id strokeId, id userId, points
+ *   stroke_end    id strokeId, id userId
+ *   stroke_move   id strokeId, id userId, f32 dx, f32 dy
+ *   room_state    varint snapshotSeq, varint n, n x stroke
+ *   room_state_begin  varint snapshotSeq, varint strokeCount, varint chunkCount
+ *   room_state_chunk  varint snapshotSeq, varint index, varint n, n x stroke
+ *   room_state_end    varint snapshotSeq
+ *   batch         varint n, n x (varint length, message bytes)
+ *   region_state      varint regionSeq, varint n, n x stroke
+ *
+ *   stroke  := id strokeId, id userId, str color, f32 width, u8 complete,
+ *              varint seq, points
+ *
+ * Client -> server bodies are the same minus userId (the server knows the
+ * sender); cursor_batch, the room_state family, region_state and batch are
+ * server-only. viewport is JSON only.
+ */
+static_assert(std::endian::native == std::endian::little,
+              "Binary protocol encoder assumes a little-endian host");
+
+namespace BinaryTag {
+    constexpr uint8_t CursorMove  = 0x01;
+    constexpr uint8_t CursorBatch = 0x02;
+    constexpr uint8_t StrokeStart = 0x03;
+    constexpr uint8_t StrokeAdd   = 0x04;
+    constexpr uint8_t StrokeEnd   = 0x05;
+    constexpr uint8_t StrokeMove  = 0x06;
+    constexpr uint8_t RoomState   = 0x07;
+    constexpr uint8_t Batch       = 0x08;
+    constexpr uint8_t RoomStateBegin = 0x09;
+    constexpr uint8_t RoomStateChunk = 0x0A;
+    constexpr uint8_t RoomStateEnd   = 0x0B;
+    constexpr uint8_t RegionState    = 0x0C;
+}
+
+/**
+ * @brief Appends binary protocol fields to a byte string.
+ */
+class BinaryWriter {
+public:
+    explicit BinaryWriter(size_t reserveBytes = 64) {
+        out_.reserve(reserveBytes);
+    }
+
+    void header(uint8_t tag, uint64_t seq) {
+        u8(tag);
+        varint(seq);
+    }
+
+    void u8(uint8_t value) {
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void varint(uint64_t value) {
+        appendVarint(out_, value);
+    }
+
+    void f32(float value) {
+        char bytes[sizeof(float)];
+        std::memcpy(bytes, &value, sizeof(float));
+        out_.append(bytes, sizeof(float));
+    }
+
+    void str(std::string_view value) {
+        varint(value.size());
+        out_.append(value);
+    }
+
+    void id(std::string_view value) {
+        if (value.size() >= Id128::UuidLength) {
+            size_t prefix = value.size() - Id128::UuidLength;
+            if (auto uuid = Id128::parseUuid(value.substr(prefix))) {
+                varint(2 * prefix + 1);
+                out_.append(value.substr(0, prefix));
+                uuid->appendBytes(out_);
+                return;
+            }
+        }
+        varint(2 * value.size());
+        out_.append(value);
+    }
+
+    void points(std::span<const Point> pts) {
+        varint(pts.size());
+        size_t offset = out_.size();
+        out_.resize(offset + pts.size() * 2 * sizeof(float));
+        char* dst = out_.data() + offset;
+        for (const auto& pt : pts) {
+            std::memcpy(dst, &pt.x, sizeof(float));
+            std::memcpy(dst + sizeof(float), &pt.y, sizeof(float));
+            dst += 2 * sizeof(float);
+        }
+    }
+
+    /**
+     * @brief Append bytes that are already encoded.
+     */
+    void bytes(std::string_view encoded) {
+        out_.append(encoded);
+    }
+
+    std::string take() { return std::move(out_); }
+
+    /**
+     * @brief Append an unsigned LEB128 varint.
+     * @return Number of bytes written (1-10)
+     */
+    static size_t appendVarint(std::string& out, uint64_t value) {
+        size_t written = 0;
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            if (value != 0) byte |= 0x80;
+            out.push_back(static_cast<char>(byte));
+            ++written;
+        } while (value != 0);
+        return written;
+    }
+
+private:
+    std::string out_;
+};
+
+/**
+ * @brief Reads binary protocol fields from a byte view.
+ *
+ * Reads past the end or malformed varints put the reader in a failed
+ * state; subsequent reads return zero values. Check ok() once at the end.
+ */
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view bytes)
+        : bytes_(bytes), pos_(0), failed_(false) {}
+
+    uint8_t u8() {
+        if (!require(1)) return 0;
+        return static_cast<uint8_t>(bytes_[pos_++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!require(1)) return 0;
+            uint8_t byte = static_cast<uint8_t>(bytes_[pos_++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        failed_ = true;
+        return 0;
+    }
+
+    float f32() {
+        if (!require(sizeof(float))) return 0.0f;
+        float value;
+        std::memcpy(&value, bytes_.data() + pos_, sizeof(float));
+        pos_ += sizeof(float);
+        return value;
+    }
+
+    std::string str() {
+        uint64_t length = varint();
+        if (!require(length)) return {};
+        std::string value(bytes_.substr(pos_, length));
+        pos_ += length;
+        return value;
+    }
+
+    std::string id() {
+        uint64_t header = varint();
+        uint64_t length = header / 2;
+        bool compact = header % 2 == 1;
+        if (!require(length) || (compact && !require(length + 16))) return {};
+
+        std::string value(bytes_.substr(pos_, length));
+        pos_ += length;
+        if (compact) {
+            value.reserve(length + Id128::UuidLength);
+            Id128::fromBytes(bytes_.data() + pos_).appendUuid(value);
+            pos_ += 16;
+        }
+        return value;
+    }
+
+    std::vector<Point> points(size_t maxCount) {
+        uint64_t count = varint();
+        if (count > maxCount) {
+            failed_ = true;
+            return {};
+        }
+        if (!require(count * 2 * sizeof(float))) return {};
+
+        std::vector<Point> pts(count);
+        const char* src = bytes_.data() + pos_;
+        for (auto& pt : pts) {
+            std::memcpy(&pt.x, src, sizeof(float));
+            std::memcpy(&pt.y, src + sizeof(float), sizeof(float));
+            src += 2 * sizeof(float);
+        }
+        pos_ += count * 2 * sizeof(float);
+        return pts;
+    }
+
+    bool ok() const { return !failed_; }
+    bool atEnd() const { return pos_ == bytes_.size(); }
+    size_t position() const { return pos_; }
+
+private:
+    bool require(uint64_t n) {
+        if (failed_ || n > bytes_.size() - pos_) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    std::string_view bytes_;
+    size_t pos_;
+    bool failed_;
+};
+
+/**
+ * @brief A decoded client -> server binary message.
+ * Only the fields used by the message type are set.
+ */
+struct BinaryClientMessage {
+    MessageType type = MessageType::Unknown;
+    uint64_t seq = 0;
+    std::string strokeId;
+    std::string color;
+    float x = 0.0f;        // cursor x, or dx for stroke_move
+    float y = 0.0f;        // cursor y, or dy for stroke_move
+    float width = 0.0f;
+    std::vector<Point> points;
+};
+
+/**
+ * @brief Encodes server messages and decodes client messages in the binary format.
+ */
+class BinaryCodec {
+public:
+    // =========================================================================
+    // Encoding (Server -> Client)
+    // =========================================================================
+
+    static std::string encodeCursorMove(const std::string& oderId,
+                                        float x, float y, uint64_t seq) {
+        BinaryWriter w(16 + oderId.size());
+        w.header(BinaryTag::CursorMove, seq);
+        w.id(oderId);
+        w.f32(x);
+        w.f32(y);
+        return w.take();
+    }
+
+    static std::string encodeCursorBatch(const std::vector<CursorState>& cursors,
+                                         uint64_t seq) {
+        BinaryWriter w(16 + cursors.size() * 48);
+        w.header(BinaryTag::CursorBatch, seq);
+        w.varint(cursors.size());
+        for (const auto& cursor : cursors) {
+            w.id(cursor.oderId);
+            w.f32(cursor.x);
+            w.f32(cursor.y);
+        }
+        return w.take();
+    }
+
+    static std::string encodeStrokeStart(const std::string& strokeId,
+                                         const std::string& oderId,
+                                         const std::string& color,
+                                         float width, uint64_t seq) {
+        BinaryWriter w(96);
+        w.header(BinaryTag::StrokeStart, seq);
+        w.id(strokeId);
+        w.id(oderId);
+        w.str(color);
+        w.f32(width);
+        return w.take();
+    }
+
+    static std::string encodeStrokeAdd(const std::string& strokeId,
+                                       const std::string& oderId,
+                                       std::span<const Point> points,
+                                       uint64_t seq) {
+        BinaryWriter w(96 + points.size() * 2 * sizeof(float));
+        w.header(BinaryTag::StrokeAdd, seq);
+        w.id(strokeId);
+        w.id(oderId);
+        w.points(points);
+        return w.take();
+    }
+
+    static std::string encodeStrokeEnd(const std::string& strokeId,
+                                       const std::string& oderId, uint64_t seq) {
+        BinaryWriter w(96);
+        w.header(BinaryTag::StrokeEnd, seq);
+        w.id(strokeId);
+        w.id(oderId);
+        return w.take();
+    }
+
+    static std::string encodeStrokeMove(const std::string& strokeId,
+                                        const std::string& oderId,
+                                        float dx, float dy, uint64_t seq) {
+        BinaryWriter w(96);
+        w.header(BinaryTag::StrokeMove, seq);
+        w.id(strokeId);
+        w.id(oderId);
+        w.f32(dx);
+        w.f32(dy);
+        return w.take();
+    }
+
+    static std::string encodeRoomState(const std::vector<Stroke>& strokes,
+                                       uint64_t snapshotSeq, uint64_t seq) {
+        size_t estimate = 16;
+        for (const auto& stroke : strokes) {
+            estimate += 96 + stroke.points.size() * 2 * sizeof(float);
+        }
+
+        BinaryWriter w(estimate);
+        w.header(BinaryTag::RoomState, seq);
+        w.varint(snapshotSeq);
+        w.varint(strokes.size());
+        for (const auto& stroke : strokes) {
+            writeStroke(w, stroke);
+        }
+        return w.take();
+    }
+
+    /**
+     * @brief Write one room_state stroke entry.
+     */
+    static void writeStroke(BinaryWriter& w, const Stroke& stroke) {
+        w.id(stroke.strokeId);
+        w.id(stroke.oderId);
+        w.str(stroke.color);
+        w.f32(stroke.width);
+        w.u8(stroke.complete ? 1 : 0);
+        w.varint(stroke.seq);
+        w.points(stroke.points);
+    }
+
+    /**
+     * @brief Read one stroke entry written by writeStroke().
+     * Check r.ok() afterwards.
+     */
+    static Stroke readStroke(BinaryReader& r) {
+        Stroke stroke;
+        stroke.strokeId = r.id();
+        stroke.oderId = r.id();
+        stroke.color = r.str();
+        stroke.width = r.f32();
+        stroke.complete = r.u8() != 0;
+        stroke.seq = r.varint();
+        stroke.points = r.points(ProtocolConstants::MaxPointsPerStroke);
+        stroke.recomputeBounds();
+        return stroke;
+    }
+
+    // =========================================================================
+    // Decoding (Client -> Server)
+    // =========================================================================
+
+    /**
+     * @brief Decode a client binary message.
+     * @return The message, or nullopt if it is truncated, has trailing bytes,
+     *         uses a tag clients may not send, or breaks the field rules in
+     *         client_messages.hpp (the same ones the JSON decoder applies)
+     */
+    static std::optional<BinaryClientMessage> decodeClient(std::string_view bytes) {
+        BinaryReader r(bytes);
+        BinaryClientMessage msg;
+
+        uint8_t tag = r.u8();
+        msg.seq = r.varint();
+
+        switch (tag) {
+            case BinaryTag::CursorMove:
+                msg.type = MessageType::CursorMove;
+                msg.x = r.f32();
+                msg.y = r.f32();
+                break;
+
+            case BinaryTag::StrokeStart:
+                msg.type = MessageType::StrokeStart;
+                msg.strokeId = r.id();
+                msg.color = r.str();
+                msg.width = r.f32();
+                break;
+
+            case BinaryTag::StrokeAdd:
+                msg.type = MessageType::StrokeAdd;
+                msg.strokeId = r.id();
+                msg.points = r.points(ProtocolConstants::MaxPointsPerStroke);
+                break;
+
+            case BinaryTag::StrokeEnd:
+                msg.type = MessageType::StrokeEnd;
+                msg.strokeId = r.id();
+                break;
+
+            case BinaryTag::StrokeMove:
+                msg.type = MessageType::StrokeMove;
+                msg.strokeId = r.id();
+                msg.x = r.f32();
+                msg.y = r.f32();
+                break;
+
+            default:
+                return std::nullopt;
+        }
+
+        if (!r.ok() || !r.atEnd() || !isValid(msg)) {
+            return std::nullopt;
+        }
+        return msg;
+    }
+
+private:
+    static bool isValid(const BinaryClientMessage& msg) {
+        switch (msg.type) {
+            case MessageType::CursorMove:
+                return collabboard::isValid(CursorMoveMsg{msg.x, msg.y});
+            case MessageType::StrokeStart:
+                return collabboard::isValid(StrokeStartMsg{msg.strokeId, msg.color, msg.width});
+            case MessageType::StrokeAdd:
+                return collabboard::isValid(StrokeAddMsg{msg.strokeId, msg.points});
+            case MessageType::StrokeEnd:
+                return collabboard::isValid(StrokeEndMsg{msg.strokeId});
+            case MessageType::StrokeMove:
+                return collabboard::isValid(StrokeMoveMsg{msg.strokeId, msg.x, msg.y});
+            default:
+                return false;
+        }
+    }
+};
+
+} // namespace collabboard
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <cmath>
+
+#include "message_types.hpp"
+#include "../models/stroke.hpp"
+
+namespace collabboard {
+
+/**
+ * Typed client -> server messages handed to MessageHandler by the JSON and
+ * binary decoders. String and point fields are views into the decoder's
+ * buffers and are valid only until the next message is decoded.
+ */
+
+struct JoinRoomMsg {
+    std::string_view roomId;
+    std::string_view userName;
+    std::string_view password;   // Empty if not given
+    bool binary = false;         // Client asked for binary frames
+    bool chunked = false;        // Client understands chunked room_state
+    std::optional<Bounds> viewport;  // Board area in view; nullopt = whole board
+};
+
+struct ResumeMsg {
+    JoinRoomMsg join;
+    std::string_view userId;     // ID from the earlier welcome (may be empty)
+    std::string_view epoch;      // Room epoch from the earlier welcome
+    uint64_t lastSeq = 0;        // Highest board seq the client applied
+    std::string_view resumeToken;  // resumeToken from the earlier welcome
+};
+
+struct CursorMoveMsg {
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+struct StrokeStartMsg {
+    std::string_view strokeId;
+    std::string_view color;
+    float width = 0.0f;
+};
+
+struct StrokeAddMsg {
+    std::string_view strokeId;
+    std::span<const Point> points;
+};
+
+struct StrokeEndMsg {
+    std::string_view strokeId;
+};
+
+struct StrokeMoveMsg {
+    std::string_view strokeId;
+    float dx = 0.0f;
+    float dy = 0.0f;
+};
+
+struct ViewportMsg {
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+};
+
+struct PingMsg {
+    uint64_t seq = 0;
+};
+
+// =============================================================================
+// Field Rules
+// =============================================================================
+
+/**
+ * Both decoders drop messages that break these, so whatever reaches a room
+ * can be echoed into JSON text frames and snapshots as is: stroke IDs are
+ * printable ASCII, colors are CSS hex, and coordinates are finite.
+ */
+
+/**
+ * @brief At most MaxStrokeIdLength of printable ASCII (UUIDs and the
+ *        frontend's "txt:<base64>" IDs both fit).
+ */
+inline bool isValidStrokeId(std::string_view id) {
+    if (id.size() > ProtocolConstants::MaxStrokeIdLength) {
+        return false;
+    }
+    for (char c : id) {
+        if (c < 0x20 || c > 0x7E) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief "#rgb", "#rrggbb" or "#rrggbbaa".
+ */
+inline bool isValidColor(std::string_view color) {
+    if (color.size() != 4 && color.size() != 7 && color.size() != 9) {
+        return false;
+    }
+    if (color[0] != '#') return false;
+    for (char c : color.substr(1)) {
+        bool hex = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        if (!hex) return false;
+    }
+    return true;
+}
+
+inline bool isFinite(const Point& pt) {
+    return std::isfinite(pt.x) && std::isfinite(pt.y);
+}
+
+inline bool isValid(const CursorMoveMsg& msg) {
+    return std::isfinite(msg.x) && std::isfinite(msg.y);
+}
+
+inline bool isValid(const StrokeStartMsg& msg) {
+    return isValidStrokeId(msg.strokeId) && isValidColor(msg.color) && std::isfinite(msg.width);
+}
+
+inline bool isValid(const StrokeAddMsg& msg) {
+    if (!isValidStrokeId(msg.strokeId)) return false;
+    for (const auto& pt : msg.points) {
+        if (!isFinite(pt)) return false;
+    }
+    return true;
+}
+
+inline bool isValid(const StrokeEndMsg& msg) {
+    return isValidStrokeId(msg.strokeId);
+}
+
+inline bool isValid(const StrokeMoveMsg& msg) {
+    return isValidStrokeId(msg.strokeId) && std::isfinite(msg.dx) && std::isfinite(msg.dy);
+}
+
+inline bool isValid(const ViewportMsg& msg) {
+    return std::isfinite(msg.x) && std::isfinite(msg.y) &&
+           std::isfinite(msg.width) && std::isfinite(msg.height);
+}
+
+} // namespace collabboard
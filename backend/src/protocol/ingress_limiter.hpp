@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "message_types.hpp"
+#include "../utils/token_bucket.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Per-session ingress budgets and escalation.
+ */
+struct IngressPolicy {
+    bool enabled = true;
+    double messagesPerSecond = ProtocolConstants::IngressMessagesPerSecond;
+    double messageBurst = ProtocolConstants::IngressMessageBurst;
+    double pointsPerSecond = ProtocolConstants::IngressPointsPerSecond;
+    double pointBurst = ProtocolConstants::IngressPointBurst;
+    double bytesPerSecond = ProtocolConstants::IngressBytesPerSecond;
+    double byteBurst = ProtocolConstants::IngressByteBurst;
+    int violationsBeforeMute = ProtocolConstants::IngressViolationsBeforeMute;
+    int64_t muteDurationMs = ProtocolConstants::RateLimitMuteDurationMs;
+    int mutesBeforeShed = ProtocolConstants::IngressMutesBeforeShed;
+};
+
+/**
+ * @brief What to do with an incoming message.
+ */
+enum class IngressVerdict {
+    Allow,    // Within budget
+    Reject,   // Over budget: drop it and tell the client (RATE_LIMITED)
+    Drop,     // Over budget, client already told: drop it silently
+    Shed      // Repeat offender: disconnect the session
+};
+
+/**
+ * @brief Token buckets for one session's messages, stroke points and bytes.
+ *
+ * Same escalation as MutingRateLimiter: every rejected message counts as
+ * a violation, every violationsBeforeMute violations mute the session
+ * (everything dropped) for muteDurationMs, and the mutesBeforeShed-th
+ * time it would be muted it is shed instead.
+ * Only the first rejection of a run is reported, so a flood does not
+ * turn into a flood of error frames.
+ *
+ * Owned by the session's MessageHandler and called for one message at a
+ * time, so it needs no locking.
+ */
+class IngressLimiter {
+public:
+    explicit IngressLimiter(const IngressPolicy& policy = IngressPolicy())
+        : policy_(policy)
+        , messageRate_(policy.messagesPerSecond, policy.messageBurst)
+        , pointRate_(policy.pointsPerSecond, policy.pointBurst)
+        , byteRate_(policy.bytesPerSecond, policy.byteBurst)
+    {}
+
+    /**
+     * @brief Charge one message of the given size, before it is decoded.
+     */
+    IngressVerdict admitMessage(size_t bytes, int64_t nowNs = CoarseClock::nowNs()) {
+        if (!policy_.enabled) return IngressVerdict::Allow;
+        if (muted(nowNs)) return IngressVerdict::Drop;
+
+        int64_t byteCost = byteRate_.costNs(static_cast<double>(bytes));
+        if (messages_.creditNs(messageRate_, nowNs) < messageRate_.intervalNs ||
+            bytes_.creditNs(byteRate_, nowNs) < byteCost) {
+            return violation(nowNs);
+        }
+        messages_.tryConsume(messageRate_, nowNs);
+        bytes_.tryConsume(byteRate_, byteCost, nowNs);
+        return allowed();
+    }
+
+    /**
+     * @brief Charge the points of a decoded stroke_add.
+     */
+    IngressVerdict admitPoints(size_t points, int64_t nowNs = CoarseClock::nowNs()) {
+        if (!policy_.enabled) return IngressVerdict::Allow;
+        if (muted(nowNs)) return IngressVerdict::Drop;
+
+        if (!points_.tryConsume(pointRate_, pointRate_.costNs(static_cast<double>(points)), nowNs)) {
+            return violation(nowNs);
+        }
+        return allowed();
+    }
+
+    bool isMuted(int64_t nowNs = CoarseClock::nowNs()) const {
+        return mutedUntilNs_ > nowNs;
+    }
+
+    uint64_t rejected() const { return rejected_; }
+    int mutes() const { return mutes_; }
+
+private:
+    bool muted(int64_t nowNs) {
+        if (mutedUntilNs_ == 0) return false;
+        if (nowNs < mutedUntilNs_) {
+            ++rejected_;
+            return true;
+        }
+        mutedUntilNs_ = 0;
+        reported_ = false;
+        return false;
+    }
+
+    IngressVerdict allowed() {
+        reported_ = false;
+        return IngressVerdict::Allow;
+    }
+
+    IngressVerdict violation(int64_t nowNs) {
+        ++rejected_;
+        if (++violations_ >= policy_.violationsBeforeMute) {
+            violations_ = 0;
+            if (++mutes_ >= policy_.mutesBeforeShed) {
+                return IngressVerdict::Shed;
+            }
+            mutedUntilNs_ = nowNs + policy_.muteDurationMs * 1'000'000;
+            reported_ = false;  // Tell the client it is muted
+        }
+        if (reported_) {
+            return IngressVerdict::Drop;
+        }
+        reported_ = true;
+        return IngressVerdict::Reject;
+    }
+
+    IngressPolicy policy_;
+    TokenRate messageRate_;
+    TokenRate pointRate_;
+    TokenRate byteRate_;
+    TokenBucket messages_;
+    TokenBucket points_;
+    TokenBucket bytes_;
+
+    int violations_ = 0;
+    int mutes_ = 0;
+    int64_t mutedUntilNs_ = 0;
+    bool reported_ = false;        // Client told about the current run
+    uint64_t rejected_ = 0;
+};
+
+} // namespace collabboard
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace collabboard {
+
+/**
+ * @brief Appends JSON tokens straight into a string, with no DOM.
+ *
+ * Output is byte-for-byte what nlohmann::json::dump() produces for the same
+ * values: floats are promoted to double and printed by nlohmann's own
+ * grisu2 formatter (integral values get a trailing ".0"); non-finite values
+ * print as null; strings escape quotes, backslashes and control characters
+ * only. Integers use std::to_chars.
+ *
+ * Callers write object keys in sorted order themselves, matching dump()'s
+ * alphabetical key order.
+ *
+ * scratch() hands out a thread-local writer whose buffer capacity is kept
+ * between messages, so steady-state encoding does not allocate until the
+ * finished bytes are copied out.
+ */
+class JsonWriter {
+public:
+    JsonWriter() = default;
+
+    /**
+     * @brief Get this thread's reusable writer, cleared.
+     */
+    static JsonWriter& scratch() {
+        thread_local JsonWriter writer;
+        writer.out_.clear();
+        return writer;
+    }
+
+    /**
+     * @brief Append pre-formatted JSON (literal keys, punctuation).
+     */
+    JsonWriter& raw(std::string_view text) {
+        out_.append(text);
+        return *this;
+    }
+
+    JsonWriter& raw(char c) {
+        out_.push_back(c);
+        return *this;
+    }
+
+    /**
+     * @brief Append a quoted, escaped string.
+     */
+    JsonWriter& string(std::string_view value) {
+        out_.push_back('"');
+        size_t runStart = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out_.append(value.data() + runStart, i - runStart);
+            runStart = i + 1;
+            appendEscape(c);
+        }
+        out_.append(value.data() + runStart, value.size() - runStart);
+        out_.push_back('"');
+        return *this;
+    }
+
+    JsonWriter& number(uint64_t value) {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value);
+        out_.append(buf, result.ptr);
+        return *this;
+    }
+
+    JsonWriter& number(int64_t value) {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value);
+        out_.append(buf, result.ptr);
+        return *this;
+    }
+
+    JsonWriter& number(float value) {
+        return number(static_cast<double>(value));
+    }
+
+    JsonWriter& number(double value) {
+        if (!std::isfinite(value)) {
+            out_.append("null");
+            return *this;
+        }
+        // Same grisu2 formatter dump() uses, so digits match exactly
+        char buf[64];
+        char* end = nlohmann::detail::to_chars(buf, buf + sizeof(buf), value);
+        out_.append(buf, end);
+        return *this;
+    }
+
+    JsonWriter& boolean(bool value) {
+        out_.append(value ? "true" : "false");
+        return *this;
+    }
+
+    const std::string& view() const { return out_; }
+
+    /**
+     * @brief Discard written bytes, keeping the buffer's capacity.
+     */
+    void clear() { out_.clear(); }
+
+    /**
+     * @brief Copy out the finished bytes, sized exactly.
+     */
+    std::string str() const { return out_; }
+
+private:
+    void appendEscape(unsigned char c) {
+        switch (c) {
+            case '"':  out_.append("\\\""); break;
+            case '\\': out_.append("\\\\"); break;
+            case '\b': out_.append("\\b"); break;
+            case '\f': out_.append("\\f"); break;
+            case '\n': out_.append("\\n"); break;
+            case '\r': out_.append("\\r"); break;
+            case '\t': out_.append("\\t"); break;
+            default: {
+                static constexpr char hex[] = "0123456789abcdef";
+                char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                out_.append(esc, sizeof(esc));
+                break;
+            }
+        }
+    }
+
+    std::string out_;
+};
+
+} // namespace collabboard
@@ -2,12 +2,16 @@
 
 #include <string>
 #include <vector>
+#include <span>
 #include <optional>
 #include <stdexcept>
 
 #include <nlohmann/json.hpp>
 
 #include "message_types.hpp"
+#include "outbound_frame.hpp"
+#include "binary_codec.hpp"
+#include "json_writer.hpp"
 #include "../models/user_info.hpp"
 #include "../models/stroke.hpp"
 
@@ -175,13 +179,71 @@ public:
         };
     }
 
+    /**
+     * @brief Serialize a message into a frame tagged with its type.
+     */
+    static OutboundFrame makeFrame(MessageType type, uint64_t seq, const json& data,
+                                   std::string conflationKey = "") {
+        return OutboundFrame(createMessage(type, seq, data).dump(), type,
+                             std::move(conflationKey));
+    }
+
+    /**
+     * @brief Write a message envelope around a data object, without a DOM.
+     *
+     * Produces the same bytes as makeFrame() would for the same data: keys
+     * in dump()'s alphabetical order (data, seq, timestamp, type). Used by
+     * the hot-path messages; writeData must emit the data object with its
+     * own keys sorted.
+     */
+    template <typename WriteData>
+    static std::string writeMessage(MessageType type, uint64_t seq, WriteData&& writeData) {
+        JsonWriter& w = JsonWriter::scratch();
+        w.raw(R"({"data":)");
+        writeData(w);
+        w.raw(R"(,"seq":)").number(seq)
+         .raw(R"(,"timestamp":)").number(currentTimestampMs())
+         .raw(R"(,"type":")").raw(messageTypeToString(type)).raw(R"("})");
+        return w.str();
+    }
+
+    /**
+     * @brief Write one room_state stroke object.
+     */
+    static void writeStroke(JsonWriter& w, const Stroke& stroke) {
+        w.raw(R"({"color":)").string(stroke.color)
+         .raw(R"(,"complete":)").boolean(stroke.complete)
+         .raw(R"(,"points":)");
+        writePoints(w, stroke.points);
+        w.raw(R"(,"seq":)").number(stroke.seq)
+         .raw(R"(,"strokeId":)").string(stroke.strokeId)
+         .raw(R"(,"userId":)").string(stroke.oderId)
+         .raw(R"(,"width":)").number(stroke.width).raw('}');
+    }
+
+    /**
+     * @brief Write points as [[x,y],...].
+     */
+    static void writePoints(JsonWriter& w, std::span<const Point> points) {
+        w.raw('[');
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (i > 0) w.raw(',');
+            w.raw('[').number(points[i].x).raw(',').number(points[i].y).raw(']');
+        }
+        w.raw(']');
+    }
+
     /**
      * @brief Create welcome message (sent to user on successful join).
      */
-    static std::string createWelcome(const std::string& oderId,
-                                      const std::string& color,
-                                      const std::vector<UserInfo>& users,
-                                      uint64_t seq) {
+    static OutboundFrame createWelcome(const std::string& oderId,
+                                        const std::string& color,
+                                        const std::vector<UserInfo>& users,
+                                        uint64_t seq,
+                                        bool binary = false,
+                                        const std::string& epoch = "",
+                                        bool resumed = false,
+                                        const std::string& resumeToken = "") {
         json userArray = json::array();
         for (const auto& user : users) {
             userArray.push_back({
@@ -196,171 +258,236 @@ public:
             {"color", color},
             {"users", userArray}
         };
+        if (binary) {
+            data["binary"] = true;  // Server will send binary frames from here on
+        }
+        if (!epoch.empty()) {
+            data["epoch"] = epoch;  // Echoed back in resume
+        }
+        if (resumed) {
+            data["resumed"] = true;  // Missed events follow; no snapshot
+        }
+        if (!resumeToken.empty()) {
+            data["resumeToken"] = resumeToken;  // Proves the ID in a later resume
+        }
 
-        return createMessage(MessageType::Welcome, seq, data).dump();
+        return makeFrame(MessageType::Welcome, seq, data);
     }
 
     /**
      * @brief Create user_joined message.
      */
-    static std::string createUserJoined(const std::string& oderId,
-                                         const std::string& userName,
-                                         const std::string& color,
-                                         uint64_t seq) {
+    static OutboundFrame createUserJoined(const std::string& oderId,
+                                           const std::string& userName,
+                                           const std::string& color,
+                                           uint64_t seq) {
         json data = {
             {"userId", oderId},
             {"name", userName},
             {"color", color}
         };
-        return createMessage(MessageType::UserJoined, seq, data).dump();
+        return makeFrame(MessageType::UserJoined, seq, data);
     }
 
     /**
      * @brief Create user_left message.
      */
-    static std::string createUserLeft(const std::string& oderId, uint64_t seq) {
+    static OutboundFrame createUserLeft(const std::string& oderId, uint64_t seq) {
         json data = {{"userId", oderId}};
-        return createMessage(MessageType::UserLeft, seq, data).dump();
+        return makeFrame(MessageType::UserLeft, seq, data);
     }
 
     /**
      * @brief Create cursor_move message.
+     * @param binary Also encode it for binary clients (skipped if the room
+     *        has none)
      */
-    static std::string createCursorMove(const std::string& oderId,
-                                         float x, float y,
-                                         uint64_t seq) {
-        json data = {
-            {"userId", oderId},
-            {"x", x},
-            {"y", y}
-        };
-        return createMessage(MessageType::CursorMove, seq, data).dump();
+    static OutboundFrame createCursorMove(const std::string& oderId,
+                                           float x, float y,
+                                           uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::CursorMove, seq, [&](JsonWriter& w) {
+            w.raw(R"({"userId":)").string(oderId)
+             .raw(R"(,"x":)").number(x)
+             .raw(R"(,"y":)").number(y).raw('}');
+        });
+        // Keyed by user so a newer position can replace a queued one
+        return OutboundFrame(std::move(text), MessageType::CursorMove, oderId,
+                             binary ? BinaryCodec::encodeCursorMove(oderId, x, y, seq) : "");
+    }
+
+    /**
+     * @brief Create cursor_batch message carrying every cursor that moved
+     * since the previous presence tick.
+     * @param binary Also encode it for binary clients
+     */
+    static OutboundFrame createCursorBatch(const std::vector<CursorState>& cursors,
+                                            uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::CursorBatch, seq, [&](JsonWriter& w) {
+            w.raw(R"({"cursors":[)");
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                if (i > 0) w.raw(',');
+                w.raw(R"({"userId":)").string(cursors[i].oderId)
+                 .raw(R"(,"x":)").number(cursors[i].x)
+                 .raw(R"(,"y":)").number(cursors[i].y).raw('}');
+            }
+            w.raw("]}");
+        });
+        return OutboundFrame(std::move(text), MessageType::CursorBatch, "",
+                             binary ? BinaryCodec::encodeCursorBatch(cursors, seq) : "");
     }
 
     /**
      * @brief Create stroke_start message.
+     * @param binary Also encode it for binary clients
      */
-    static std::string createStrokeStart(const std::string& strokeId,
-                                          const std::string& oderId,
-                                          const std::string& color,
-                                          float width,
-                                          uint64_t seq) {
-        json data = {
-            {"strokeId", strokeId},
-            {"userId", oderId},
-            {"color", color},
-            {"width", width}
-        };
-        return createMessage(MessageType::StrokeStart, seq, data).dump();
+    static OutboundFrame createStrokeStart(const std::string& strokeId,
+                                            const std::string& oderId,
+                                            const std::string& color,
+                                            float width,
+                                            uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::StrokeStart, seq, [&](JsonWriter& w) {
+            w.raw(R"({"color":)").string(color)
+             .raw(R"(,"strokeId":)").string(strokeId)
+             .raw(R"(,"userId":)").string(oderId)
+             .raw(R"(,"width":)").number(width).raw('}');
+        });
+        return OutboundFrame(std::move(text), MessageType::StrokeStart, "",
+                             binary ? BinaryCodec::encodeStrokeStart(strokeId, oderId, color, width, seq)
+                                    : "");
     }
 
     /**
      * @brief Create stroke_add message.
+     * @param binary Also encode it for binary clients
      */
-    static std::string createStrokeAdd(const std::string& strokeId,
-                                        const std::string& oderId,
-                                        const std::vector<Point>& points,
-                                        uint64_t seq) {
-        json pointsArray = json::array();
-        for (const auto& pt : points) {
-            pointsArray.push_back({pt.x, pt.y});
-        }
-
-        json data = {
-            {"strokeId", strokeId},
-            {"userId", oderId},
-            {"points", pointsArray}
-        };
-        return createMessage(MessageType::StrokeAdd, seq, data).dump();
+    static OutboundFrame createStrokeAdd(const std::string& strokeId,
+                                          const std::string& oderId,
+                                          std::span<const Point> points,
+                                          uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::StrokeAdd, seq, [&](JsonWriter& w) {
+            w.raw(R"({"points":)");
+            writePoints(w, points);
+            w.raw(R"(,"strokeId":)").string(strokeId)
+             .raw(R"(,"userId":)").string(oderId).raw('}');
+        });
+        return OutboundFrame(std::move(text), MessageType::StrokeAdd, "",
+                             binary ? BinaryCodec::encodeStrokeAdd(strokeId, oderId, points, seq) : "");
     }
 
     /**
      * @brief Create stroke_end message.
+     * @param binary Also encode it for binary clients
      */
-    static std::string createStrokeEnd(const std::string& strokeId,
-                                        const std::string& oderId,
-                                        uint64_t seq) {
-        json data = {
-            {"strokeId", strokeId},
-            {"userId", oderId}
-        };
-        return createMessage(MessageType::StrokeEnd, seq, data).dump();
+    static OutboundFrame createStrokeEnd(const std::string& strokeId,
+                                          const std::string& oderId,
+                                          uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::StrokeEnd, seq, [&](JsonWriter& w) {
+            w.raw(R"({"strokeId":)").string(strokeId)
+             .raw(R"(,"userId":)").string(oderId).raw('}');
+        });
+        return OutboundFrame(std::move(text), MessageType::StrokeEnd, "",
+                             binary ? BinaryCodec::encodeStrokeEnd(strokeId, oderId, seq) : "");
     }
 
     /**
      * @brief Create stroke_move message.
+     * @param binary Also encode it for binary clients
      */
-    static std::string createStrokeMove(const std::string& strokeId,
-                                         const std::string& oderId,
-                                         float dx, float dy,
-                                         uint64_t seq) {
-        json data = {
-            {"strokeId", strokeId},
-            {"userId", oderId},
-            {"dx", dx},
-            {"dy", dy}
-        };
-        return createMessage(MessageType::StrokeMove, seq, data).dump();
+    static OutboundFrame createStrokeMove(const std::string& strokeId,
+                                           const std::string& oderId,
+                                           float dx, float dy,
+                                           uint64_t seq, bool binary = true) {
+        std::string text = writeMessage(MessageType::StrokeMove, seq, [&](JsonWriter& w) {
+            w.raw(R"({"dx":)").number(dx)
+             .raw(R"(,"dy":)").number(dy)
+             .raw(R"(,"strokeId":)").string(strokeId)
+             .raw(R"(,"userId":)").string(oderId).raw('}');
+        });
+        return OutboundFrame(std::move(text), MessageType::StrokeMove, "",
+                             binary ? BinaryCodec::encodeStrokeMove(strokeId, oderId, dx, dy, seq) : "");
     }
 
     /**
      * @brief Create room_state message (snapshot for late joiners).
      */
-    static std::string createRoomState(const std::vector<Stroke>& strokes,
-                                        uint64_t snapshotSeq) {
-        json strokesArray = json::array();
-        for (const auto& stroke : strokes) {
-            json pointsArray = json::array();
-            for (const auto& pt : stroke.points) {
-                pointsArray.push_back({pt.x, pt.y});
+    static OutboundFrame createRoomState(const std::vector<Stroke>& strokes,
+                                          uint64_t snapshotSeq) {
+        std::string text = writeMessage(MessageType::RoomState, snapshotSeq, [&](JsonWriter& w) {
+            w.raw(R"({"snapshotSeq":)").number(snapshotSeq)
+             .raw(R"(,"strokes":[)");
+            for (size_t i = 0; i < strokes.size(); ++i) {
+                if (i > 0) w.raw(',');
+                writeStroke(w, strokes[i]);
             }
-
-            strokesArray.push_back({
-                {"strokeId", stroke.strokeId},
-                {"userId", stroke.oderId},
-                {"points", pointsArray},
-                {"color", stroke.color},
-                {"width", stroke.width},
-                {"complete", stroke.complete}
-            });
-        }
-
-        json data = {
-            {"strokes", strokesArray},
-            {"snapshotSeq", snapshotSeq}
-        };
-        return createMessage(MessageType::RoomState, snapshotSeq, data).dump();
+            w.raw("]}");
+        });
+        return OutboundFrame(std::move(text), MessageType::RoomState, "",
+                             BinaryCodec::encodeRoomState(strokes, snapshotSeq, snapshotSeq));
     }
 
     /**
      * @brief Create pong message.
      */
-    static std::string createPong(uint64_t seq) {
-        return createMessage(MessageType::Pong, seq, json::object()).dump();
+    static OutboundFrame createPong(uint64_t seq) {
+        return makeFrame(MessageType::Pong, seq, json::object());
     }
 
     /**
      * @brief Create error message.
      */
-    static std::string createError(ErrorCode code, uint64_t seq) {
+    static OutboundFrame createError(ErrorCode code, uint64_t seq) {
         json data = {
             {"code", std::string(errorCodeToString(code))},
             {"message", std::string(errorCodeToMessage(code))}
         };
-        return createMessage(MessageType::Error, seq, data).dump();
+        return makeFrame(MessageType::Error, seq, data);
     }
 
     /**
      * @brief Create error message with custom message.
      */
-    static std::string createError(ErrorCode code, 
-                                    const std::string& customMessage,
-                                    uint64_t seq) {
+    static OutboundFrame createError(ErrorCode code, 
+                                      const std::string& customMessage,
+                                      uint64_t seq) {
         json data = {
             {"code", std::string(errorCodeToString(code))},
             {"message", customMessage}
         };
-        return createMessage(MessageType::Error, seq, data).dump();
+        return makeFrame(MessageType::Error, seq, data);
+    }
+
+    // =========================================================================
+    // Batching (Outgoing Messages)
+    // =========================================================================
+
+    /**
+     * A batch frame is the prefix, the member messages joined by the
+     * separator, then the suffix. Sessions write these pieces as a gathered
+     * buffer sequence so member payloads are never copied.
+     */
+    static constexpr std::string_view BatchPrefix =
+        R"({"type":"batch","seq":0,"data":{"messages":[)";
+    static constexpr std::string_view BatchSeparator = ",";
+    static constexpr std::string_view BatchSuffix = "]}}";
+
+    /**
+     * @brief Create a batch message holding several already-serialized frames.
+     */
+    static OutboundFrame createBatch(const std::vector<OutboundFrame>& frames) {
+        size_t total = BatchPrefix.size() + BatchSuffix.size();
+        for (const auto& frame : frames) {
+            total += frame.size() + BatchSeparator.size();
+        }
+
+        std::string out;
+        out.reserve(total);
+        out.append(BatchPrefix);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (i > 0) out.append(BatchSeparator);
+            out.append(frames[i].str());
+        }
+        out.append(BatchSuffix);
+        return OutboundFrame(std::move(out), MessageType::Batch);
     }
 
 private:
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+#include "message_types.hpp"
+#include "client_messages.hpp"
+#include "../models/stroke.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Streaming decoder for client JSON messages.
+ *
+ * Uses nlohmann's SAX interface, so no DOM is built: the known envelope
+ * fields (type, seq) and data fields are captured as they stream past and
+ * everything else is skipped. Points go straight into a reused vector.
+ *
+ * One decoder belongs to one session. Its buffers keep their capacity
+ * between messages, and the typed messages it returns view into them, so
+ * they are valid until the next decode().
+ *
+ * Field semantics match the DOM path it replaces: a missing or non-object
+ * data is treated as empty, a field of the wrong JSON type counts as
+ * missing, and point entries that are not [number, number, ...] are skipped.
+ * Board messages that break the field rules in client_messages.hpp (a
+ * number too large for a float counts as non-finite) come back as nullopt.
+ */
+class MessageDecoder {
+public:
+    /**
+     * @brief Decode a message.
+     * @return false if the bytes are not valid JSON
+     */
+    bool decode(std::string_view bytes) {
+        reset();
+        Handler handler(*this);
+        return nlohmann::json::sax_parse(bytes.begin(), bytes.end(), &handler);
+    }
+
+    MessageType type() const { return type_; }
+    uint64_t seq() const { return seq_; }
+
+    // =========================================================================
+    // Typed Views (nullopt if a required field is missing, mistyped or invalid)
+    // =========================================================================
+
+    std::optional<JoinRoomMsg> joinRoom() const {
+        if (!isString(Field::RoomId) || !isString(Field::UserName)) {
+            return std::nullopt;
+        }
+        JoinRoomMsg msg;
+        msg.roomId = text(Field::RoomId);
+        msg.userName = text(Field::UserName);
+        msg.password = isString(Field::Password) ? text(Field::Password) : std::string_view();
+        msg.binary = isTrue(Field::Binary);
+        msg.chunked = isTrue(Field::Chunked);
+        if (isNumber(Field::ViewX) && isNumber(Field::ViewY) &&
+            isNumber(Field::ViewWidth) && isNumber(Field::ViewHeight) &&
+            number(Field::ViewWidth) > 0.0f && number(Field::ViewHeight) > 0.0f &&
+            isValid(ViewportMsg{number(Field::ViewX), number(Field::ViewY),
+                                number(Field::ViewWidth), number(Field::ViewHeight)})) {
+            msg.viewport = Bounds::of(number(Field::ViewX), number(Field::ViewY),
+                                      number(Field::ViewWidth), number(Field::ViewHeight));
+        }
+        return msg;
+    }
+
+    std::optional<ResumeMsg> resume() const {
+        auto join = joinRoom();
+        if (!join || !isNumber(Field::LastSeq) || fields_[Field::LastSeq].num < 0) {
+            return std::nullopt;
+        }
+        ResumeMsg msg;
+        msg.join = *join;
+        msg.userId = isString(Field::UserId) ? text(Field::UserId) : std::string_view();
+        msg.epoch = isString(Field::Epoch) ? text(Field::Epoch) : std::string_view();
+        msg.lastSeq = static_cast<uint64_t>(fields_[Field::LastSeq].num);
+        msg.resumeToken = isString(Field::ResumeToken) ? text(Field::ResumeToken) : std::string_view();
+        return msg;
+    }
+
+    std::optional<CursorMoveMsg> cursorMove() const {
+        if (!isNumber(Field::X) || !isNumber(Field::Y)) {
+            return std::nullopt;
+        }
+        return checked(CursorMoveMsg{number(Field::X), number(Field::Y)});
+    }
+
+    std::optional<StrokeStartMsg> strokeStart() const {
+        if (!isString(Field::StrokeId) || !isString(Field::Color) || !isNumber(Field::Width)) {
+            return std::nullopt;
+        }
+        return checked(StrokeStartMsg{text(Field::StrokeId), text(Field::Color), number(Field::Width)});
+    }
+
+    std::optional<StrokeAddMsg> strokeAdd() const {
+        if (!isString(Field::StrokeId) || fields_[Field::Points].kind != Kind::Array) {
+            return std::nullopt;
+        }
+        return checked(StrokeAddMsg{text(Field::StrokeId), std::span<const Point>(points_)});
+    }
+
+    std::optional<StrokeEndMsg> strokeEnd() const {
+        if (!isString(Field::StrokeId)) {
+            return std::nullopt;
+        }
+        return checked(StrokeEndMsg{text(Field::StrokeId)});
+    }
+
+    std::optional<StrokeMoveMsg> strokeMove() const {
+        if (!isString(Field::StrokeId) || !isNumber(Field::Dx) || !isNumber(Field::Dy)) {
+            return std::nullopt;
+        }
+        return checked(StrokeMoveMsg{text(Field::StrokeId), number(Field::Dx), number(Field::Dy)});
+    }
+
+    std::optional<ViewportMsg> viewport() const {
+        if (!isNumber(Field::X) || !isNumber(Field::Y) ||
+            !isNumber(Field::Width) || !isNumber(Field::Height)) {
+            return std::nullopt;
+        }
+        return checked(ViewportMsg{number(Field::X), number(Field::Y),
+                                   number(Field::Width), number(Field::Height)});
+    }
+
+    PingMsg ping() const { return PingMsg{seq_}; }
+
+private:
+    enum class Kind : uint8_t { Missing, String, Number, Bool, Array, Other };
+
+    // Data fields the protocol uses; anything else is skipped
+    enum Field : size_t {
+        RoomId, UserName, Password, Binary, Chunked, UserId, Epoch, LastSeq,
+        X, Y, StrokeId, Color, Width, Points, Dx, Dy,
+        Height, ViewX, ViewY, ViewWidth, ViewHeight, ResumeToken,
+        FieldCount, NoField = FieldCount
+    };
+
+    struct Value {
+        Kind kind = Kind::Missing;
+        std::string str;
+        double num = 0.0;
+        bool boolean = false;
+    };
+
+    static Field fieldOf(std::string_view key) {
+        static constexpr std::array<std::string_view, FieldCount> names = {
+            "roomId", "userName", "password", "binary", "chunked", "userId", "epoch", "lastSeq",
+            "x", "y", "strokeId", "color", "width", "points", "dx", "dy",
+            "height", "viewX", "viewY", "viewWidth", "viewHeight", "resumeToken"
+        };
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == key) return static_cast<Field>(i);
+        }
+        return NoField;
+    }
+
+    bool isString(Field f) const { return fields_[f].kind == Kind::String; }
+    bool isNumber(Field f) const { return fields_[f].kind == Kind::Number; }
+    bool isTrue(Field f) const { return fields_[f].kind == Kind::Bool && fields_[f].boolean; }
+    std::string_view text(Field f) const { return fields_[f].str; }
+    float number(Field f) const { return toFloat(fields_[f].num); }
+
+    // Out of float range (or NaN) becomes infinity, which the field rules reject
+    static float toFloat(double val) {
+        return std::fabs(val) <= std::numeric_limits<float>::max()
+            ? static_cast<float>(val) : std::numeric_limits<float>::infinity();
+    }
+
+    template<typename Msg>
+    static std::optional<Msg> checked(const Msg& msg) {
+        if (!isValid(msg)) return std::nullopt;
+        return msg;
+    }
+
+    void reset() {
+        type_ = MessageType::Unknown;
+        seq_ = 0;
+        for (auto& field : fields_) {
+            field.kind = Kind::Missing;
+            field.str.clear();
+        }
+        points_.clear();
+    }
+
+    /**
+     * @brief SAX callbacks. Depth 1 is the envelope, 2 the data object,
+     * 3 the points array, 4 one point.
+     */
+    class Handler : public nlohmann::json_sax<nlohmann::json> {
+    public:
+        explicit Handler(MessageDecoder& decoder) : d_(decoder) {}
+
+        bool null() override { return scalar(Kind::Other); }
+        bool boolean(bool val) override {
+            if (Value* v = dataValue()) v->boolean = val;
+            return scalar(Kind::Bool);
+        }
+        bool number_integer(number_integer_t val) override {
+            return numeric(static_cast<double>(val), static_cast<uint64_t>(val));
+        }
+        bool number_unsigned(number_unsigned_t val) override {
+            return numeric(static_cast<double>(val), val);
+        }
+        bool number_float(number_float_t val, const string_t&) override {
+            bool representable = val >= 0.0 && val < 18446744073709551616.0;
+            return numeric(val, representable ? static_cast<uint64_t>(val) : 0);
+        }
+        bool string(string_t& val) override {
+            if (depth_ == 1 && topKey_ == "type") {
+                d_.type_ = stringToMessageType(val);
+            } else if (Value* v = dataValue()) {
+                v->str.swap(val);
+            }
+            return scalar(Kind::String);
+        }
+        bool binary(binary_t&) override { return scalar(Kind::Other); }
+
+        bool start_object(std::size_t) override {
+            markContainer(Kind::Other);
+            ++depth_;
+            if (depth_ == 2 && topKey_ == "data") {
+                inData_ = true;
+            }
+            return true;
+        }
+        bool key(string_t& val) override {
+            if (depth_ == 1) {
+                topKey_.swap(val);
+            } else if (depth_ == 2 && inData_) {
+                dataField_ = fieldOf(val);
+            }
+            return true;
+        }
+        bool end_object() override {
+            if (depth_ == 2) inData_ = false;
+            --depth_;
+            return true;
+        }
+
+        bool start_array(std::size_t) override {
+            bool pointsArray = depth_ == 2 && inData_ && dataField_ == Points;
+            markContainer(pointsArray ? Kind::Array : Kind::Other);
+            ++depth_;
+            if (pointsArray) {
+                inPoints_ = true;
+            } else if (depth_ == 4 && inPoints_) {
+                inPoint_ = true;
+                coords_ = 0;
+                pointValid_ = true;
+            }
+            return true;
+        }
+        bool end_array() override {
+            if (depth_ == 4 && inPoint_) {
+                if (pointValid_ && coords_ >= 2) {
+                    d_.points_.emplace_back(toFloat(x_), toFloat(y_));
+                }
+                inPoint_ = false;
+            } else if (depth_ == 3 && inPoints_) {
+                inPoints_ = false;
+            }
+            --depth_;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&,
+                         const nlohmann::detail::exception&) override {
+            return false;
+        }
+
+    private:
+        /**
+         * @brief Slot for a scalar arriving directly in the data object.
+         */
+        Value* dataValue() {
+            if (depth_ == 2 && inData_ && dataField_ != NoField) {
+                return &d_.fields_[dataField_];
+            }
+            return nullptr;
+        }
+
+        bool scalar(Kind kind) {
+            if (Value* v = dataValue()) {
+                v->kind = kind;
+            } else if (depth_ == 4 && inPoint_) {
+                pointElement(false);
+            }
+            return true;
+        }
+
+        bool numeric(double val, uint64_t unsignedVal) {
+            if (depth_ == 1 && topKey_ == "seq") {
+                d_.seq_ = unsignedVal;
+            } else if (Value* v = dataValue()) {
+                v->kind = Kind::Number;
+                v->num = val;
+            } else if (depth_ == 4 && inPoint_) {
+                if (coords_ == 0) x_ = val;
+                if (coords_ == 1) y_ = val;
+                pointElement(true);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Record the kind of a container value before descending into it.
+         */
+        void markContainer(Kind kind) {
+            if (Value* v = dataValue()) {
+                v->kind = kind;
+            } else if (depth_ == 4 && inPoint_) {
+                pointElement(false);
+            }
+        }
+
+        void pointElement(bool isNumber) {
+            if (coords_ < 2 && !isNumber) pointValid_ = false;
+            ++coords_;
+        }
+
+        MessageDecoder& d_;
+        int depth_ = 0;
+        std::string topKey_;
+        Field dataField_ = NoField;
+        bool inData_ = false;
+        bool inPoints_ = false;
+        bool inPoint_ = false;
+        int coords_ = 0;
+        bool pointValid_ = true;
+        double x_ = 0.0;
+        double y_ = 0.0;
+    };
+
+    MessageType type_ = MessageType::Unknown;
+    uint64_t seq_ = 0;
+    std::array<Value, FieldCount> fields_;
+    std::vector<Point> points_;
+};
+
+} // namespace collabboard
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <functional>
 
 #include "message_types.hpp"
 #include "message_codec.hpp"
+#include "binary_codec.hpp"
+#include "client_messages.hpp"
+#include "message_decoder.hpp"
+#include "ingress_limiter.hpp"
+#include "../utils/metrics.hpp"
 #include "../services/room_service.hpp"
 
 namespace collabboard {
@@ -15,242 +21,417 @@ class WsSession;
 
 /**
  * @brief Dispatches parsed messages to appropriate service handlers.
+ *
+ * One handler belongs to one session, so its decoder and ingress limiter
+ * are not shared. Every message is charged to the limiter before it is
+ * decoded (and stroke_add points once they are); over-budget messages are
+ * dropped with a RATE_LIMITED error, and a session that keeps at it is
+ * flagged for disconnection (see shouldDisconnect()).
+ *
+ * Handling time per message type goes to ServerMetrics; for messages run
+ * on the room's executor it is measured when the room task finishes.
  */
 class MessageHandler {
 public:
-    using SendFunc = std::function<void(std::shared_ptr<WsSession>, const std::string&)>;
+    using SendFunc = FrameSendFunc;
 
-    explicit MessageHandler(RoomService& roomService)
+    explicit MessageHandler(RoomService& roomService,
+                            const IngressPolicy& ingressPolicy = IngressPolicy())
         : roomService_(roomService)
+        , ingress_(ingressPolicy)
     {}
 
+    /**
+     * @brief Whether the session has been shed for flooding and should be closed.
+     */
+    bool shouldDisconnect() const { return shed_; }
+
+    const IngressLimiter& ingress() const { return ingress_; }
+
     /**
      * @brief Handle an incoming message from a session.
+     *
+     * The message is decoded by a streaming parser straight into the typed
+     * fields its handler needs; no JSON tree is built.
+     *
      * @param session The session that sent the message
-     * @param roomId The room the session is in (empty if not joined)
+     * @param room The room the session is in (nullptr if not joined)
      * @param oderId The user ID (empty if not joined)
-     * @param rawMessage The raw JSON message string
+     * @param rawMessage The raw JSON message bytes
      * @param sendFunc Function to send response/broadcast
      * @return JoinResult if this was a join message, nullopt otherwise
      */
     std::optional<JoinResult> handle(std::shared_ptr<WsSession> session,
-                                      const std::string& roomId,
+                                      const std::shared_ptr<Room>& room,
                                       const std::string& oderId,
-                                      const std::string& rawMessage,
+                                      std::string_view rawMessage,
                                       SendFunc sendFunc) {
-        // Parse message
-        json msg;
-        try {
-            msg = MessageCodec::parse(rawMessage);
-        } catch (const MessageParseError&) {
-            sendError(session, ErrorCode::MalformedMessage, sendFunc);
+        receivedNs_ = metricNowNs();
+        if (!admit(session, ingress_.admitMessage(rawMessage.size()), sendFunc)) {
             return std::nullopt;
         }
 
-        // Get message type
-        MessageType type = MessageCodec::getType(msg);
-        json data = MessageCodec::getData(msg);
+        if (!decoder_.decode(rawMessage)) {
+            sendError(session, ErrorCode::MalformedMessage, sendFunc);
+            recordHandled(MessageType::Unknown);
+            return std::nullopt;
+        }
 
-        switch (type) {
-            case MessageType::JoinRoom:
-                return handleJoinRoom(session, data, sendFunc);
+        switch (decoder_.type()) {
+            case MessageType::JoinRoom: {
+                auto msg = decoder_.joinRoom();
+                if (!msg) {
+                    sendError(session, ErrorCode::MissingField, sendFunc);
+                    return JoinResult::Failure(ErrorCode::MissingField);
+                }
+                auto result = handleJoinRoom(session, *msg, sendFunc);
+                recordHandled(MessageType::JoinRoom);
+                return result;
+            }
+
+            case MessageType::Resume: {
+                auto msg = decoder_.resume();
+                if (!msg) {
+                    sendError(session, ErrorCode::MissingField, sendFunc);
+                    return JoinResult::Failure(ErrorCode::MissingField);
+                }
+                auto result = handleResume(session, *msg, sendFunc);
+                recordHandled(MessageType::Resume);
+                return result;
+            }
 
             case MessageType::CursorMove:
-                handleCursorMove(roomId, oderId, data, sendFunc);
+                // Invalid messages are silently ignored
+                if (auto msg = decoder_.cursorMove()) {
+                    handleCursorMove(room, oderId, *msg, sendFunc);
+                }
                 break;
 
             case MessageType::StrokeStart:
-                handleStrokeStart(roomId, oderId, data, sendFunc);
+                if (auto msg = decoder_.strokeStart()) {
+                    handleStrokeStart(room, oderId, *msg, sendFunc);
+                }
                 break;
 
             case MessageType::StrokeAdd:
-                handleStrokeAdd(roomId, oderId, data, sendFunc);
+                if (auto msg = decoder_.strokeAdd()) {
+                    if (admit(session, ingress_.admitPoints(msg->points.size()), sendFunc)) {
+                        handleStrokeAdd(room, oderId, *msg, sendFunc);
+                    }
+                }
                 break;
 
             case MessageType::StrokeEnd:
-                handleStrokeEnd(roomId, oderId, data, sendFunc);
+                if (auto msg = decoder_.strokeEnd()) {
+                    handleStrokeEnd(room, oderId, *msg, sendFunc);
+                }
                 break;
 
             case MessageType::StrokeMove:
-                handleStrokeMove(roomId, oderId, data, sendFunc);
+                if (auto msg = decoder_.strokeMove()) {
+                    handleStrokeMove(room, oderId, *msg, sendFunc);
+                }
+                break;
+
+            case MessageType::Viewport:
+                if (auto msg = decoder_.viewport()) {
+                    handleViewport(room, oderId, *msg, sendFunc);
+                }
                 break;
 
             case MessageType::Ping:
-                handlePing(session, msg, sendFunc);
+                handlePing(session, decoder_.ping(), sendFunc);
+                recordHandled(MessageType::Ping);
                 break;
 
             case MessageType::Unknown:
             default:
                 sendError(session, ErrorCode::InvalidMessageType, sendFunc);
+                recordHandled(MessageType::Unknown);
                 break;
         }
 
         return std::nullopt;
     }
 
+    /**
+     * @brief Handle an incoming binary-protocol message from a session.
+     *
+     * Binary messages skip JSON entirely: fields are decoded straight into
+     * the same typed messages the JSON path produces and routed to the same
+     * handlers.
+     */
+    void handleBinary(std::shared_ptr<WsSession> session,
+                      const std::shared_ptr<Room>& room,
+                      const std::string& oderId,
+                      std::string_view bytes,
+                      SendFunc sendFunc) {
+        receivedNs_ = metricNowNs();
+        if (!admit(session, ingress_.admitMessage(bytes.size()), sendFunc)) {
+            return;
+        }
+
+        auto msg = BinaryCodec::decodeClient(bytes);
+        if (!msg) {
+            sendError(session, ErrorCode::MalformedMessage, sendFunc);
+            recordHandled(MessageType::Unknown);
+            return;
+        }
+
+        switch (msg->type) {
+            case MessageType::CursorMove:
+                handleCursorMove(room, oderId, CursorMoveMsg{msg->x, msg->y}, sendFunc);
+                break;
+
+            case MessageType::StrokeStart:
+                handleStrokeStart(room, oderId,
+                                  StrokeStartMsg{msg->strokeId, msg->color, msg->width}, sendFunc);
+                break;
+
+            case MessageType::StrokeAdd:
+                if (admit(session, ingress_.admitPoints(msg->points.size()), sendFunc)) {
+                    handleStrokeAdd(room, oderId,
+                                    StrokeAddMsg{msg->strokeId, msg->points}, sendFunc);
+                }
+                break;
+
+            case MessageType::StrokeEnd:
+                handleStrokeEnd(room, oderId, StrokeEndMsg{msg->strokeId}, sendFunc);
+                break;
+
+            case MessageType::StrokeMove:
+                handleStrokeMove(room, oderId,
+                                 StrokeMoveMsg{msg->strokeId, msg->x, msg->y}, sendFunc);
+                break;
+
+            default:
+                break;
+        }
+    }
+
 private:
     /**
      * @brief Handle join_room message.
      */
     std::optional<JoinResult> handleJoinRoom(std::shared_ptr<WsSession> session,
-                                              const json& data,
+                                              const JoinRoomMsg& msg,
                                               SendFunc sendFunc) {
-        // Validate data
-        if (!MessageCodec::validateJoinRoom(data)) {
-            sendError(session, ErrorCode::MissingField, sendFunc);
-            return JoinResult::Failure(ErrorCode::MissingField);
-        }
+        auto result = roomService_.joinRoom(std::string(msg.roomId), std::string(msg.userName),
+                                            std::string(msg.password), session, sendFunc,
+                                            msg.binary, msg.chunked, std::nullopt, msg.viewport);
+        sendJoinFailure(session, result, sendFunc);
+        return result;
+    }
 
-        std::string roomId = data["roomId"].get<std::string>();
-        std::string userName = data["userName"].get<std::string>();
-        std::string password = data.value("password", "");
+    /**
+     * @brief Handle resume message (rejoin after a disconnect).
+     */
+    std::optional<JoinResult> handleResume(std::shared_ptr<WsSession> session,
+                                            const ResumeMsg& msg,
+                                            SendFunc sendFunc) {
+        ResumePoint resume{std::string(msg.userId), std::string(msg.epoch), msg.lastSeq,
+                           std::string(msg.resumeToken)};
+        auto result = roomService_.joinRoom(std::string(msg.join.roomId),
+                                            std::string(msg.join.userName),
+                                            std::string(msg.join.password), session, sendFunc,
+                                            msg.join.binary, msg.join.chunked, resume,
+                                            msg.join.viewport);
+        sendJoinFailure(session, result, sendFunc);
+        return result;
+    }
 
-        // Join the room
-        return roomService_.joinRoom(roomId, userName, password, session, sendFunc);
+    /**
+     * @brief Tell the client why a join was refused. For WRONG_NODE the
+     *        message is the owning node's URL, so the client can reconnect
+     *        there.
+     */
+    void sendJoinFailure(const std::shared_ptr<WsSession>& session,
+                         const JoinResult& result,
+                         SendFunc sendFunc) {
+        if (result.success) return;
+        OutboundFrame errorMsg = result.errorMessage.empty()
+            ? MessageCodec::createError(result.errorCode, 0)
+            : MessageCodec::createError(result.errorCode, result.errorMessage, 0);
+        sendFunc(session, errorMsg);
     }
 
+    // Room-scoped handlers post to the room's executor. The typed message
+    // views the decoder's buffers, so each task captures owned copies.
+
     /**
      * @brief Handle cursor_move message.
      */
-    void handleCursorMove(const std::string& roomId,
+    void handleCursorMove(const std::shared_ptr<Room>& room,
                           const std::string& oderId,
-                          const json& data,
+                          const CursorMoveMsg& msg,
                           SendFunc sendFunc) {
         // Check if in room
-        if (roomId.empty() || oderId.empty()) {
+        if (!room || oderId.empty()) {
             return;  // Silently ignore if not in room
         }
 
-        // Validate data
-        if (!MessageCodec::validateCursorMove(data)) {
-            return;  // Silently ignore invalid cursor moves
-        }
-
-        float x = data["x"].get<float>();
-        float y = data["y"].get<float>();
-
         // Route to service (rate limiting handled there)
-        roomService_.handleCursorMove(roomId, oderId, x, y, sendFunc);
+        postTimed(room, MessageType::CursorMove, [&service = roomService_, room, oderId, msg, sendFunc]() {
+            service.handleCursorMove(*room, oderId, msg.x, msg.y, sendFunc);
+        });
     }
 
     /**
      * @brief Handle stroke_start message.
      */
-    void handleStrokeStart(const std::string& roomId,
+    void handleStrokeStart(const std::shared_ptr<Room>& room,
                            const std::string& oderId,
-                           const json& data,
+                           const StrokeStartMsg& msg,
                            SendFunc sendFunc) {
         // Check if in room
-        if (roomId.empty() || oderId.empty()) {
-            return;
-        }
-
-        // Validate data
-        if (!MessageCodec::validateStrokeStart(data)) {
+        if (!room || oderId.empty()) {
             return;
         }
 
-        std::string strokeId = data["strokeId"].get<std::string>();
-        std::string color = data["color"].get<std::string>();
-        float width = data["width"].get<float>();
-
-        auto error = roomService_.handleStrokeStart(roomId, oderId, strokeId, color, width, sendFunc);
-        // Errors are logged but not sent back for stroke operations
-        (void)error;
+        postTimed(room, MessageType::StrokeStart, [&service = roomService_, room, oderId, sendFunc,
+                    strokeId = std::string(msg.strokeId), color = std::string(msg.color),
+                    width = msg.width]() {
+            // Errors are logged but not sent back for stroke operations
+            (void)service.handleStrokeStart(*room, oderId, strokeId, color, width, sendFunc);
+        });
     }
 
     /**
      * @brief Handle stroke_add message.
      */
-    void handleStrokeAdd(const std::string& roomId,
+    void handleStrokeAdd(const std::shared_ptr<Room>& room,
                          const std::string& oderId,
-                         const json& data,
+                         const StrokeAddMsg& msg,
                          SendFunc sendFunc) {
         // Check if in room
-        if (roomId.empty() || oderId.empty()) {
+        if (!room || oderId.empty()) {
             return;
         }
 
-        // Validate data
-        if (!MessageCodec::validateStrokeAdd(data)) {
-            return;
-        }
-
-        std::string strokeId = data["strokeId"].get<std::string>();
-        std::vector<Point> points = MessageCodec::extractPoints(data);
-
-        auto error = roomService_.handleStrokeAdd(roomId, oderId, strokeId, points, sendFunc);
-        (void)error;
+        postTimed(room, MessageType::StrokeAdd, [&service = roomService_, room, oderId, sendFunc,
+                    strokeId = std::string(msg.strokeId),
+                    points = std::vector<Point>(msg.points.begin(), msg.points.end())]() {
+            (void)service.handleStrokeAdd(*room, oderId, strokeId, points, sendFunc);
+        });
     }
 
     /**
      * @brief Handle stroke_end message.
      */
-    void handleStrokeEnd(const std::string& roomId,
+    void handleStrokeEnd(const std::shared_ptr<Room>& room,
                          const std::string& oderId,
-                         const json& data,
+                         const StrokeEndMsg& msg,
                          SendFunc sendFunc) {
         // Check if in room
-        if (roomId.empty() || oderId.empty()) {
+        if (!room || oderId.empty()) {
             return;
         }
 
-        // Validate data
-        if (!MessageCodec::validateStrokeEnd(data)) {
-            return;
-        }
-
-        std::string strokeId = data["strokeId"].get<std::string>();
-
-        auto error = roomService_.handleStrokeEnd(roomId, oderId, strokeId, sendFunc);
-        (void)error;
+        postTimed(room, MessageType::StrokeEnd, [&service = roomService_, room, oderId, sendFunc,
+                    strokeId = std::string(msg.strokeId)]() {
+            (void)service.handleStrokeEnd(*room, oderId, strokeId, sendFunc);
+        });
     }
 
     /**
      * @brief Handle stroke_move message.
      */
-    void handleStrokeMove(const std::string& roomId,
+    void handleStrokeMove(const std::shared_ptr<Room>& room,
                           const std::string& oderId,
-                          const json& data,
+                          const StrokeMoveMsg& msg,
                           SendFunc sendFunc) {
-        if (roomId.empty() || oderId.empty()) {
+        if (!room || oderId.empty()) {
             return;
         }
 
-        if (!MessageCodec::validateStrokeMove(data)) {
+        postTimed(room, MessageType::StrokeMove, [&service = roomService_, room, oderId, sendFunc,
+                    strokeId = std::string(msg.strokeId), dx = msg.dx, dy = msg.dy]() {
+            (void)service.handleStrokeMove(*room, oderId, strokeId, dx, dy, sendFunc);
+        });
+    }
+
+    /**
+     * @brief Handle viewport message.
+     */
+    void handleViewport(const std::shared_ptr<Room>& room,
+                        const std::string& oderId,
+                        const ViewportMsg& msg,
+                        SendFunc sendFunc) {
+        if (!room || oderId.empty()) {
             return;
         }
 
-        std::string strokeId = data["strokeId"].get<std::string>();
-        float dx = data["dx"].get<float>();
-        float dy = data["dy"].get<float>();
+        postTimed(room, MessageType::Viewport, [&service = roomService_, room, oderId, sendFunc, msg]() {
+            (void)service.handleViewport(*room, oderId,
+                                         Bounds::of(msg.x, msg.y, msg.width, msg.height), sendFunc);
+        });
+    }
 
-        auto error = roomService_.handleStrokeMove(roomId, oderId, strokeId, dx, dy, sendFunc);
-        (void)error;
+    /**
+     * @brief Post a room task that records the message's handling time when it finishes.
+     */
+    template <typename Task>
+    void postTimed(const std::shared_ptr<Room>& room, MessageType type, Task task) {
+        room->post([type, receivedNs = receivedNs_, task = std::move(task)]() mutable {
+            task();
+            ServerMetrics::global().handle(type).recordSince(receivedNs);
+        });
+    }
+
+    void recordHandled(MessageType type) {
+        ServerMetrics::global().handle(type).recordSince(receivedNs_);
     }
 
     /**
      * @brief Handle ping message.
      */
     void handlePing(std::shared_ptr<WsSession> session,
-                    const json& msg,
+                    const PingMsg& msg,
                     SendFunc sendFunc) {
-        uint64_t seq = MessageCodec::getSeq(msg);
-        std::string pong = MessageCodec::createPong(seq);
+        OutboundFrame pong = MessageCodec::createPong(msg.seq);
         sendFunc(session, pong);
     }
 
+    /**
+     * @brief Act on an ingress verdict.
+     * @return true if the message may be processed
+     */
+    bool admit(const std::shared_ptr<WsSession>& session,
+               IngressVerdict verdict,
+               SendFunc& sendFunc) {
+        switch (verdict) {
+            case IngressVerdict::Allow:
+                return true;
+            case IngressVerdict::Reject:
+                ServerMetrics::global().ingressRejected.add();
+                sendError(session, ErrorCode::RateLimited, sendFunc);
+                return false;
+            case IngressVerdict::Shed:
+                ServerMetrics::global().sessionsShed.add();
+                shed_ = true;
+                return false;
+            case IngressVerdict::Drop:
+            default:
+                ServerMetrics::global().ingressRejected.add();
+                return false;
+        }
+    }
+
     /**
      * @brief Send an error message to a session.
      */
     void sendError(std::shared_ptr<WsSession> session,
                    ErrorCode code,
                    SendFunc sendFunc) {
-        std::string errorMsg = MessageCodec::createError(code, 0);
+        OutboundFrame errorMsg = MessageCodec::createError(code, 0);
         sendFunc(session, errorMsg);
     }
 
     RoomService& roomService_;
+    MessageDecoder decoder_;       // Reused per session; buffers keep capacity
+    IngressLimiter ingress_;
+    bool shed_ = false;
+    int64_t receivedNs_ = 0;       // When the message being handled arrived
 };
 
 } // namespace collabboard
@@ -19,26 +19,34 @@ namespace collabboard{
  * - Drawing: Stroke creation and updates
  * - Heartbeat: Connection health checks
  * - State: Board synchronization
+ * - Transport: Framing of other messages
  */
 
 enum class MessageType {
    // Control messages (reliable, low frequency)
    JoinRoom,       // Client -> Server: Request to join a room
+   Resume,         // Client -> Server: Rejoin after a disconnect, from a known seq
    Welcome,        // Server -> Client: Successful join response
    UserJoined,     // Server -> All: New user joined
    UserLeft,       // Server -> All: User disconnected
 
    // Presence messages (loss-tolerant, high frequency)
    CursorMove,     // Bidirectional: Mouse position update
+   CursorBatch,    // Server -> Client: Every cursor that moved during one tick
 
    // Drawing messages (reliable, event-driven)
    StrokeStart,    // Client -> Server: Begin new stroke
    StrokeAdd,      // Client -> Server: Add points to stroke
    StrokeEnd,      // Client -> Server: Complete stroke
    StrokeMove,     // Client -> Server: Move completed stroke by dx, dy
+   Viewport,       // Client -> Server: The board area the client displays
 
    // State messages (reliable, on-demand)
    RoomState,      // Server -> Client: Full board snapshot
+   RoomStateBegin, // Server -> Client: Chunked snapshot follows
+   RoomStateChunk, // Server -> Client: Slice of a chunked snapshot, newest first
+   RoomStateEnd,   // Server -> Client: Chunked snapshot complete
+   RegionState,    // Server -> Client: Strokes that came into the client's viewport
 
    // Heartbeat messages (reliable, periodic)
    Ping,           // Client -> Server: Keep-alive request
@@ -47,10 +55,38 @@ enum class MessageType {
    // Error messages
    Error,          // Server -> Client: Error notification
 
+   // Transport messages
+   Batch,          // Server -> Client: Several messages packed into one frame
+
    // Unknown/Invalid
    Unknown         // Parsing failed or unrecognized type   
 };
 
+/**
+ * @brief How an outgoing message may be treated under backpressure.
+ */
+enum class DeliveryClass {
+    Reliable,       // Must be delivered, in order
+    LossTolerant,   // May be dropped or replaced by a newer message
+    Bulk            // Reliable and in order, but sent only when nothing else waits
+};
+
+/**
+ * @brief Get the delivery class of a message type.
+ */
+inline DeliveryClass deliveryClassOf(MessageType type) {
+    switch (type) {
+        case MessageType::CursorMove:
+        case MessageType::CursorBatch:
+            return DeliveryClass::LossTolerant;
+        case MessageType::RoomStateChunk:
+        case MessageType::RoomStateEnd:
+            return DeliveryClass::Bulk;
+        default:
+            return DeliveryClass::Reliable;
+    }
+}
+
 /**
  * @brief Error codes for protocol-level errors.
  */
@@ -59,6 +95,7 @@ enum class MessageType {
     RoomNotFound,       // Requested room does not exist
     RoomFull,           // Room has reached max capacity (15 users)
     InvalidPassword,    // Wrong room password
+    WrongNode,          // Room is owned by another cluster node
 
     // Message errors
     MalformedMessage,   // JSON parsing failed
@@ -87,24 +124,33 @@ enum class MessageType {
 
 namespace MessageTypeStrings {
     constexpr std::string_view JoinRoom    = "join_room";
+    constexpr std::string_view Resume      = "resume";
     constexpr std::string_view Welcome     = "welcome";
     constexpr std::string_view UserJoined  = "user_joined";
     constexpr std::string_view UserLeft    = "user_left";
     constexpr std::string_view CursorMove  = "cursor_move";
+    constexpr std::string_view CursorBatch = "cursor_batch";
     constexpr std::string_view StrokeStart = "stroke_start";
     constexpr std::string_view StrokeAdd   = "stroke_add";
     constexpr std::string_view StrokeEnd   = "stroke_end";
     constexpr std::string_view StrokeMove  = "stroke_move";
+    constexpr std::string_view Viewport    = "viewport";
     constexpr std::string_view RoomState   = "room_state";
+    constexpr std::string_view RoomStateBegin = "room_state_begin";
+    constexpr std::string_view RoomStateChunk = "room_state_chunk";
+    constexpr std::string_view RoomStateEnd   = "room_state_end";
+    constexpr std::string_view RegionState    = "region_state";
     constexpr std::string_view Ping        = "ping";
     constexpr std::string_view Pong        = "pong";
     constexpr std::string_view Error       = "error";
+    constexpr std::string_view Batch       = "batch";
 }
 
 namespace ErrorCodeStrings {
     constexpr std::string_view RoomNotFound      = "ROOM_NOT_FOUND";
     constexpr std::string_view RoomFull          = "ROOM_FULL";
     constexpr std::string_view InvalidPassword   = "INVALID_PASSWORD";
+    constexpr std::string_view WrongNode         = "WRONG_NODE";
     constexpr std::string_view MalformedMessage  = "MALFORMED_MESSAGE";
     constexpr std::string_view InvalidMessageType = "INVALID_MESSAGE_TYPE";
     constexpr std::string_view MissingField      = "MISSING_FIELD";
@@ -129,18 +175,26 @@ namespace ErrorCodeStrings {
  inline MessageType stringToMessageType(std::string_view typeStr) {
     static const std::unordered_map<std::string_view, MessageType> mapping = {
         {MessageTypeStrings::JoinRoom,    MessageType::JoinRoom},
+        {MessageTypeStrings::Resume,      MessageType::Resume},
         {MessageTypeStrings::Welcome,     MessageType::Welcome},
         {MessageTypeStrings::UserJoined,  MessageType::UserJoined},
         {MessageTypeStrings::UserLeft,    MessageType::UserLeft},
         {MessageTypeStrings::CursorMove,  MessageType::CursorMove},
+        {MessageTypeStrings::CursorBatch, MessageType::CursorBatch},
         {MessageTypeStrings::StrokeStart, MessageType::StrokeStart},
         {MessageTypeStrings::StrokeAdd,   MessageType::StrokeAdd},
         {MessageTypeStrings::StrokeEnd,   MessageType::StrokeEnd},
         {MessageTypeStrings::StrokeMove,  MessageType::StrokeMove},
+        {MessageTypeStrings::Viewport,    MessageType::Viewport},
         {MessageTypeStrings::RoomState,   MessageType::RoomState},
+        {MessageTypeStrings::RoomStateBegin, MessageType::RoomStateBegin},
+        {MessageTypeStrings::RoomStateChunk, MessageType::RoomStateChunk},
+        {MessageTypeStrings::RoomStateEnd,   MessageType::RoomStateEnd},
+        {MessageTypeStrings::RegionState,    MessageType::RegionState},
         {MessageTypeStrings::Ping,        MessageType::Ping},
         {MessageTypeStrings::Pong,        MessageType::Pong},
-        {MessageTypeStrings::Error,       MessageType::Error}
+        {MessageTypeStrings::Error,       MessageType::Error},
+        {MessageTypeStrings::Batch,       MessageType::Batch}
     };
 
     auto it = mapping.find(typeStr);
@@ -156,18 +210,26 @@ namespace ErrorCodeStrings {
 inline std::string_view messageTypeToString(MessageType type) {
     switch (type) {
         case MessageType::JoinRoom:    return MessageTypeStrings::JoinRoom;
+        case MessageType::Resume:      return MessageTypeStrings::Resume;
         case MessageType::Welcome:     return MessageTypeStrings::Welcome;
         case MessageType::UserJoined:  return MessageTypeStrings::UserJoined;
         case MessageType::UserLeft:    return MessageTypeStrings::UserLeft;
         case MessageType::CursorMove:  return MessageTypeStrings::CursorMove;
+        case MessageType::CursorBatch: return MessageTypeStrings::CursorBatch;
         case MessageType::StrokeStart: return MessageTypeStrings::StrokeStart;
         case MessageType::StrokeAdd:   return MessageTypeStrings::StrokeAdd;
         case MessageType::StrokeEnd:   return MessageTypeStrings::StrokeEnd;
         case MessageType::StrokeMove:  return MessageTypeStrings::StrokeMove;
+        case MessageType::Viewport:    return MessageTypeStrings::Viewport;
         case MessageType::RoomState:   return MessageTypeStrings::RoomState;
+        case MessageType::RoomStateBegin: return MessageTypeStrings::RoomStateBegin;
+        case MessageType::RoomStateChunk: return MessageTypeStrings::RoomStateChunk;
+        case MessageType::RoomStateEnd:   return MessageTypeStrings::RoomStateEnd;
+        case MessageType::RegionState:    return MessageTypeStrings::RegionState;
         case MessageType::Ping:        return MessageTypeStrings::Ping;
         case MessageType::Pong:        return MessageTypeStrings::Pong;
         case MessageType::Error:       return MessageTypeStrings::Error;
+        case MessageType::Batch:       return MessageTypeStrings::Batch;
         case MessageType::Unknown:
         default:
             throw std::invalid_argument("Cannot convert Unknown message type to string");
@@ -184,6 +246,7 @@ inline std::string_view errorCodeToString(ErrorCode code) {
         case ErrorCode::RoomNotFound:       return ErrorCodeStrings::RoomNotFound;
         case ErrorCode::RoomFull:           return ErrorCodeStrings::RoomFull;
         case ErrorCode::InvalidPassword:    return ErrorCodeStrings::InvalidPassword;
+        case ErrorCode::WrongNode:          return ErrorCodeStrings::WrongNode;
         case ErrorCode::MalformedMessage:   return ErrorCodeStrings::MalformedMessage;
         case ErrorCode::InvalidMessageType: return ErrorCodeStrings::InvalidMessageType;
         case ErrorCode::MissingField:       return ErrorCodeStrings::MissingField;
@@ -212,6 +275,8 @@ inline std::string_view errorCodeToMessage(ErrorCode code) {
             return "Room has reached maximum capacity (15 users)";
         case ErrorCode::InvalidPassword:
             return "Incorrect room password";
+        case ErrorCode::WrongNode:
+            return "Room is served by another node";
         case ErrorCode::MalformedMessage:
             return "Message format is invalid";
         case ErrorCode::InvalidMessageType:
@@ -243,22 +308,66 @@ inline std::string_view errorCodeToMessage(ErrorCode code) {
 namespace ProtocolConstants {
     // Room limits
     constexpr size_t MaxUsersPerRoom = 15;
-    constexpr size_t MaxStrokesPerRoom = 1000;
+    constexpr size_t MaxStrokesPerRoom = 10000;   // Joins with a viewport only get what is in it
     constexpr size_t SnapshotStrokeLimit = 500;
     constexpr size_t SnapshotStrokeLimitSmall = 200;
+    constexpr size_t SnapshotChunkBytes = 16 * 1024;  // Target JSON size of one room_state_chunk
+    constexpr int SnapshotWorkerThreads = 2;      // Threads building join snapshots (0 = inline)
+    constexpr size_t RoomRegistryShards = 16;     // Independent locks in the room registry
+    constexpr size_t ReplayLogFrames = 4096;      // Board broadcasts kept for resume
+    constexpr size_t ReplayLogBytes = 2 * 1024 * 1024;
+    constexpr size_t ResumeTokensPerRoom = 1024;  // Departed users' tokens dropped past this
+    constexpr size_t StorageCompactRecords = 4096; // Log records per room before compacting
+    constexpr size_t StorageOpenLogs = 256;        // Log files the writer keeps open
+    constexpr size_t RoomBoardBudgetBytes = 16 * 1024 * 1024;  // Stroke memory per room
+    constexpr size_t ClusterVirtualNodes = 128;   // Hash ring points per cluster node
+    constexpr size_t StrokePointSlab = 256;        // Points a live stroke starts with room for
+    constexpr size_t PointPoolBuffers = 8;         // Slabs a room keeps for reuse
+    constexpr float SpatialCellSize = 256.0f;      // Side of a stroke index cell, in px
+    constexpr float ViewportMargin = 128.0f;       // Strokes this close to a viewport count as in it
 
     // Message limits
     constexpr size_t MaxMessageSize = 64 * 1024;  // 64 KB
     constexpr size_t MaxPointsPerStroke = 10000;
+    constexpr size_t MaxStrokeIdLength = 16 * 1024;  // Text strokes carry their text in the ID
+    constexpr size_t MaxBatchBytes = 16 * 1024;   // Cap on one outgoing batch frame
+
+    // Stroke compaction at stroke_end (when enabled)
+    constexpr float StrokeSimplifyTolerance = 0.5f;   // Max deviation in px (Douglas-Peucker)
+    constexpr float StrokeGridStep = 0.125f;          // Stored coordinates snap to 1/8 px
+
+    // Outbound backpressure (per session)
+    constexpr size_t OutboundSoftLimitBytes = 512 * 1024;       // Drop loss-tolerant frames
+    constexpr size_t OutboundHardLimitBytes = 8 * 1024 * 1024;  // Disconnect the client
+
+    // permessage-deflate (per session, when WS_DEFLATE enables it)
+    constexpr int DeflateLevel = 3;               // Fast; most of the gain on JSON
+    constexpr int DeflateWindowBits = 12;         // With DeflateMemLevel, ~24 KB state per session
+    constexpr int DeflateMemLevel = 4;
 
     // Timing (in milliseconds)
     constexpr int HeartbeatIntervalMs = 10000;    // 10 seconds
     constexpr int HeartbeatTimeoutMs = 30000;     // 30 seconds
     constexpr int GhostCursorTimeoutMs = 3000;    // 3 seconds
     constexpr int RateLimitMuteDurationMs = 10000; // 10 seconds
+    constexpr int CursorTickIntervalMs = 50;      // Presence tick (0 = per-move broadcast)
+    constexpr int RoomReapIntervalMs = 1000;      // Sweep for empty rooms past their grace
+    constexpr int MaintenanceIntervalMs = 5000;   // Heartbeats, ghosts, limiters, hibernation
+    constexpr int RoomHibernateAfterMs = 120000;  // Board idle this long drops its caches
+    constexpr int RateLimiterIdleSeconds = 300;   // Unused buckets kept this long
 
     // Rate limiting
     constexpr double CursorUpdatesPerSecond = 20.0;
     constexpr double RateLimitBurstSize = 5.0;
+
+    // Ingress budgets (per session, all messages)
+    constexpr double IngressMessagesPerSecond = 200.0;
+    constexpr double IngressMessageBurst = 400.0;
+    constexpr double IngressPointsPerSecond = 5000.0;
+    constexpr double IngressPointBurst = 10000.0;     // >= MaxPointsPerStroke
+    constexpr double IngressBytesPerSecond = 256.0 * 1024;
+    constexpr double IngressByteBurst = 512.0 * 1024; // >= MaxMessageSize
+    constexpr int IngressViolationsBeforeMute = 50;   // Rejected messages per mute
+    constexpr int IngressMutesBeforeShed = 3;         // Mutes before disconnecting
 }
 }
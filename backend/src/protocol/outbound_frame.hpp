@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+
+#include "message_types.hpp"
+
+namespace collabboard {
+
+// Forward declaration
+class WsSession;
+
+/**
+ * @brief Immutable, reference-counted outgoing message.
+ *
+ * A frame is serialized once and then shared by every recipient of a
+ * broadcast. Copying an OutboundFrame only bumps a reference count, so the
+ * payload bytes are never duplicated on the way to the socket.
+ *
+ * Besides the bytes, a frame records its message type and an optional
+ * conflation key (e.g. the user a cursor frame belongs to) so session
+ * queues can apply per-class policy without re-parsing.
+ *
+ * Hot-path messages also carry a binary encoding when the room has a
+ * binary client. A session that negotiated the binary protocol sends
+ * asBinary() views of its frames; the view shares the same payload and
+ * only selects which bytes go out, falling back to the JSON text if the
+ * frame was built without one.
+ */
+class OutboundFrame {
+public:
+    OutboundFrame() = default;
+
+    explicit OutboundFrame(std::string payload,
+                           MessageType type = MessageType::Unknown,
+                           std::string conflationKey = "",
+                           std::string binaryPayload = "")
+        : payload_(std::make_shared<const Payload>(
+              Payload{std::move(payload), std::move(binaryPayload),
+                      type, std::move(conflationKey)}))
+        , binary_(false)
+    {}
+
+    /**
+     * @brief Get the bytes this frame puts on the wire.
+     * JSON text, or the binary encoding for an asBinary() view.
+     */
+    const std::string& str() const {
+        if (!payload_) return emptyString();
+        return binary_ ? payload_->binaryBytes : payload_->bytes;
+    }
+
+    const char* data() const { return str().data(); }
+    size_t size() const { return str().size(); }
+    bool empty() const { return str().empty(); }
+
+    /**
+     * @brief View the payload as a string.
+     * Lets string-based callbacks (logging, tests) accept frames directly.
+     */
+    operator const std::string&() const { return str(); }
+
+    MessageType type() const {
+        return payload_ ? payload_->type : MessageType::Unknown;
+    }
+
+    DeliveryClass deliveryClass() const {
+        return deliveryClassOf(type());
+    }
+
+    /**
+     * @brief Key identifying frames that supersede each other.
+     * A newer loss-tolerant frame with the same key replaces an older one.
+     */
+    std::string_view conflationKey() const {
+        return payload_ ? std::string_view(payload_->conflationKey) : std::string_view();
+    }
+
+    /**
+     * @brief Check if a binary encoding is available for this message.
+     */
+    bool hasBinary() const {
+        return payload_ && !payload_->binaryBytes.empty();
+    }
+
+    /**
+     * @brief Bytes the frame holds in memory: both encodings.
+     */
+    size_t payloadBytes() const {
+        return payload_ ? payload_->bytes.size() + payload_->binaryBytes.size() : 0;
+    }
+
+    /**
+     * @brief Check if this frame goes out as a WebSocket binary message.
+     */
+    bool isBinary() const { return binary_; }
+
+    /**
+     * @brief View of this frame that sends the binary encoding if there is one.
+     * Frames without a binary encoding are returned unchanged (as text).
+     */
+    OutboundFrame asBinary() const {
+        OutboundFrame view = *this;
+        view.binary_ = hasBinary();
+        return view;
+    }
+
+    /**
+     * @brief Check if two frames share the same payload buffer.
+     */
+    bool sharesPayloadWith(const OutboundFrame& other) const {
+        return payload_ && payload_ == other.payload_;
+    }
+
+private:
+    struct Payload {
+        std::string bytes;           // JSON text
+        std::string binaryBytes;     // Binary encoding (empty if none)
+        MessageType type;
+        std::string conflationKey;
+    };
+
+    static const std::string& emptyString() {
+        static const std::string empty;
+        return empty;
+    }
+
+    std::shared_ptr<const Payload> payload_;
+    bool binary_ = false;
+};
+
+/**
+ * @brief Callback used by services to hand a frame to a session.
+ */
+using FrameSendFunc = std::function<void(std::shared_ptr<WsSession>, const OutboundFrame&)>;
+
+} // namespace collabboard
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+
+#include "message_types.hpp"
+#include "message_codec.hpp"
+#include "binary_codec.hpp"
+#include "json_writer.hpp"
+#include "outbound_frame.hpp"
+#include "../models/stroke_store.hpp"
+#include "../utils/metrics.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief A board snapshot split for progressive delivery.
+ *
+ * begin announces the snapshot, chunks[0] holds the newest strokes and
+ * each later chunk older ones (oldest first within a chunk), and end
+ * closes it. All frames carry JSON, and binary too if it was built for
+ * a binary client.
+ */
+struct SnapshotChunks {
+    uint64_t snapshotSeq = 0;
+    size_t strokeCount = 0;
+    OutboundFrame begin;
+    std::vector<OutboundFrame> chunks;
+    OutboundFrame end;
+};
+
+/**
+ * @brief The frames that bring a joining client up to date, in send order,
+ *        and the sequence number they were built at.
+ */
+struct BoardSnapshot {
+    uint64_t snapshotSeq = 0;
+    std::vector<OutboundFrame> frames;
+};
+
+/**
+ * @brief A join snapshot taken from the board under the room lock and
+ *        built outside it.
+ *
+ * SnapshotCache::prepare() fills it with what the build needs: the
+ * stored encoding of each up-to-date stroke (shared, never copied) and a
+ * copy of each stroke whose encoding is stale. build() encodes those and
+ * assembles the frames without touching the room; adopt() then hands the
+ * new encodings and frames back to the cache under the lock again.
+ */
+struct SnapshotJob {
+    struct Source {
+        std::shared_ptr<const EncodedStroke> encoded;  // Null until built if stale
+        std::optional<Stroke> stale;                  // Copy to encode
+        std::shared_ptr<Stroke> handle;               // Where the encoding goes back
+    };
+
+    uint64_t boardVersion = 0;
+    size_t limit = 0;
+    size_t chunkBytes = 0;
+    bool chunked = false;
+    bool viewport = false;
+    bool binary = false;                              // Build binary encodings too
+    std::vector<Source> sources;                      // Oldest first
+    size_t encodedCount = 0;
+
+    bool built = false;                               // snapshot is ready
+    BoardSnapshot snapshot;
+    std::shared_ptr<const SnapshotChunks> chunks;     // If chunked
+};
+
+/**
+ * @brief Incrementally maintained room_state frames for one room.
+ *
+ * Each stroke's JSON and binary entries are encoded once and kept in its
+ * StrokeStore slot until the stroke's version changes, so building a new
+ * snapshot only re-encodes strokes that are in progress or were moved and
+ * then concatenates. The finished frames are reused as long as the board
+ * is unchanged, so everyone joining in between shares one payload.
+ *
+ * The binary encoding is only built for a binary client: a text-only
+ * snapshot leaves it out, and is not reused for a binary client later.
+ *
+ * Not thread-safe; Room calls it with its mutex held, except for the
+ * static build(), which only reads its SnapshotJob.
+ */
+class SnapshotCache {
+public:
+    /**
+     * @brief Get the room_state frame for the newest strokes.
+     * @param boardVersion Room's board mutation count; the cached frame is
+     *        reused while it (and the limit) is unchanged
+     * @param seq Sequence number stamped on a newly built frame
+     */
+    OutboundFrame get(StrokeStore& strokes, size_t limit,
+                      uint64_t boardVersion, uint64_t seq) {
+        SnapshotJob job = prepare(strokes, limit, false, std::nullopt, boardVersion, seq);
+        complete(strokes, job, boardVersion);
+        return job.snapshot.frames.front();
+    }
+
+    /**
+     * @brief Get the same snapshot split into room_state_chunk frames.
+     *
+     * Chunks are filled newest stroke first until adding the next stroke
+     * would take the chunk's JSON past chunkBytes; a chunk always holds at
+     * least one stroke. An empty board yields begin and end only.
+     */
+    std::shared_ptr<const SnapshotChunks> getChunks(StrokeStore& strokes, size_t limit,
+                                                    uint64_t boardVersion, uint64_t seq,
+                                                    size_t chunkBytes = ProtocolConstants::SnapshotChunkBytes) {
+        SnapshotJob job = prepare(strokes, limit, true, std::nullopt, boardVersion, seq, chunkBytes);
+        complete(strokes, job, boardVersion);
+        return job.chunks;
+    }
+
+    /**
+     * @brief Start the snapshot for a joining client.
+     *
+     * The newest strokes (up to limit), or with a viewport the newest of
+     * those whose extent overlaps it; one room_state, or begin/chunk/end
+     * frames laid out like getChunks() if chunked. A full snapshot still
+     * cached for boardVersion comes back built.
+     *
+     * @param seq Sequence number the snapshot is taken at
+     * @param binary Include the binary encoding (for a binary client)
+     */
+    SnapshotJob prepare(StrokeStore& strokes, size_t limit, bool chunked,
+                        const std::optional<Bounds>& viewport, uint64_t boardVersion, uint64_t seq,
+                        size_t chunkBytes = ProtocolConstants::SnapshotChunkBytes,
+                        bool binary = true) {
+        SnapshotJob job;
+        job.boardVersion = boardVersion;
+        job.limit = limit;
+        job.chunkBytes = chunkBytes;
+        job.chunked = chunked;
+        job.viewport = viewport.has_value();
+        job.binary = binary;
+        job.snapshot.snapshotSeq = seq;
+
+        if (!viewport && chunked && chunks_ && boardVersion == chunksVersion_ &&
+            limit == chunksLimit_ && chunkBytes == chunkBytes_ && (chunksBinary_ || !binary)) {
+            job.built = true;
+            job.chunks = chunks_;
+            job.snapshot = flatten(*chunks_);
+            return job;
+        }
+        if (!viewport && !chunked && frame_ && boardVersion == frameVersion_ &&
+            limit == frameLimit_ && (frame_->hasBinary() || !binary)) {
+            job.built = true;
+            job.snapshot.snapshotSeq = frameSeq_;
+            job.snapshot.frames.push_back(*frame_);
+            return job;
+        }
+
+        if (viewport) {
+            // Oldest first, like forEachNewest(); only the newest limit are kept
+            std::vector<std::pair<const Stroke*, StrokeFragment*>> inView;
+            strokes.forEachIn(*viewport, [&](const Stroke& stroke, StrokeFragment& fragment) {
+                inView.emplace_back(&stroke, &fragment);
+            });
+            size_t skip = inView.size() > limit ? inView.size() - limit : 0;
+            job.sources.reserve(inView.size() - skip);
+            for (size_t i = skip; i < inView.size(); ++i) {
+                addSource(job, strokes, *inView[i].first, *inView[i].second);
+            }
+        } else {
+            job.sources.reserve(std::min(limit, strokes.size()));
+            strokes.forEachNewest(limit, [&](const Stroke& stroke, StrokeFragment& fragment) {
+                addSource(job, strokes, stroke, fragment);
+            });
+        }
+        return job;
+    }
+
+    /**
+     * @brief Encode a prepared job's stale strokes and assemble its frames.
+     *
+     * Reads only the job, so it runs without the room lock; a job that
+     * came back built is left as it is.
+     */
+    static void build(SnapshotJob& job) {
+        if (job.built) {
+            return;
+        }
+        int64_t startNs = metricNowNs();
+        JsonWriter scratch;
+        std::vector<const EncodedStroke*> entries;
+        entries.reserve(job.sources.size());
+        for (SnapshotJob::Source& source : job.sources) {
+            if (!source.encoded) {
+                source.encoded = encode(*source.stale, scratch, job.binary);
+                source.stale.reset();
+                ++job.encodedCount;
+            }
+            entries.push_back(source.encoded.get());
+        }
+
+        uint64_t seq = job.snapshot.snapshotSeq;
+        size_t bytes = 0;
+        if (job.chunked) {
+            auto chunks = std::make_shared<SnapshotChunks>(buildChunks(entries, seq, job.chunkBytes, job.binary));
+            for (const auto& chunk : chunks->chunks) {
+                bytes += chunk.size();
+            }
+            job.snapshot = flatten(*chunks);
+            job.chunks = std::move(chunks);
+        } else {
+            job.snapshot.frames.push_back(buildState(MessageType::RoomState, entries, seq,
+                                                     job.binary));
+            bytes = job.snapshot.frames.back().size();
+        }
+        job.built = true;
+        recordBuild(startNs, bytes);
+    }
+
+    /**
+     * @brief Take back what build() produced: each new encoding goes to
+     *        its slot if the stroke is unchanged, and a full snapshot is
+     *        cached if the board still is at the job's boardVersion.
+     */
+    void adopt(StrokeStore& strokes, const SnapshotJob& job, uint64_t boardVersion) {
+        fragmentsEncoded_ += job.encodedCount;
+        if (job.encodedCount > 0) {
+            for (const SnapshotJob::Source& source : job.sources) {
+                if (!source.handle) {
+                    continue;
+                }
+                strokes.withFragment(source.handle->strokeId, [&](const Stroke& stroke,
+                                                                  StrokeFragment& fragment) {
+                    if (&stroke == source.handle.get() &&
+                        stroke.version == source.encoded->version &&
+                        !fragment.current(stroke, job.binary)) {
+                        fragment.encoded = source.encoded;
+                    }
+                });
+            }
+        }
+        if (job.viewport) {
+            return;                       // Viewports differ; nothing to reuse
+        }
+        ++framesBuilt_;
+        if (boardVersion != job.boardVersion) {
+            return;
+        }
+        if (job.chunked) {
+            chunks_ = job.chunks;
+            chunksVersion_ = job.boardVersion;
+            chunksLimit_ = job.limit;
+            chunkBytes_ = job.chunkBytes;
+            chunksBinary_ = job.binary;
+        } else {
+            frame_ = job.snapshot.frames.front();
+            frameVersion_ = job.boardVersion;
+            frameSeq_ = job.snapshot.snapshotSeq;
+            frameLimit_ = job.limit;
+        }
+    }
+
+    /**
+     * @brief A region_state with the strokes overlapping area that do not
+     *        overlap known, the area the client already holds.
+     * @param binary Include the binary encoding
+     * @return nullopt if there are none
+     */
+    std::optional<OutboundFrame> getRegion(StrokeStore& strokes, const Bounds& area,
+                                           const std::optional<Bounds>& known, uint64_t seq,
+                                           bool binary = true) {
+        std::vector<const EncodedStroke*> fragments;
+        strokes.forEachIn(area, [&](const Stroke& stroke, StrokeFragment& fragment) {
+            if (!known || !stroke.extent().intersects(*known)) {
+                fragments.push_back(&fresh(stroke, fragment, binary));
+            }
+        });
+        if (fragments.empty()) {
+            return std::nullopt;
+        }
+        return buildState(MessageType::RegionState, fragments, seq, binary);
+    }
+
+    /**
+     * @brief A region_state carrying one stroke whole.
+     * @return nullopt if the stroke is not stored
+     */
+    std::optional<OutboundFrame> getStrokeRegion(StrokeStore& strokes, const std::string& strokeId,
+                                                 uint64_t seq, bool binary = true) {
+        std::optional<OutboundFrame> frame;
+        strokes.withFragment(strokeId, [&](const Stroke& stroke, StrokeFragment& fragment) {
+            frame = buildState(MessageType::RegionState, {&fresh(stroke, fragment, binary)}, seq,
+                               binary);
+        });
+        return frame;
+    }
+
+    /**
+     * @brief Drop the cached frames and scratch memory; the next get() or
+     *        getChunks() rebuilds. Stroke fragments live in the StrokeStore.
+     */
+    void clear() {
+        frame_.reset();
+        chunks_.reset();
+        jsonScratch_ = JsonWriter();
+    }
+
+    /**
+     * @brief snapshotSeq of the frame get() last returned.
+     */
+    uint64_t frameSeq() const { return frameSeq_; }
+
+    /**
+     * @brief Number of stroke entries encoded so far (for tests/metrics).
+     */
+    uint64_t fragmentsEncoded() const { return fragmentsEncoded_; }
+
+    /**
+     * @brief Number of snapshots assembled so far (for tests/metrics).
+     */
+    uint64_t framesBuilt() const { return framesBuilt_; }
+
+private:
+    static void recordBuild(int64_t startNs, size_t jsonBytes) {
+        ServerMetrics& metrics = ServerMetrics::global();
+        metrics.snapshotBuildNs.recordSince(startNs);
+        metrics.snapshotBytes.record(jsonBytes);
+    }
+
+    /**
+     * @brief Complete a job in place, for callers already holding the lock.
+     */
+    void complete(StrokeStore& strokes, SnapshotJob& job, uint64_t boardVersion) {
+        if (job.built) {
+            return;
+        }
+        build(job);
+        adopt(strokes, job, boardVersion);
+    }
+
+    static void addSource(SnapshotJob& job, StrokeStore& strokes,
+                          const Stroke& stroke, const StrokeFragment& fragment) {
+        SnapshotJob::Source source;
+        if (fragment.current(stroke, job.binary)) {
+            source.encoded = fragment.encoded;
+        } else {
+            source.stale = stroke;
+            source.handle = strokes.find(stroke.strokeId);
+            if (source.handle.get() != &stroke) {
+                source.handle.reset();    // A repeated ID; find() has the other one
+            }
+        }
+        job.sources.push_back(std::move(source));
+    }
+
+    static BoardSnapshot flatten(const SnapshotChunks& chunks) {
+        BoardSnapshot snapshot;
+        snapshot.snapshotSeq = chunks.snapshotSeq;
+        snapshot.frames.reserve(chunks.chunks.size() + 2);
+        snapshot.frames.push_back(chunks.begin);
+        snapshot.frames.insert(snapshot.frames.end(), chunks.chunks.begin(), chunks.chunks.end());
+        snapshot.frames.push_back(chunks.end);
+        return snapshot;
+    }
+
+    const EncodedStroke& fresh(const Stroke& stroke, StrokeFragment& fragment, bool binary) {
+        if (!fragment.current(stroke, binary)) {
+            // Not JsonWriter::scratch(): writeMessage may be using it
+            fragment.encoded = encode(stroke, jsonScratch_, binary);
+            ++fragmentsEncoded_;
+        }
+        return *fragment.encoded;
+    }
+
+    /**
+     * @brief Split fragments (oldest first) into begin/chunk/end frames.
+     *
+     * Walks newest to oldest, closing a chunk when adding the next stroke
+     * would take its JSON past chunkBytes; a chunk always holds at least
+     * one stroke.
+     */
+    static SnapshotChunks buildChunks(const std::vector<const EncodedStroke*>& fragments,
+                                      uint64_t seq, size_t chunkBytes, bool binary) {
+        SnapshotChunks result;
+        result.snapshotSeq = seq;
+        result.strokeCount = fragments.size();
+
+        size_t end = fragments.size();
+        while (end > 0) {
+            size_t begin = end - 1;
+            size_t bytes = fragments[begin]->json.size();
+            while (begin > 0 && bytes + fragments[begin - 1]->json.size() + 1 <= chunkBytes) {
+                --begin;
+                bytes += fragments[begin]->json.size() + 1;
+            }
+            result.chunks.push_back(buildChunk(fragments, begin, end, result.chunks.size(), seq,
+                                               binary));
+            end = begin;
+        }
+
+        result.begin = buildBegin(seq, result.strokeCount, result.chunks.size(), binary);
+        result.end = buildEnd(seq, binary);
+        return result;
+    }
+
+    /**
+     * @brief A room_state or region_state frame: the seq, then the entries.
+     * The binary encoding is left empty unless binary is set.
+     */
+    static OutboundFrame buildState(MessageType type,
+                                    const std::vector<const EncodedStroke*>& fragments,
+                                    uint64_t seq, bool binary) {
+        bool region = type == MessageType::RegionState;
+        std::string text = MessageCodec::writeMessage(type, seq, [&](JsonWriter& w) {
+            w.raw(region ? R"({"regionSeq":)" : R"({"snapshotSeq":)").number(seq)
+             .raw(R"(,"strokes":[)");
+            for (size_t i = 0; i < fragments.size(); ++i) {
+                if (i > 0) w.raw(',');
+                w.raw(fragments[i]->json);
+            }
+            w.raw("]}");
+        });
+        if (!binary) {
+            return OutboundFrame(std::move(text), type);
+        }
+
+        size_t binaryBytes = 24;
+        for (const EncodedStroke* fragment : fragments) {
+            binaryBytes += fragment->binary.size();
+        }
+        BinaryWriter out(binaryBytes);
+        out.header(region ? BinaryTag::RegionState : BinaryTag::RoomState, seq);
+        out.varint(seq);
+        out.varint(fragments.size());
+        for (const EncodedStroke* fragment : fragments) {
+            out.bytes(fragment->binary);
+        }
+        return OutboundFrame(std::move(text), type, "", out.take());
+    }
+
+    static std::shared_ptr<const EncodedStroke> encode(const Stroke& stroke, JsonWriter& scratch,
+                                                       bool binary) {
+        auto encoded = std::make_shared<EncodedStroke>();
+        scratch.clear();
+        MessageCodec::writeStroke(scratch, stroke);
+        encoded->json = scratch.view();
+
+        if (binary) {
+            BinaryWriter out(64 + stroke.points.size() * 2 * sizeof(float));
+            BinaryCodec::writeStroke(out, stroke);
+            encoded->binary = out.take();
+        }
+        encoded->version = stroke.version;
+        return encoded;
+    }
+
+    static OutboundFrame buildBegin(uint64_t seq, size_t strokeCount, size_t chunkCount,
+                                    bool binary) {
+        std::string text = MessageCodec::writeMessage(MessageType::RoomStateBegin, seq, [&](JsonWriter& w) {
+            w.raw(R"({"chunks":)").number(static_cast<uint64_t>(chunkCount))
+             .raw(R"(,"snapshotSeq":)").number(seq)
+             .raw(R"(,"strokes":)").number(static_cast<uint64_t>(strokeCount)).raw('}');
+        });
+        if (!binary) {
+            return OutboundFrame(std::move(text), MessageType::RoomStateBegin);
+        }
+        BinaryWriter out(32);
+        out.header(BinaryTag::RoomStateBegin, seq);
+        out.varint(seq);
+        out.varint(strokeCount);
+        out.varint(chunkCount);
+        return OutboundFrame(std::move(text), MessageType::RoomStateBegin, "", out.take());
+    }
+
+    static OutboundFrame buildChunk(const std::vector<const EncodedStroke*>& fragments,
+                                    size_t begin, size_t end, size_t index, uint64_t seq,
+                                    bool binary) {
+        std::string text = MessageCodec::writeMessage(MessageType::RoomStateChunk, seq, [&](JsonWriter& w) {
+            w.raw(R"({"index":)").number(static_cast<uint64_t>(index))
+             .raw(R"(,"snapshotSeq":)").number(seq)
+             .raw(R"(,"strokes":[)");
+            for (size_t i = begin; i < end; ++i) {
+                if (i > begin) w.raw(',');
+                w.raw(fragments[i]->json);
+            }
+            w.raw("]}");
+        });
+        if (!binary) {
+            return OutboundFrame(std::move(text), MessageType::RoomStateChunk);
+        }
+
+        size_t binaryBytes = 32;
+        for (size_t i = begin; i < end; ++i) {
+            binaryBytes += fragments[i]->binary.size();
+        }
+        BinaryWriter out(binaryBytes);
+        out.header(BinaryTag::RoomStateChunk, seq);
+        out.varint(seq);
+        out.varint(index);
+        out.varint(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            out.bytes(fragments[i]->binary);
+        }
+        return OutboundFrame(std::move(text), MessageType::RoomStateChunk, "", out.take());
+    }
+
+    static OutboundFrame buildEnd(uint64_t seq, bool binary) {
+        std::string text = MessageCodec::writeMessage(MessageType::RoomStateEnd, seq, [&](JsonWriter& w) {
+            w.raw(R"({"snapshotSeq":)").number(seq).raw('}');
+        });
+        if (!binary) {
+            return OutboundFrame(std::move(text), MessageType::RoomStateEnd);
+        }
+        BinaryWriter out(16);
+        out.header(BinaryTag::RoomStateEnd, seq);
+        out.varint(seq);
+        return OutboundFrame(std::move(text), MessageType::RoomStateEnd, "", out.take());
+    }
+
+    std::optional<OutboundFrame> frame_;
+    uint64_t frameVersion_ = 0;
+    uint64_t frameSeq_ = 0;
+    size_t frameLimit_ = 0;
+
+    std::shared_ptr<const SnapshotChunks> chunks_;
+    uint64_t chunksVersion_ = 0;
+    size_t chunksLimit_ = 0;
+    size_t chunkBytes_ = 0;
+    bool chunksBinary_ = false;
+
+    JsonWriter jsonScratch_;
+    uint64_t fragmentsEncoded_ = 0;
+    uint64_t framesBuilt_ = 0;
+};
+
+} // namespace collabboard
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <boost/beast/websocket/option.hpp>
+
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief permessage-deflate settings. Off unless WS_DEFLATE turns it on.
+ *
+ * Once negotiated, Beast compresses every message on the connection, so
+ * a cursor frame of 60 bytes is deflated once per recipient; with many
+ * rooms of scribbling users that costs more CPU than it saves in egress.
+ * Turn it on where bandwidth matters more, e.g. clients on slow links
+ * loading large snapshots.
+ *
+ * Deflate state is per connection, so the window and memory level are
+ * kept small: snapshots and point arrays still shrink several times,
+ * and ten thousand sessions do not cost gigabytes of zlib state.
+ */
+struct DeflatePolicy {
+    bool enabled = false;
+    int level = ProtocolConstants::DeflateLevel;
+    int memLevel = ProtocolConstants::DeflateMemLevel;
+    int windowBits = ProtocolConstants::DeflateWindowBits;   // 9..15
+
+    /**
+     * @brief The extension offer for the server role.
+     */
+    boost::beast::websocket::permessage_deflate option() const {
+        boost::beast::websocket::permessage_deflate pmd;
+        pmd.server_enable = enabled;
+        pmd.compLevel = level;
+        pmd.memLevel = memLevel;
+        pmd.server_max_window_bits = windowBits;
+        pmd.client_max_window_bits = windowBits;
+        return pmd;
+    }
+};
+
+} // namespace collabboard
@@ -2,19 +2,23 @@
 
 /**
  * @file http_connection.hpp
- * @brief Handles initial HTTP request - routes /health to HTTP response, else to WebSocket.
+ * @brief Handles initial HTTP request - routes /health, /stats, /metrics and /route to HTTP responses, else to WebSocket.
  */
 
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
 #include "ws_session.hpp"
+#include "server_config.hpp"
 #include "../services/room_service.hpp"
+#include "../protocol/json_writer.hpp"
+#include "../utils/metrics.hpp"
 
 namespace collabboard {
 
@@ -25,13 +29,16 @@ using tcp = boost::asio::ip::tcp;
 
 /**
  * @brief Handles the initial HTTP request. Routes GET /health to a 200 response,
- *        all other requests to WebSocket upgrade.
+ *        GET /stats to the server's counters as JSON, GET /metrics to
+ *        Prometheus text, GET /route?room=ID to the cluster node that
+ *        serves the room, and all other requests to WebSocket upgrade.
  */
 class HttpConnection : public std::enable_shared_from_this<HttpConnection> {
 public:
-    HttpConnection(tcp::socket&& socket, RoomService& roomService)
+    HttpConnection(tcp::socket&& socket, RoomService& roomService, const ServerConfig& config)
         : socket_(std::move(socket))
         , roomService_(roomService)
+        , config_(config)
     {}
 
     void run() {
@@ -64,37 +71,160 @@ private:
             return;
         }
 
+        if (req.method() == http::verb::get &&
+            req.target() == "/stats") {
+            sendResponse("application/json", statsToJson(roomService_.getStats()));
+            return;
+        }
+
+        if (req.method() == http::verb::get &&
+            req.target() == "/metrics") {
+            sendResponse("text/plain; version=0.0.4", renderMetrics());
+            return;
+        }
+
+        if (req.method() == http::verb::get &&
+            req.target().starts_with("/route?")) {
+            std::string_view target(req.target().data(), req.target().size());
+            sendResponse("application/json", routeToJson(queryParam(target, "room")));
+            return;
+        }
+
         // WebSocket upgrade - pass to WsSession
         upgradeToWebSocket(req);
     }
 
     void sendHealthResponse() {
-        http::response<http::string_body> res{http::status::ok, 11};
-        res.set(http::field::server, "CollabBoard/1.0");
-        res.set(http::field::content_type, "text/plain");
-        res.body() = "OK";
-        res.prepare_payload();
+        sendResponse("text/plain", "OK");
+    }
+
+    /**
+     * @brief Write a 200 response and close. The response lives in a member
+     *        until the write completes.
+     */
+    void sendResponse(const char* contentType, std::string body) {
+        response_.emplace(http::status::ok, 11);
+        response_->set(http::field::server, "CollabBoard/1.0");
+        response_->set(http::field::content_type, contentType);
+        response_->body() = std::move(body);
+        response_->prepare_payload();
 
         auto self = shared_from_this();
         http::async_write(
             socket_,
-            res,
+            *response_,
             [self](beast::error_code ec, std::size_t) {
                 beast::error_code closeEc;
                 self->socket_.shutdown(tcp::socket::shutdown_both, closeEc);
             });
     }
 
+    std::string renderMetrics() const {
+        PrometheusWriter out;
+        ServerMetrics::global().write(out);
+        config_.write(out);
+        ServerStats stats = roomService_.getStats(0);
+        out.gauge("collabboard_rooms", "Rooms in the registry", static_cast<double>(stats.rooms));
+        out.gauge("collabboard_participants", "Users joined to a room",
+                  static_cast<double>(stats.participants));
+        out.gauge("collabboard_board_bytes", "Estimated stroke memory of all rooms",
+                  static_cast<double>(stats.boardBytes));
+        out.counter("collabboard_evicted_strokes_total",
+                    "Strokes evicted to stay within a memory budget", stats.evictedStrokes);
+        return out.str();
+    }
+
+    static std::string statsToJson(const ServerStats& stats) {
+        JsonWriter w;
+        w.raw(R"({"boardBytes":)").number(static_cast<uint64_t>(stats.boardBytes))
+         .raw(R"(,"evictedStrokes":)").number(stats.evictedStrokes)
+         .raw(R"(,"largestRooms":[)");
+        for (size_t i = 0; i < stats.largestRooms.size(); ++i) {
+            const auto& room = stats.largestRooms[i];
+            if (i > 0) w.raw(',');
+            w.raw(R"({"boardBytes":)").number(static_cast<uint64_t>(room.boardBytes))
+             .raw(R"(,"participants":)").number(static_cast<uint64_t>(room.participants))
+             .raw(R"(,"roomId":)").string(room.roomId)
+             .raw(R"(,"strokes":)").number(static_cast<uint64_t>(room.strokes))
+             .raw('}');
+        }
+        w.raw(R"(],"participants":)").number(static_cast<uint64_t>(stats.participants))
+         .raw(R"(,"roomBudgetBytes":)").number(static_cast<uint64_t>(stats.roomBudgetBytes))
+         .raw(R"(,"rooms":)").number(static_cast<uint64_t>(stats.rooms))
+         .raw(R"(,"totalBudgetBytes":)").number(static_cast<uint64_t>(stats.totalBudgetBytes))
+         .raw('}');
+        return w.str();
+    }
+
+    /**
+     * @brief Owner of a room, so a load balancer or client can connect to
+     *        the right node up front. Without a cluster every room is local.
+     */
+    std::string routeToJson(const std::string& roomId) const {
+        const RoomRouter* router = roomService_.getRouter();
+        JsonWriter w;
+        w.raw(R"({"local":)").raw(!router || router->isLocal(roomId) ? "true" : "false");
+        if (router) {
+            const ClusterNode& owner = router->ownerOf(roomId);
+            w.raw(R"(,"node":)").string(owner.id)
+             .raw(R"(,"url":)").string(owner.url);
+        }
+        w.raw('}');
+        return w.str();
+    }
+
+    /**
+     * @brief Percent-decoded value of one query parameter, or "" if absent.
+     */
+    static std::string queryParam(std::string_view target, std::string_view name) {
+        size_t q = target.find('?');
+        std::string_view query = q == std::string_view::npos ? std::string_view() : target.substr(q + 1);
+        while (!query.empty()) {
+            size_t amp = query.find('&');
+            std::string_view pair = query.substr(0, amp);
+            query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+            if (pair.size() <= name.size() || !pair.starts_with(name) || pair[name.size()] != '=') {
+                continue;
+            }
+            std::string_view raw = pair.substr(name.size() + 1);
+            std::string value;
+            for (size_t i = 0; i < raw.size(); ++i) {
+                int hi = 0, lo = 0;
+                if (raw[i] == '+') {
+                    value += ' ';
+                } else if (raw[i] == '%' && i + 2 < raw.size() &&
+                           (hi = hexDigit(raw[i + 1])) >= 0 && (lo = hexDigit(raw[i + 2])) >= 0) {
+                    value += static_cast<char>(hi * 16 + lo);
+                    i += 2;
+                } else {
+                    value += raw[i];
+                }
+            }
+            return value;
+        }
+        return {};
+    }
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
     void upgradeToWebSocket(http::request<http::empty_body> const& req) {
         // Create WebSocket session with the socket (move it)
-        auto wsSession = std::make_shared<WsSession>(std::move(socket_), roomService_);
+        auto wsSession = std::make_shared<WsSession>(
+            std::move(socket_), roomService_, config_.session);
         wsSession->runWithRequest(req);
     }
 
     tcp::socket socket_;
     RoomService& roomService_;
+    const ServerConfig& config_;
     beast::flat_buffer buffer_;
     std::optional<http::request_parser<http::empty_body>> parser_;
+    std::optional<http::response<http::string_body>> response_;
 };
 
 } // namespace collabboard
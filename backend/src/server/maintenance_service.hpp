@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+#include "ws_session.hpp"
+#include "../services/room_service.hpp"
+#include "../utils/rate_limiter.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Thresholds for MaintenanceService; 0 turns a job off.
+ */
+struct MaintenanceOptions {
+    std::chrono::milliseconds heartbeatTimeout{ProtocolConstants::HeartbeatTimeoutMs};
+    std::chrono::milliseconds ghostTimeout{ProtocolConstants::GhostCursorTimeoutMs};
+    std::chrono::seconds limiterIdle{ProtocolConstants::RateLimiterIdleSeconds};
+    std::chrono::milliseconds hibernateAfter{ProtocolConstants::RoomHibernateAfterMs};
+};
+
+/**
+ * @brief What one MaintenanceService::sweep() did.
+ */
+struct MaintenanceReport {
+    size_t sessionsPinged = 0;
+    size_t sessionsExpired = 0;
+    size_t ghosts = 0;              // Participants idle past the ghost timeout
+    size_t bucketsRemoved = 0;
+    size_t roomsHibernated = 0;
+};
+
+/**
+ * @brief Periodic cleanup of state left behind by idle or vanished users.
+ *
+ * Each sweep():
+ *  - pings participants quiet for half the heartbeat timeout and drops
+ *    those quiet for all of it, so a client that vanished without a FIN
+ *    stops holding its seat, socket and queue;
+ *  - marks participants whose cursor has been still past the ghost
+ *    timeout inactive;
+ *  - removes buckets unused for limiterIdle from every watched
+ *    RateLimiter;
+ *  - hibernates rooms whose board has been idle for hibernateAfter (see
+ *    RoomService::hibernateIdleRooms()).
+ *
+ * The server runs sweep() on a PeriodicTask. Sessions are found through
+ * the rooms, so a connection that never joins is left to the WebSocket
+ * idle timeout. Thread-safe with respect to the rooms; watch() must be
+ * called before the first sweep.
+ */
+class MaintenanceService {
+public:
+    explicit MaintenanceService(RoomService& roomService,
+                                MaintenanceOptions options = MaintenanceOptions())
+        : roomService_(roomService)
+        , options_(options)
+    {}
+
+    /**
+     * @brief Sweep this limiter's idle buckets too. It must outlive the
+     * service.
+     */
+    void watch(RateLimiter& limiter) {
+        limiters_.push_back(&limiter);
+    }
+
+    const MaintenanceOptions& getOptions() const { return options_; }
+
+    MaintenanceReport sweep() {
+        MaintenanceReport report;
+        auto now = std::chrono::steady_clock::now();
+        PresenceService& presence = roomService_.getPresenceService();
+
+        for (const auto& room : roomService_.getRooms()) {
+            if (options_.heartbeatTimeout.count() > 0) {
+                for (const auto& session : room->getSessions()) {
+                    auto idle = session->idleFor(now);
+                    if (idle >= options_.heartbeatTimeout) {
+                        session->expire();
+                        ++report.sessionsExpired;
+                    } else if (idle >= options_.heartbeatTimeout / 2) {
+                        session->ping();
+                        ++report.sessionsPinged;
+                    }
+                }
+            }
+            if (options_.ghostTimeout.count() > 0) {
+                presence.markGhostsInactive(*room, options_.ghostTimeout.count());
+                report.ghosts += presence.getGhostUsers(*room, options_.ghostTimeout.count()).size();
+            }
+        }
+
+        if (options_.limiterIdle.count() > 0) {
+            for (RateLimiter* limiter : limiters_) {
+                report.bucketsRemoved += limiter->cleanup(static_cast<int>(options_.limiterIdle.count()));
+            }
+        }
+
+        if (options_.hibernateAfter.count() > 0) {
+            report.roomsHibernated = roomService_.hibernateIdleRooms(options_.hibernateAfter);
+        }
+        return report;
+    }
+
+private:
+    RoomService& roomService_;
+    MaintenanceOptions options_;
+    std::vector<RateLimiter*> limiters_;
+};
+
+} // namespace collabboard
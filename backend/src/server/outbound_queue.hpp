@@ -0,0 +1,264 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "../protocol/outbound_frame.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Counters describing one session's outbound traffic.
+ *
+ * Written only by the owning session's strand; the fields are atomics so
+ * monitoring code on other threads can read them without a lock.
+ */
+struct OutboundStats {
+    std::atomic<uint64_t> queuedFrames{0};      // Frames waiting to be written
+    std::atomic<uint64_t> queuedBytes{0};       // Payload bytes waiting to be written
+    std::atomic<uint64_t> peakQueuedBytes{0};   // High-water mark of queuedBytes
+    std::atomic<uint64_t> framesSent{0};        // Frames handed to the socket
+    std::atomic<uint64_t> writesIssued{0};      // Socket writes (one per batch)
+    std::atomic<uint64_t> framesDropped{0};     // Loss-tolerant frames discarded
+    std::atomic<uint64_t> framesConflated{0};   // Frames replaced by a newer one
+};
+
+/**
+ * @brief Pending outgoing frames for one session.
+ *
+ * Frames queue up while a write is in flight and are drained in batches
+ * once it completes, so a burst of small frames costs one socket write
+ * instead of one write (and one strand round-trip) per frame.
+ *
+ * Policy by delivery class:
+ * - Reliable frames (strokes, control) are always queued, in order.
+ * - A loss-tolerant frame replaces a queued frame with the same conflation
+ *   key in place, so only the latest cursor per remote user waits.
+ * - Past the soft limit, new loss-tolerant frames are dropped.
+ * - Past the hard limit, push() reports Overflow and the session should
+ *   disconnect the client.
+ * - Bulk frames (snapshot chunks) wait in a separate lane that is drained
+ *   only when no other frame is queued, so live traffic overtakes a large
+ *   snapshot instead of waiting behind it. Bulk frames are always accepted
+ *   and do not count towards the soft or hard limit; the server bounds
+ *   their total size.
+ *
+ * Not thread-safe: owned and used only on the session's strand.
+ */
+class OutboundQueue {
+public:
+    enum class PushResult {
+        Queued,      // Appended to the queue
+        Conflated,   // Replaced an older frame with the same key
+        Dropped,     // Discarded under backpressure
+        Overflow     // Hard limit exceeded; frame not queued
+    };
+
+    /**
+     * @param maxBatchBytes Cap on payload bytes drained into one batch
+     * @param softLimitBytes Queue size past which loss-tolerant frames are dropped
+     * @param hardLimitBytes Queue size past which the client is disconnected
+     */
+    explicit OutboundQueue(size_t maxBatchBytes = ProtocolConstants::MaxBatchBytes,
+                           size_t softLimitBytes = ProtocolConstants::OutboundSoftLimitBytes,
+                           size_t hardLimitBytes = ProtocolConstants::OutboundHardLimitBytes)
+        : maxBatchBytes_(maxBatchBytes)
+        , softLimitBytes_(softLimitBytes)
+        , hardLimitBytes_(hardLimitBytes)
+        , queuedBytes_(0)
+        , headIndex_(0)
+    {}
+
+    /**
+     * @brief Queue a frame according to its delivery class.
+     */
+    PushResult push(OutboundFrame frame) {
+        if (frame.deliveryClass() == DeliveryClass::Bulk) {
+            bulkBytes_ += frame.size();
+            bulk_.push_back(std::move(frame));
+            publishDepth();
+            return PushResult::Queued;
+        }
+
+        bool lossTolerant = frame.deliveryClass() == DeliveryClass::LossTolerant;
+
+        if (lossTolerant && !frame.conflationKey().empty()) {
+            auto it = conflatable_.find(frame.conflationKey());
+            if (it != conflatable_.end()) {
+                replaceAt(it->second - headIndex_, std::move(frame), it);
+                bump(stats_.framesConflated);
+                return PushResult::Conflated;
+            }
+        }
+
+        if (lossTolerant && queuedBytes_ >= softLimitBytes_) {
+            bump(stats_.framesDropped);
+            return PushResult::Dropped;
+        }
+
+        // A frame arriving at an empty queue is always accepted so that a
+        // single large message (e.g. a snapshot) cannot trip the limit.
+        if (!frames_.empty() && queuedBytes_ + frame.size() > hardLimitBytes_) {
+            return PushResult::Overflow;
+        }
+
+        if (lossTolerant && !frame.conflationKey().empty()) {
+            uint64_t index = headIndex_ + frames_.size();
+            frames_.push_back(std::move(frame));
+            conflatable_.emplace(frames_.back().conflationKey(), index);
+        } else {
+            frames_.push_back(std::move(frame));
+        }
+
+        queuedBytes_ += frames_.back().size();
+        publishDepth();
+        return PushResult::Queued;
+    }
+
+    /**
+     * @brief Move the next batch of frames into out (replacing its contents).
+     *
+     * Frames are taken in order until the next one would push the batch past
+     * the byte cap or uses a different wire encoding (text vs binary). At
+     * least one frame is always taken, so a frame larger than the cap still
+     * goes out on its own. Bulk frames are taken only once the other frames
+     * have all been sent.
+     *
+     * @return Number of frames moved
+     */
+    size_t drainBatch(std::vector<OutboundFrame>& out) {
+        out.clear();
+        if (frames_.empty()) {
+            return drainBulk(out);
+        }
+        size_t batchBytes = 0;
+
+        while (!frames_.empty()) {
+            size_t next = frames_.front().size();
+            if (!out.empty() && (batchBytes + next > maxBatchBytes_ ||
+                                 frames_.front().isBinary() != out.front().isBinary())) {
+                break;
+            }
+            batchBytes += next;
+            queuedBytes_ -= next;
+
+            auto key = frames_.front().conflationKey();
+            if (!key.empty()) {
+                auto it = conflatable_.find(key);
+                if (it != conflatable_.end() && it->second == headIndex_) {
+                    conflatable_.erase(it);
+                }
+            }
+
+            out.push_back(std::move(frames_.front()));
+            frames_.pop_front();
+            ++headIndex_;
+        }
+
+        if (!out.empty()) {
+            bump(stats_.framesSent, out.size());
+            bump(stats_.writesIssued);
+        }
+        publishDepth();
+        return out.size();
+    }
+
+    /**
+     * @brief Drop all queued frames.
+     */
+    void clear() {
+        headIndex_ += frames_.size();
+        frames_.clear();
+        conflatable_.clear();
+        queuedBytes_ = 0;
+        bulk_.clear();
+        bulkBytes_ = 0;
+        publishDepth();
+    }
+
+    bool empty() const { return frames_.empty() && bulk_.empty(); }
+    size_t size() const { return frames_.size() + bulk_.size(); }
+    size_t bytes() const { return queuedBytes_ + bulkBytes_; }
+    size_t bulkBytes() const { return bulkBytes_; }
+    size_t getMaxBatchBytes() const { return maxBatchBytes_; }
+    const OutboundStats& stats() const { return stats_; }
+
+private:
+    using KeyIndex = std::unordered_map<std::string_view, uint64_t>;
+
+    /**
+     * @brief drainBatch() for the bulk lane (same byte cap and encoding rule).
+     */
+    size_t drainBulk(std::vector<OutboundFrame>& out) {
+        size_t batchBytes = 0;
+        while (!bulk_.empty()) {
+            size_t next = bulk_.front().size();
+            if (!out.empty() && (batchBytes + next > maxBatchBytes_ ||
+                                 bulk_.front().isBinary() != out.front().isBinary())) {
+                break;
+            }
+            batchBytes += next;
+            bulkBytes_ -= next;
+            out.push_back(std::move(bulk_.front()));
+            bulk_.pop_front();
+        }
+
+        if (!out.empty()) {
+            bump(stats_.framesSent, out.size());
+            bump(stats_.writesIssued);
+        }
+        publishDepth();
+        return out.size();
+    }
+
+    /**
+     * @brief Replace the frame at a queue position, keeping its place in line.
+     */
+    void replaceAt(size_t position, OutboundFrame frame, KeyIndex::iterator keyIt) {
+        auto& slot = frames_[position];
+        queuedBytes_ = queuedBytes_ - slot.size() + frame.size();
+        uint64_t index = keyIt->second;
+
+        // The map key views the old frame's bytes; re-key before releasing it
+        conflatable_.erase(keyIt);
+        slot = std::move(frame);
+        conflatable_.emplace(slot.conflationKey(), index);
+        publishDepth();
+    }
+
+    /**
+     * @brief Increment a single-writer counter without a locked instruction.
+     */
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + by,
+                      std::memory_order_relaxed);
+    }
+
+    void publishDepth() {
+        size_t total = bytes();
+        stats_.queuedFrames.store(size(), std::memory_order_relaxed);
+        stats_.queuedBytes.store(total, std::memory_order_relaxed);
+        if (total > stats_.peakQueuedBytes.load(std::memory_order_relaxed)) {
+            stats_.peakQueuedBytes.store(total, std::memory_order_relaxed);
+        }
+    }
+
+    size_t maxBatchBytes_;
+    size_t softLimitBytes_;
+    size_t hardLimitBytes_;
+    size_t queuedBytes_;
+    uint64_t headIndex_;                 // Absolute index of frames_.front()
+    std::deque<OutboundFrame> frames_;
+    KeyIndex conflatable_;               // Conflation key -> absolute index
+    std::deque<OutboundFrame> bulk_;     // Bulk lane, drained when frames_ is empty
+    size_t bulkBytes_ = 0;
+    OutboundStats stats_;
+};
+
+} // namespace collabboard
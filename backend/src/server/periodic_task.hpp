@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <chrono>
+#include <functional>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/io_context.hpp>
+
+namespace collabboard {
+
+namespace net = boost::asio;
+
+/**
+ * @brief Runs a callback at a fixed interval on the io_context.
+ *
+ * The callback runs on the task's own strand, so ticks never overlap even
+ * when the io_context is served by several threads. Deadlines advance from
+ * the previous deadline rather than from the callback's finish time, so the
+ * tick rate does not drift under load; a late tick is not replayed.
+ */
+class PeriodicTask : public std::enable_shared_from_this<PeriodicTask> {
+public:
+    using Callback = std::function<void()>;
+
+    PeriodicTask(net::io_context& ioc, std::chrono::milliseconds interval, Callback callback)
+        : strand_(net::make_strand(ioc))
+        , timer_(strand_)
+        , interval_(interval)
+        , callback_(std::move(callback))
+        , running_(false)
+    {}
+
+    /**
+     * @brief Start ticking. The first tick fires one interval from now.
+     */
+    void start() {
+        net::post(strand_, [self = shared_from_this()]() {
+            if (self->running_) {
+                return;
+            }
+            self->running_ = true;
+            self->timer_.expires_after(self->interval_);
+            self->schedule();
+        });
+    }
+
+    /**
+     * @brief Stop ticking. A tick already queued is cancelled.
+     */
+    void stop() {
+        net::post(strand_, [self = shared_from_this()]() {
+            self->running_ = false;
+            self->timer_.cancel();
+        });
+    }
+
+    std::chrono::milliseconds getInterval() const { return interval_; }
+
+private:
+    void schedule() {
+        timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+            if (ec || !self->running_) {
+                return;
+            }
+
+            self->callback_();
+
+            // Skip missed deadlines instead of firing a burst to catch up
+            auto next = self->timer_.expiry() + self->interval_;
+            auto now = std::chrono::steady_clock::now();
+            self->timer_.expires_at(next > now ? next : now + self->interval_);
+            self->schedule();
+        });
+    }
+
+    net::strand<net::io_context::executor_type> strand_;
+    net::steady_timer timer_;
+    std::chrono::milliseconds interval_;
+    Callback callback_;
+    bool running_;
+};
+
+} // namespace collabboard
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "../models/room.hpp"
+
+namespace collabboard {
+
+namespace net = boost::asio;
+
+/**
+ * @brief Executor factory that gives each room its own strand.
+ *
+ * All of a room's message handling and presence ticks are serialized on
+ * its strand, while different rooms run in parallel across the
+ * io_context's threads. Sessions keep their own strands for socket I/O;
+ * the room strand only hands them finished frames via WsSession::send.
+ */
+inline std::function<Room::Executor()> makeStrandExecutorFactory(net::io_context& ioc) {
+    return [&ioc]() -> Room::Executor {
+        auto strand = std::make_shared<net::strand<net::io_context::executor_type>>(
+            net::make_strand(ioc));
+        return [strand](Room::Task task) {
+            net::post(*strand, std::move(task));
+        };
+    };
+}
+
+} // namespace collabboard
@@ -0,0 +1,416 @@
+#pragma once
+
+/**
+ * @file server_config.hpp
+ * @brief Runtime settings: loaded once at startup from a config file and
+ *        the environment, applied to the server, and reported at /metrics.
+ */
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ws_session.hpp"
+#include "maintenance_service.hpp"
+#include "../models/board_memory.hpp"
+#include "../models/room.hpp"
+#include "../models/stroke_compaction.hpp"
+#include "../utils/metrics.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief Options for listening and accepted sockets.
+ */
+struct SocketOptions {
+    bool reusePort = false;   // SO_REUSEPORT, so several acceptors can share the port
+    int acceptors = 1;        // Listening sockets; the kernel spreads connections over them
+    bool noDelay = true;      // TCP_NODELAY: cursor frames go out without Nagle delay
+    int sendBufferBytes = 0;  // SO_SNDBUF; 0 keeps the OS default
+    int recvBufferBytes = 0;  // SO_RCVBUF; 0 keeps the OS default
+};
+
+/**
+ * @brief Key/value settings, by their environment variable name.
+ */
+using Settings = std::map<std::string, std::string, std::less<>>;
+
+// =============================================================================
+// CPU Detection
+// =============================================================================
+
+/**
+ * @brief CPUs allowed by a cgroup v2 cpu.max line ("quota period" or
+ *        "max period"), rounded up. nullopt when unlimited or unreadable.
+ */
+inline std::optional<unsigned> parseCgroupCpuMax(std::string_view line) {
+    std::istringstream in{std::string(line)};
+    std::string quota;
+    long long period = 0;
+    if (!(in >> quota >> period) || quota == "max" || period <= 0) {
+        return std::nullopt;
+    }
+    long long limit = std::atoll(quota.c_str());
+    if (limit <= 0) return std::nullopt;
+    return static_cast<unsigned>((limit + period - 1) / period);
+}
+
+/**
+ * @brief CPUs this process may actually use.
+ *
+ * hardware_concurrency() counts the host's cores. Inside a container the
+ * CPU affinity mask and the cgroup quota (v2 cpu.max, or v1
+ * cfs_quota_us / cfs_period_us) can be far lower; sizing the thread pool
+ * to the host oversubscribes the quota and gets the process throttled.
+ */
+inline unsigned detectCpuLimit(const std::string& cgroupRoot = "/sys/fs/cgroup") {
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) {
+        cpus = std::min(cpus, static_cast<unsigned>(CPU_COUNT(&set)));
+    }
+#endif
+
+    std::optional<unsigned> quota;
+    if (std::ifstream v2(cgroupRoot + "/cpu.max"); v2) {
+        std::string line;
+        std::getline(v2, line);
+        quota = parseCgroupCpuMax(line);
+    } else {
+        std::ifstream quotaFile(cgroupRoot + "/cpu/cpu.cfs_quota_us");
+        std::ifstream periodFile(cgroupRoot + "/cpu/cpu.cfs_period_us");
+        std::string quotaUs, periodUs;
+        if (quotaFile >> quotaUs && periodFile >> periodUs) {
+            quota = parseCgroupCpuMax(quotaUs + " " + periodUs);
+        }
+    }
+    if (quota) {
+        cpus = std::min(cpus, *quota);
+    }
+    return std::max(1u, cpus);
+}
+
+/**
+ * @brief Pin the calling thread to the index-th CPU it is allowed on
+ *        (wrapping). Returns false where unsupported or on failure.
+ */
+inline bool pinCurrentThread(size_t index) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return false;
+    }
+    size_t target = index % static_cast<size_t>(CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (target-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            return pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0;
+        }
+    }
+#else
+    (void)index;
+#endif
+    return false;
+}
+
+// =============================================================================
+// Server Config
+// =============================================================================
+
+/**
+ * @brief Every setting the server reads at startup.
+ *
+ * Defaults are the ProtocolConstants values. load() applies a Settings
+ * map whose keys are the environment variable names documented in
+ * main.cpp; settingsFromFile() and settingsFromEnvironment() produce one,
+ * and the environment wins over the file. A value that does not parse
+ * keeps the default and adds a warning.
+ */
+struct ServerConfig {
+    unsigned short port = 8080;
+    int ioThreads = 1;              // Resolved: IO_THREADS, else detectCpuLimit()
+    bool pinThreads = false;        // One io thread per allowed CPU
+    int cursorTickMs = ProtocolConstants::CursorTickIntervalMs;
+    double cursorRateHz = ProtocolConstants::CursorUpdatesPerSecond;
+    double cursorBurst = ProtocolConstants::RateLimitBurstSize;
+    size_t snapshotStrokes = ProtocolConstants::SnapshotStrokeLimit;
+    int snapshotThreads = ProtocolConstants::SnapshotWorkerThreads;
+    RoomLimits roomLimits;
+    MemoryBudget memoryBudget;
+    StrokeCompaction compaction;
+    SocketOptions socket;
+    SessionOptions session;
+    MaintenanceOptions maintenance;
+    std::string dataDir;            // Empty keeps boards in memory only
+    std::string clusterNodes;       // Empty runs a single node
+    std::string nodeId;
+
+    /**
+     * @brief Names load() reads, for settingsFromEnvironment().
+     */
+    static const std::vector<std::string_view>& keys() {
+        static const std::vector<std::string_view> names = {
+            "PORT", "IO_THREADS", "IO_PIN_THREADS", "REUSE_PORT", "ACCEPTORS",
+            "TCP_NODELAY", "SOCKET_SNDBUF", "SOCKET_RCVBUF",
+            "WS_READ_MAX_BYTES", "WS_WRITE_BUFFER_BYTES", "WS_DEFLATE",
+            "CURSOR_TICK_MS", "CURSOR_RATE_HZ", "CURSOR_BURST", "SNAPSHOT_STROKES",
+            "SNAPSHOT_THREADS", "ROOM_MAX_USERS", "ROOM_MAX_STROKES", "ROOM_MEMORY_MB", "BOARD_MEMORY_MB",
+            "STROKE_TOLERANCE", "HEARTBEAT_TIMEOUT_MS", "ROOM_HIBERNATE_MS", "DATA_DIR", "CLUSTER_NODES", "NODE_ID",
+        };
+        return names;
+    }
+
+    /**
+     * @brief Build a config from settings; warnings collects bad values.
+     * @param cpus CPUs to size the io pool by when IO_THREADS is unset
+     */
+    static ServerConfig load(const Settings& settings, std::vector<std::string>& warnings,
+                             unsigned cpus = detectCpuLimit()) {
+        ServerConfig config;
+        config.ioThreads = static_cast<int>(std::max(1u, cpus));
+        Reader read{settings, warnings};
+
+        int port = config.port;
+        read.integer("PORT", port, 1, 65535);
+        config.port = static_cast<unsigned short>(port);
+
+        read.integer("IO_THREADS", config.ioThreads, 1, 1024);
+        read.flag("IO_PIN_THREADS", config.pinThreads);
+
+        // One acceptor per io thread by default once the port can be shared
+        read.flag("REUSE_PORT", config.socket.reusePort);
+        config.socket.acceptors = config.socket.reusePort ? config.ioThreads : 1;
+        read.integer("ACCEPTORS", config.socket.acceptors, 1, 1024);
+        if (config.socket.acceptors > 1 && !config.socket.reusePort) {
+            warnings.push_back("ACCEPTORS > 1 needs REUSE_PORT=1, using 1");
+            config.socket.acceptors = 1;
+        }
+        read.flag("TCP_NODELAY", config.socket.noDelay);
+        read.integer("SOCKET_SNDBUF", config.socket.sendBufferBytes, 0, 1 << 30);
+        read.integer("SOCKET_RCVBUF", config.socket.recvBufferBytes, 0, 1 << 30);
+
+        read.size("WS_READ_MAX_BYTES", config.session.readMessageMax, 1024);
+        read.size("WS_WRITE_BUFFER_BYTES", config.session.writeBufferBytes, 0);
+
+        // WS_DEFLATE: 0 disables, 1-9 is the zlib level
+        int deflateLevel = config.session.deflate.enabled ? config.session.deflate.level : 0;
+        if (read.integer("WS_DEFLATE", deflateLevel, 0, 9)) {
+            config.session.deflate.enabled = deflateLevel > 0;
+            config.session.deflate.level = std::max(deflateLevel, 1);
+        }
+
+        read.integer("CURSOR_TICK_MS", config.cursorTickMs, 0, 60'000);
+        read.real("CURSOR_RATE_HZ", config.cursorRateHz, 0.1);
+        read.real("CURSOR_BURST", config.cursorBurst, 1.0);
+        read.size("SNAPSHOT_STROKES", config.snapshotStrokes, 1);
+        read.integer("SNAPSHOT_THREADS", config.snapshotThreads, 0, 64);
+        read.size("ROOM_MAX_USERS", config.roomLimits.maxUsers, 1);
+        read.size("ROOM_MAX_STROKES", config.roomLimits.maxStrokes, 1);
+        read.megabytes("ROOM_MEMORY_MB", config.memoryBudget.roomBytes);
+        read.megabytes("BOARD_MEMORY_MB", config.memoryBudget.totalBytes);
+
+        int heartbeatMs = static_cast<int>(config.maintenance.heartbeatTimeout.count());
+        if (read.integer("HEARTBEAT_TIMEOUT_MS", heartbeatMs, 0, 3'600'000)) {
+            config.maintenance.heartbeatTimeout = std::chrono::milliseconds(heartbeatMs);
+        }
+        int hibernateMs = static_cast<int>(config.maintenance.hibernateAfter.count());
+        if (read.integer("ROOM_HIBERNATE_MS", hibernateMs, 0, 86'400'000)) {
+            config.maintenance.hibernateAfter = std::chrono::milliseconds(hibernateMs);
+        }
+
+        double tolerance = config.compaction.tolerance;
+        if (read.real("STROKE_TOLERANCE", tolerance, 0.0)) {
+            config.compaction.tolerance = static_cast<float>(tolerance);
+            if (tolerance == 0.0) {
+                config.compaction = StrokeCompaction::none();
+            }
+        }
+
+        read.text("DATA_DIR", config.dataDir);
+        read.text("CLUSTER_NODES", config.clusterNodes);
+        read.text("NODE_ID", config.nodeId);
+        return config;
+    }
+
+    /**
+     * @brief Settings from a file of KEY=VALUE lines ('#' starts a comment).
+     * @return nullopt if the file cannot be opened
+     */
+    static std::optional<Settings> settingsFromFile(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return std::nullopt;
+
+        Settings settings;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string_view entry = trim(std::string_view(line).substr(0, line.find('#')));
+            size_t eq = entry.find('=');
+            if (eq == std::string_view::npos) continue;
+            std::string_view key = trim(entry.substr(0, eq));
+            if (key.empty()) continue;
+            settings[std::string(key)] = std::string(trim(entry.substr(eq + 1)));
+        }
+        return settings;
+    }
+
+    /**
+     * @brief Add every set environment variable in keys() to settings,
+     *        replacing what a file gave.
+     */
+    static void settingsFromEnvironment(Settings& settings) {
+        for (std::string_view key : keys()) {
+            std::string name(key);
+            if (const char* value = std::getenv(name.c_str())) {
+                settings[name] = value;
+            }
+        }
+    }
+
+    /**
+     * @brief Report the effective settings as one labelled gauge family.
+     */
+    void write(PrometheusWriter& out) const {
+        auto setting = [&out](std::string_view name, double value) {
+            std::string labels = "setting=\"";
+            labels.append(name).append("\"");
+            out.gauge("collabboard_config", "Runtime setting loaded at startup", value, labels);
+        };
+        setting("io_threads", ioThreads);
+        setting("io_pin_threads", pinThreads);
+        setting("reuse_port", socket.reusePort);
+        setting("acceptors", socket.acceptors);
+        setting("tcp_nodelay", socket.noDelay);
+        setting("socket_sndbuf_bytes", socket.sendBufferBytes);
+        setting("socket_rcvbuf_bytes", socket.recvBufferBytes);
+        setting("ws_read_max_bytes", static_cast<double>(session.readMessageMax));
+        setting("ws_write_buffer_bytes", static_cast<double>(session.writeBufferBytes));
+        setting("ws_deflate_level", session.deflate.enabled ? session.deflate.level : 0);
+        setting("cursor_tick_ms", cursorTickMs);
+        setting("cursor_rate_hz", cursorRateHz);
+        setting("cursor_burst", cursorBurst);
+        setting("snapshot_strokes", static_cast<double>(snapshotStrokes));
+        setting("snapshot_threads", snapshotThreads);
+        setting("room_max_users", static_cast<double>(roomLimits.maxUsers));
+        setting("room_max_strokes", static_cast<double>(roomLimits.maxStrokes));
+        setting("room_memory_bytes", static_cast<double>(memoryBudget.roomBytes));
+        setting("board_memory_bytes", static_cast<double>(memoryBudget.totalBytes));
+        setting("stroke_tolerance_px", compaction.tolerance);
+        setting("heartbeat_timeout_ms", static_cast<double>(maintenance.heartbeatTimeout.count()));
+        setting("room_hibernate_ms", static_cast<double>(maintenance.hibernateAfter.count()));
+    }
+
+private:
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    /**
+     * @brief Typed lookups that leave the target alone on a bad value.
+     * Each returns true if the key was set and parsed.
+     */
+    struct Reader {
+        const Settings& settings;
+        std::vector<std::string>& warnings;
+
+        const std::string* find(std::string_view key) const {
+            auto it = settings.find(key);
+            return it == settings.end() ? nullptr : &it->second;
+        }
+
+        template <typename T>
+        void invalid(std::string_view key, const std::string& value, const T& kept) {
+            std::ostringstream msg;
+            msg << "Invalid " << key << ": " << value << ", using " << kept;
+            warnings.push_back(msg.str());
+        }
+
+        bool integer(std::string_view key, int& out, int min, int max) {
+            const std::string* value = find(key);
+            if (!value) return false;
+            try {
+                size_t used = 0;
+                long parsed = std::stol(*value, &used);
+                if (used == value->size() && parsed >= min && parsed <= max) {
+                    out = static_cast<int>(parsed);
+                    return true;
+                }
+            } catch (...) {}
+            invalid(key, *value, out);
+            return false;
+        }
+
+        bool size(std::string_view key, size_t& out, size_t min) {
+            const std::string* value = find(key);
+            if (!value) return false;
+            try {
+                size_t used = 0;
+                unsigned long long parsed = std::stoull(*value, &used);
+                if (used == value->size() && value->front() != '-' && parsed >= min) {
+                    out = static_cast<size_t>(parsed);
+                    return true;
+                }
+            } catch (...) {}
+            invalid(key, *value, out);
+            return false;
+        }
+
+        bool megabytes(std::string_view key, size_t& bytes) {
+            size_t mb = bytes >> 20;
+            if (!size(key, mb, 0)) return false;
+            bytes = mb << 20;
+            return true;
+        }
+
+        bool real(std::string_view key, double& out, double min) {
+            const std::string* value = find(key);
+            if (!value) return false;
+            try {
+                size_t used = 0;
+                double parsed = std::stod(*value, &used);
+                if (used == value->size() && parsed >= min) {
+                    out = parsed;
+                    return true;
+                }
+            } catch (...) {}
+            invalid(key, *value, out);
+            return false;
+        }
+
+        bool flag(std::string_view key, bool& out) {
+            const std::string* value = find(key);
+            if (!value) return false;
+            if (*value == "1" || *value == "true" || *value == "on") { out = true; return true; }
+            if (*value == "0" || *value == "false" || *value == "off") { out = false; return true; }
+            invalid(key, *value, out ? "1" : "0");
+            return false;
+        }
+
+        void text(std::string_view key, std::string& out) {
+            if (const std::string* value = find(key)) out = *value;
+        }
+    };
+};
+
+} // namespace collabboard
@@ -9,6 +9,7 @@
 #include <boost/asio/strand.hpp>
 
 #include "http_connection.hpp"
+#include "server_config.hpp"
 #include "../services/room_service.hpp"
 
 namespace collabboard {
@@ -19,13 +20,21 @@ using tcp = boost::asio::ip::tcp;
 
 /**
  * @brief TCP acceptor that listens for incoming connections and spawns WebSocket sessions.
+ *
+ * With config.socket.reusePort set, several WsServers can bind the same
+ * port; the kernel then load-balances new connections across their
+ * listen queues instead of waking every thread on one.
  */
 class WsServer : public std::enable_shared_from_this<WsServer> {
 public:
-    WsServer(net::io_context& ioc, tcp::endpoint endpoint, RoomService& roomService)
+    using ReusePort = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+    WsServer(net::io_context& ioc, tcp::endpoint endpoint, RoomService& roomService,
+             const ServerConfig& config)
         : ioc_(ioc)
         , acceptor_(net::make_strand(ioc))
         , roomService_(roomService)
+        , config_(config)
     {
         beast::error_code ec;
 
@@ -42,6 +51,13 @@ public:
             fail(ec, "set_option");
             return;
         }
+        if (config_.socket.reusePort) {
+            acceptor_.set_option(ReusePort(true), ec);
+            if (ec) {
+                fail(ec, "set_option SO_REUSEPORT");
+                return;
+            }
+        }
 
         // Bind to the server address
         acceptor_.bind(endpoint, ec);
@@ -94,14 +110,37 @@ private:
         if (ec) {
             fail(ec, "accept");
         } else {
+            configureSocket(socket);
             // HttpConnection reads request first, routes /health or WebSocket upgrade
-            std::make_shared<HttpConnection>(std::move(socket), roomService_)->run();
+            std::make_shared<HttpConnection>(
+                std::move(socket), roomService_, config_)->run();
         }
 
         // Accept another connection
         doAccept();
     }
 
+    /**
+     * @brief Apply the per-connection socket options. Failures are logged
+     *        and the connection is served with OS defaults.
+     */
+    void configureSocket(tcp::socket& socket) {
+        const SocketOptions& options = config_.socket;
+        beast::error_code ec;
+        if (options.noDelay) {
+            socket.set_option(tcp::no_delay(true), ec);
+            if (ec) fail(ec, "set_option TCP_NODELAY");
+        }
+        if (options.sendBufferBytes > 0) {
+            socket.set_option(net::socket_base::send_buffer_size(options.sendBufferBytes), ec);
+            if (ec) fail(ec, "set_option SO_SNDBUF");
+        }
+        if (options.recvBufferBytes > 0) {
+            socket.set_option(net::socket_base::receive_buffer_size(options.recvBufferBytes), ec);
+            if (ec) fail(ec, "set_option SO_RCVBUF");
+        }
+    }
+
     /**
      * @brief Handle an error.
      */
@@ -112,6 +151,7 @@ private:
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     RoomService& roomService_;
+    const ServerConfig& config_;
 };
 
 } // namespace collabboard
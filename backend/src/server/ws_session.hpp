@@ -2,9 +2,13 @@
 
 #include <memory>
 #include <string>
-#include <queue>
+#include <string_view>
+#include <vector>
 #include <mutex>
+#include <atomic>
 #include <chrono>
+#include <iostream>
+#include <algorithm>
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -13,7 +17,11 @@
 
 #include "../protocol/message_handler.hpp"
 #include "../protocol/message_codec.hpp"
+#include "../protocol/outbound_frame.hpp"
 #include "../services/room_service.hpp"
+#include "../utils/metrics.hpp"
+#include "outbound_queue.hpp"
+#include "deflate_policy.hpp"
 
 namespace collabboard {
 
@@ -22,6 +30,19 @@ namespace websocket = beast::websocket;
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
 
+/**
+ * @brief Per-connection tuning shared by all sessions of a server.
+ */
+struct SessionOptions {
+    size_t maxBatchBytes = ProtocolConstants::MaxBatchBytes;  // Cap on one coalesced write
+    size_t outboundSoftLimitBytes = ProtocolConstants::OutboundSoftLimitBytes;
+    size_t outboundHardLimitBytes = ProtocolConstants::OutboundHardLimitBytes;
+    size_t readMessageMax = ProtocolConstants::MaxMessageSize;  // Larger messages fail the read
+    size_t writeBufferBytes = 0;  // Beast's frame write buffer; 0 keeps its default (4 KB)
+    IngressPolicy ingress;    // Per-session message, point and byte budgets
+    DeflatePolicy deflate;    // permessage-deflate offer (off by default)
+};
+
 /**
  * @brief Manages a single WebSocket connection.
  * 
@@ -30,22 +51,33 @@ using tcp = boost::asio::ip::tcp;
  */
 class WsSession : public std::enable_shared_from_this<WsSession> {
 public:
-    WsSession(tcp::socket&& socket, RoomService& roomService)
+    WsSession(tcp::socket&& socket, RoomService& roomService,
+              const SessionOptions& options = SessionOptions())
         : ws_(std::move(socket))
         , roomService_(roomService)
-        , messageHandler_(roomService)
+        , messageHandler_(roomService, options.ingress)
+        , deflate_(options.deflate)
+        , readMessageMax_(options.readMessageMax)
+        , writeBufferBytes_(options.writeBufferBytes)
         , strand_(net::make_strand(ws_.get_executor()))
+        , writeQueue_(options.maxBatchBytes,
+                      options.outboundSoftLimitBytes,
+                      options.outboundHardLimitBytes)
+        , binaryFrames_(false)
         , isWriting_(false)
         , isClosed_(false)
         , lastPing_(std::chrono::steady_clock::now())
-    {}
+    {
+        ServerMetrics::global().sessions.add(1);
+    }
 
     ~WsSession() {
+        ServerMetrics::global().sessions.add(-1);
         // Ensure cleanup on destruction
         if (!roomId_.empty() && !oderId_.empty()) {
             try {
                 roomService_.leaveRoom(roomId_, oderId_, 
-                    [](std::shared_ptr<WsSession>, const std::string&) {});
+                    [](std::shared_ptr<WsSession>, const OutboundFrame&) {});
             } catch (...) {}
         }
     }
@@ -54,15 +86,7 @@ public:
      * @brief Start the session (accept WebSocket handshake, then read).
      */
     void run() {
-        // Set suggested timeout settings for the websocket
-        ws_.set_option(websocket::stream_base::timeout::suggested(
-            beast::role_type::server));
-
-        // Set a decorator to change the Server field of the handshake
-        ws_.set_option(websocket::stream_base::decorator(
-            [](websocket::response_type& res) {
-                res.set(boost::beast::http::field::server, "CollabBoard/1.0");
-            }));
+        configureStream();
 
         // Accept the WebSocket handshake
         ws_.async_accept(
@@ -75,26 +99,35 @@ public:
      */
     template <class Body>
     void runWithRequest(beast::http::request<Body> const& req) {
-        ws_.set_option(websocket::stream_base::timeout::suggested(
-            beast::role_type::server));
-        ws_.set_option(websocket::stream_base::decorator(
-            [](websocket::response_type& res) {
-                res.set(beast::http::field::server, "CollabBoard/1.0");
-            }));
+        configureStream();
         ws_.async_accept(req,
             beast::bind_front_handler(&WsSession::onAccept, shared_from_this()));
     }
 
     /**
-     * @brief Send a message to this session.
+     * @brief Send a frame to this session.
+     * The frame's payload is shared, not copied, so one broadcast costs a
+     * single serialization regardless of the number of recipients.
      */
-    void send(const std::string& message) {
+    void send(OutboundFrame frame) {
         // Post to strand to ensure thread safety
-        net::post(strand_, [self = shared_from_this(), message]() {
-            self->doSend(message);
+        net::post(strand_, [self = shared_from_this(), frame = std::move(frame)]() mutable {
+            self->doSend(std::move(frame));
         });
     }
 
+    /**
+     * @brief Send function that queues frames on the target session.
+     * Used by message routing and by server-driven broadcasts (presence tick).
+     */
+    static FrameSendFunc sessionSendFunc() {
+        return [](std::shared_ptr<WsSession> session, const OutboundFrame& frame) {
+            if (session) {
+                session->send(frame);
+            }
+        };
+    }
+
     /**
      * @brief Close the session.
      */
@@ -104,19 +137,83 @@ public:
         });
     }
 
+    /**
+     * @brief Time since the client was last heard from: any message, or a
+     * pong to ping(). Safe to call from any thread.
+     */
+    std::chrono::steady_clock::duration idleFor(
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const {
+        return now - lastPing_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Send a WebSocket ping; the pong counts as activity. Browsers
+     * answer pings themselves, so a backgrounded tab whose own heartbeat
+     * timer is throttled still shows up as alive. At most one is in flight.
+     */
+    void ping() {
+        net::post(strand_, [self = shared_from_this()]() {
+            if (self->isClosed_ || self->pinging_.exchange(true)) return;
+            self->ws_.async_ping({}, [self](beast::error_code) {
+                self->pinging_ = false;
+            });
+        });
+    }
+
+    /**
+     * @brief Drop a session that missed its heartbeat, leaving its room.
+     */
+    void expire() {
+        net::post(strand_, [self = shared_from_this()]() {
+            if (self->isClosed_) return;
+            ServerMetrics::global().heartbeatTimeouts.add();
+            self->abort();
+        });
+    }
+
     // Getters
     const std::string& getUserId() const { return oderId_; }
     const std::string& getRoomId() const { return roomId_; }
     const std::string& getUserName() const { return userName_; }
     bool isInRoom() const { return !roomId_.empty(); }
 
+    /**
+     * @brief Outbound queue depth and drop counters (safe to read from any thread).
+     */
+    const OutboundStats& getOutboundStats() const { return writeQueue_.stats(); }
+
 private:
+    /**
+     * @brief Stream options set before the handshake.
+     */
+    void configureStream() {
+        // Set suggested timeout settings for the websocket
+        ws_.set_option(websocket::stream_base::timeout::suggested(
+            beast::role_type::server));
+
+        // Set a decorator to change the Server field of the handshake
+        ws_.set_option(websocket::stream_base::decorator(
+            [](websocket::response_type& res) {
+                res.set(beast::http::field::server, "CollabBoard/1.0");
+            }));
+        ws_.set_option(deflate_.option());
+        ws_.read_message_max(readMessageMax_);
+
+        // Pongs (and client pings) are heartbeats too; runs inside the read
+        ws_.control_callback([this](websocket::frame_type, beast::string_view) {
+            lastPing_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+        });
+        if (writeBufferBytes_ > 0) {
+            ws_.write_buffer_bytes(std::max<size_t>(writeBufferBytes_, 8));  // Beast's minimum
+        }
+    }
+
     /**
      * @brief Called when WebSocket accept completes.
      */
     void onAccept(beast::error_code ec) {
         if (ec) {
-            return fail(ec, "accept");
+            return fail(ec, ServerMetrics::SessionOp::Accept);
         }
         // Start reading
         doRead();
@@ -144,18 +241,31 @@ private:
             return onDisconnect();
         }
         if (ec) {
-            return fail(ec, "read");
+            return fail(ec, ServerMetrics::SessionOp::Read);
         }
 
-        // Process the message
-        std::string message = beast::buffers_to_string(buffer_.data());
-        buffer_.consume(buffer_.size());
-
         // Update last ping time
-        lastPing_ = std::chrono::steady_clock::now();
+        lastPing_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+
+        // Both encodings are decoded in place from the read buffer
+        auto bytes = buffer_.data();
+        std::string_view message(static_cast<const char*>(bytes.data()), bytes.size());
+        if (ws_.got_binary()) {
+            messageHandler_.handleBinary(
+                shared_from_this(),
+                room_,
+                oderId_,
+                message,
+                sessionSendFunc());
+        } else {
+            onMessage(message);
+        }
+        buffer_.consume(buffer_.size());
 
-        // Handle the message
-        onMessage(message);
+        // Flooding past every mute: drop the connection
+        if (messageHandler_.shouldDisconnect()) {
+            return abort();
+        }
 
         // Continue reading
         doRead();
@@ -164,48 +274,51 @@ private:
     /**
      * @brief Process an incoming message.
      */
-    void onMessage(const std::string& message) {
-        // Create send function
-        auto sendFunc = [](std::shared_ptr<WsSession> session, const std::string& msg) {
-            if (session) {
-                session->send(msg);
-            }
-        };
-
+    void onMessage(std::string_view message) {
         // Handle message through message handler
         auto result = messageHandler_.handle(
             shared_from_this(),
-            roomId_,
+            room_,
             oderId_,
             message,
-            sendFunc
+            sessionSendFunc()
         );
 
         // If this was a join message, update session state
-        if (result.has_value()) {
-            if (result->success) {
-                // Parse room ID from original message
-                try {
-                    auto msg = MessageCodec::parse(message);
-                    auto data = MessageCodec::getData(msg);
-                    roomId_ = data["roomId"].get<std::string>();
-                    userName_ = data["userName"].get<std::string>();
-                    oderId_ = result->oderId;
-                    userColor_ = result->color;
-                } catch (...) {
-                    // Parse error, but join succeeded - shouldn't happen
-                }
-            }
+        if (result.has_value() && result->success) {
+            room_ = result->room;
+            roomId_ = result->roomId;
+            userName_ = result->userName;
+            oderId_ = result->oderId;
+            userColor_ = result->color;
+            binaryFrames_ = result->binary;
         }
     }
 
     /**
-     * @brief Queue a message for sending.
+     * @brief Queue a frame for sending.
      */
-    void doSend(const std::string& message) {
+    void doSend(OutboundFrame frame) {
         if (isClosed_) return;
 
-        writeQueue_.push(message);
+        if (binaryFrames_) {
+            frame = frame.asBinary();
+        }
+
+        switch (writeQueue_.push(std::move(frame))) {
+            case OutboundQueue::PushResult::Overflow:
+                // Client can't keep up even with cursor frames shed; cut it loose
+                ServerMetrics::global().slowConsumerDisconnects.add();
+                return abort();
+            case OutboundQueue::PushResult::Dropped:
+                ServerMetrics::global().framesDropped.add();
+                break;
+            case OutboundQueue::PushResult::Conflated:
+                ServerMetrics::global().framesConflated.add();
+                break;
+            case OutboundQueue::PushResult::Queued:
+                break;
+        }
 
         // If not already writing, start the write loop
         if (!isWriting_) {
@@ -214,23 +327,81 @@ private:
     }
 
     /**
-     * @brief Write the next message from the queue.
+     * @brief Write everything queued since the last write completed.
+     *
+     * A single pending frame is written as-is. Several frames are sent as one
+     * batch message, written as a gathered buffer sequence over the shared
+     * payloads so nothing is copied. A batch is all text or all binary; the
+     * queue splits batches where the encoding changes.
      */
     void doWrite() {
-        if (writeQueue_.empty()) {
+        uint64_t queuedBytes = writeQueue_.stats().queuedBytes.load(std::memory_order_relaxed);
+        if (writeQueue_.drainBatch(inflight_) == 0) {
             isWriting_ = false;
             return;
         }
 
         isWriting_ = true;
-        currentWrite_ = writeQueue_.front();
-        writeQueue_.pop();
+        writeBuffers_.clear();
+        ServerMetrics::global().writeQueueBytes.record(queuedBytes);
+
+        bool binary = inflight_.front().isBinary();
+        ws_.binary(binary);
+
+        if (inflight_.size() == 1) {
+            writeBuffers_.emplace_back(inflight_.front().data(), inflight_.front().size());
+        } else if (binary) {
+            appendBinaryBatchBuffers();
+        } else {
+            writeBuffers_.emplace_back(MessageCodec::BatchPrefix.data(),
+                                       MessageCodec::BatchPrefix.size());
+            for (size_t i = 0; i < inflight_.size(); ++i) {
+                if (i > 0) {
+                    writeBuffers_.emplace_back(MessageCodec::BatchSeparator.data(),
+                                               MessageCodec::BatchSeparator.size());
+                }
+                writeBuffers_.emplace_back(inflight_[i].data(), inflight_[i].size());
+            }
+            writeBuffers_.emplace_back(MessageCodec::BatchSuffix.data(),
+                                       MessageCodec::BatchSuffix.size());
+        }
 
+        // inflight_ keeps the payloads alive until the write completes
         ws_.async_write(
-            net::buffer(currentWrite_),
+            writeBuffers_,
             beast::bind_front_handler(&WsSession::onWrite, shared_from_this()));
     }
 
+    /**
+     * @brief Gather a binary batch: header, then each member's varint length
+     * and bytes. The varints are all appended to batchHeader_ before any
+     * buffer points into it, so the buffers stay valid.
+     */
+    void appendBinaryBatchBuffers() {
+        batchHeader_.clear();
+        batchHeader_.reserve(12 + inflight_.size() * 10);
+
+        batchHeader_.push_back(static_cast<char>(BinaryTag::Batch));
+        BinaryWriter::appendVarint(batchHeader_, 0);
+        BinaryWriter::appendVarint(batchHeader_, inflight_.size());
+        size_t headerSize = batchHeader_.size();
+
+        std::vector<size_t> lengthOffsets;
+        lengthOffsets.reserve(inflight_.size() + 1);
+        for (const auto& frame : inflight_) {
+            lengthOffsets.push_back(batchHeader_.size());
+            BinaryWriter::appendVarint(batchHeader_, frame.size());
+        }
+        lengthOffsets.push_back(batchHeader_.size());
+
+        writeBuffers_.emplace_back(batchHeader_.data(), headerSize);
+        for (size_t i = 0; i < inflight_.size(); ++i) {
+            writeBuffers_.emplace_back(batchHeader_.data() + lengthOffsets[i],
+                                       lengthOffsets[i + 1] - lengthOffsets[i]);
+            writeBuffers_.emplace_back(inflight_[i].data(), inflight_[i].size());
+        }
+    }
+
     /**
      * @brief Called when a write completes.
      */
@@ -238,10 +409,10 @@ private:
         boost::ignore_unused(bytesTransferred);
 
         if (ec) {
-            return fail(ec, "write");
+            return fail(ec, ServerMetrics::SessionOp::Write);
         }
 
-        // Write next message
+        // Write whatever queued up meanwhile
         doWrite();
     }
 
@@ -259,47 +430,79 @@ private:
         ws_.close(websocket::close_code::normal, ec);
     }
 
+    /**
+     * @brief Drop the connection without a close handshake.
+     * Used when the peer is too slow to drain its queue; any in-flight
+     * operations complete with an error and unwind normally.
+     */
+    void abort() {
+        if (isClosed_) return;
+        isClosed_ = true;
+
+        writeQueue_.clear();
+        onDisconnect();
+
+        beast::error_code ec;
+        beast::get_lowest_layer(ws_).socket().close(ec);
+    }
+
     /**
      * @brief Handle disconnect/cleanup.
      */
     void onDisconnect() {
         if (!roomId_.empty() && !oderId_.empty()) {
-            auto sendFunc = [](std::shared_ptr<WsSession> session, const std::string& msg) {
-                if (session) {
-                    session->send(msg);
-                }
-            };
-            roomService_.leaveRoom(roomId_, oderId_, sendFunc);
+            roomService_.leaveRoom(roomId_, oderId_, sessionSendFunc());
+            room_.reset();
             roomId_.clear();
             oderId_.clear();
         }
     }
 
     /**
-     * @brief Handle an error.
+     * @brief Handle an error: count it, log it unless it is a routine
+     * disconnect or our own shutdown, and leave the room.
      */
-    void fail(beast::error_code ec, char const* what) {
-        // Log error (in production, use proper logging)
-        // std::cerr << what << ": " << ec.message() << std::endl;
+    void fail(beast::error_code ec, ServerMetrics::SessionOp op) {
+        ServerMetrics::global().sessionError(op).add();
+
+        bool routine = ec == net::error::operation_aborted ||
+                       ec == net::error::eof ||
+                       ec == net::error::connection_reset ||
+                       ec == beast::error::timeout ||
+                       ec == websocket::error::closed;
+        if (!routine && !isClosed_) {
+            static constexpr const char* Ops[] = {"accept", "read", "write"};
+            std::cerr << "Session " << Ops[static_cast<size_t>(op)] << " error"
+                      << (roomId_.empty() ? "" : " in room ") << roomId_
+                      << ": " << ec.message() << std::endl;
+        }
         onDisconnect();
     }
 
     websocket::stream<beast::tcp_stream> ws_;
     RoomService& roomService_;
     MessageHandler messageHandler_;
+    DeflatePolicy deflate_;
+    size_t readMessageMax_;
+    size_t writeBufferBytes_;
     net::strand<net::any_io_executor> strand_;
     beast::flat_buffer buffer_;
     
-    std::queue<std::string> writeQueue_;
-    std::string currentWrite_;
+    OutboundQueue writeQueue_;
+    std::vector<OutboundFrame> inflight_;
+    std::vector<net::const_buffer> writeBuffers_;
+    std::string batchHeader_;            // Binary batch header and member lengths
+    bool binaryFrames_;                  // Negotiated binary protocol at join
     bool isWriting_;
     bool isClosed_;
 
     std::string oderId_;
     std::string roomId_;
+    std::shared_ptr<Room> room_;         // Cached at join; skips the registry per message
     std::string userName_;
     std::string userColor_;
-    std::chrono::steady_clock::time_point lastPing_;
+    std::atomic<std::chrono::steady_clock::time_point> lastPing_;  // Last read, or control frame
+    std::atomic<bool> pinging_{false};
 };
 
 } // namespace collabboard
@@ -1,19 +1,27 @@
 #pragma once
 
 #include <string>
+#include <span>
 #include <memory>
 #include <functional>
 #include <optional>
+#include <algorithm>
 
 #include "../models/room.hpp"
 #include "../models/stroke.hpp"
+#include "../models/stroke_compaction.hpp"
 #include "../protocol/message_codec.hpp"
 #include "../protocol/message_types.hpp"
+#include "../storage/board_storage.hpp"
 
 namespace collabboard {
 
 /**
  * @brief Handles drawing stroke events and generates board snapshots.
+ *
+ * With storage set, every accepted change is journaled under the room
+ * lock, right where it is applied, and a room whose log has grown past
+ * the compaction threshold gets a fresh snapshot.
  */
 class BoardService {
 public:
@@ -22,6 +30,34 @@ public:
         , snapshotLimit_(ProtocolConstants::SnapshotStrokeLimit)
     {}
 
+    /**
+     * @brief Journal board changes to storage (nullptr to stop).
+     * The storage must outlive this service.
+     */
+    void setStorage(BoardStorage* storage) {
+        storage_ = storage;
+    }
+
+    /**
+     * @brief Simplify and quantize strokes as they finish (none() to keep
+     * points as sent). Set before sessions are served.
+     */
+    void setStrokeCompaction(const StrokeCompaction& compaction) {
+        compaction_ = compaction;
+    }
+
+    const StrokeCompaction& getStrokeCompaction() const { return compaction_; }
+
+    /**
+     * @brief Cap on strokes sent in a snapshot (newest kept). Set before
+     * sessions are served.
+     */
+    void setSnapshotLimit(size_t strokes) {
+        snapshotLimit_ = std::max<size_t>(strokes, 1);
+    }
+
+    size_t getSnapshotLimit() const { return snapshotLimit_; }
+
     /**
      * @brief Handle stroke_start message.
      * @return Error code if failed, nullopt if success
@@ -32,21 +68,23 @@ public:
         const std::string& strokeId,
         const std::string& color,
         float width,
-        std::function<void(std::shared_ptr<WsSession>, const std::string&)> sendFunc) {
+        FrameSendFunc sendFunc) {
         
-        // Create new stroke
-        Stroke stroke(strokeId, oderId, color, width);
-        stroke.seq = room.nextSequence();
-        room.addStroke(stroke);
+        // Create new stroke; seq is assigned as it is stored
+        uint64_t seq = room.startStroke(Stroke(strokeId, oderId, color, width),
+                                        [&](const Stroke& stroke) {
+            if (storage_) storage_->logStart(room.getId(), stroke);
+        });
+        maybeCompact(room);
 
         // Broadcast to other users
-        std::string message = MessageCodec::createStrokeStart(
-            strokeId, oderId, color, width, stroke.seq
+        OutboundFrame message = MessageCodec::createStrokeStart(
+            strokeId, oderId, color, width, seq, room.wantsBinary()
         );
 
-        room.broadcast(message, oderId, [&sendFunc, &message](std::shared_ptr<WsSession> session) {
-            sendFunc(session, message);
-        });
+        // A new stroke has no points yet, so viewers with a viewport first
+        // see it when a stroke_add brings it into view
+        room.publishStroke(seq, message, oderId, strokeId, Bounds(), Bounds(), sendFunc);
 
         return std::nullopt;  // Success
     }
@@ -59,40 +97,46 @@ public:
         Room& room,
         const std::string& oderId,
         const std::string& strokeId,
-        const std::vector<Point>& points,
-        std::function<void(std::shared_ptr<WsSession>, const std::string&)> sendFunc) {
-        
-        // Find the stroke
-        Stroke* stroke = room.getStroke(strokeId);
-        if (!stroke) {
-            return ErrorCode::InvalidStroke;
-        }
-
-        // Verify ownership
-        if (stroke->oderId != oderId) {
-            return ErrorCode::InvalidStroke;
-        }
-
-        // Check if stroke is already complete
-        if (stroke->complete) {
-            return ErrorCode::InvalidStroke;
-        }
-
-        // Check point limit
-        if (stroke->pointCount() + points.size() > ProtocolConstants::MaxPointsPerStroke) {
-            return ErrorCode::StrokeTooLarge;
+        std::span<const Point> points,
+        FrameSendFunc sendFunc) {
+
+        // Validate and append under the room lock
+        uint64_t seq = 0;
+        Bounds before, after;   // Stroke extent around the change, for viewport fanout
+        auto error = room.withStroke(strokeId, [&](Stroke& stroke) -> std::optional<ErrorCode> {
+            // Verify ownership
+            if (stroke.oderId != oderId) {
+                return ErrorCode::InvalidStroke;
+            }
+
+            // Check if stroke is already complete
+            if (stroke.complete) {
+                return ErrorCode::InvalidStroke;
+            }
+
+            // Check point limit
+            if (stroke.pointCount() + points.size() > ProtocolConstants::MaxPointsPerStroke) {
+                return ErrorCode::StrokeTooLarge;
+            }
+
+            // Add points
+            before = stroke.extent();
+            stroke.addPoints(points);
+            after = stroke.extent();
+            seq = room.nextSequence();
+            if (storage_) storage_->logAdd(room.getId(), strokeId, points);
+            return std::nullopt;
+        });
+        if (error) {
+            return error;
         }
-
-        // Add points
-        stroke->addPoints(points);
+        maybeCompact(room);
 
         // Broadcast to other users
-        uint64_t seq = room.nextSequence();
-        std::string message = MessageCodec::createStrokeAdd(strokeId, oderId, points, seq);
+        OutboundFrame message = MessageCodec::createStrokeAdd(strokeId, oderId, points, seq,
+                                                               room.wantsBinary());
 
-        room.broadcast(message, oderId, [&sendFunc, &message](std::shared_ptr<WsSession> session) {
-            sendFunc(session, message);
-        });
+        room.publishStroke(seq, message, oderId, strokeId, before, after, sendFunc);
 
         return std::nullopt;  // Success
     }
@@ -105,29 +149,39 @@ public:
         Room& room,
         const std::string& oderId,
         const std::string& strokeId,
-        std::function<void(std::shared_ptr<WsSession>, const std::string&)> sendFunc) {
-        
-        // Find the stroke
-        Stroke* stroke = room.getStroke(strokeId);
-        if (!stroke) {
-            return ErrorCode::InvalidStroke;
-        }
-
-        // Verify ownership
-        if (stroke->oderId != oderId) {
-            return ErrorCode::InvalidStroke;
+        FrameSendFunc sendFunc) {
+
+        uint64_t seq = 0;
+        Bounds before, after;   // Stroke extent around the change, for viewport fanout
+        auto error = room.withStroke(strokeId, [&](Stroke& stroke) -> std::optional<ErrorCode> {
+            // Verify ownership
+            if (stroke.oderId != oderId) {
+                return ErrorCode::InvalidStroke;
+            }
+
+            // Compact the finished path; peers already drew the raw
+            // points, snapshots get the compact ones
+            before = stroke.extent();
+            if (!stroke.complete && compactStroke(stroke, compaction_) && storage_) {
+                storage_->logPoints(room.getId(), strokeId, stroke.points);
+            }
+
+            // Mark as complete
+            stroke.finish();
+            after = stroke.extent();
+            seq = room.nextSequence();
+            if (storage_) storage_->logEnd(room.getId(), strokeId);
+            return std::nullopt;
+        });
+        if (error) {
+            return error;
         }
-
-        // Mark as complete
-        stroke->finish();
+        maybeCompact(room);
 
         // Broadcast to other users
-        uint64_t seq = room.nextSequence();
-        std::string message = MessageCodec::createStrokeEnd(strokeId, oderId, seq);
+        OutboundFrame message = MessageCodec::createStrokeEnd(strokeId, oderId, seq, room.wantsBinary());
 
-        room.broadcast(message, oderId, [&sendFunc, &message](std::shared_ptr<WsSession> session) {
-            sendFunc(session, message);
-        });
+        room.publishStroke(seq, message, oderId, strokeId, before, after, sendFunc);
 
         return std::nullopt;  // Success
     }
@@ -141,34 +195,60 @@ public:
         const std::string& oderId,
         const std::string& strokeId,
         float dx, float dy,
-        std::function<void(std::shared_ptr<WsSession>, const std::string&)> sendFunc) {
-
-        Stroke* stroke = room.getStroke(strokeId);
-        if (!stroke) {
-            return ErrorCode::InvalidStroke;
-        }
-
-        // Verify ownership
-        if (stroke->oderId != oderId) {
-            return ErrorCode::InvalidStroke;
+        FrameSendFunc sendFunc) {
+
+        uint64_t seq = 0;
+        Bounds before, after;   // Stroke extent around the change, for viewport fanout
+        auto error = room.withStroke(strokeId, [&](Stroke& stroke) -> std::optional<ErrorCode> {
+            // Verify ownership
+            if (stroke.oderId != oderId) {
+                return ErrorCode::InvalidStroke;
+            }
+
+            // Only complete strokes can be moved
+            if (!stroke.complete) {
+                return ErrorCode::InvalidStroke;
+            }
+
+            // Translate points
+            before = stroke.extent();
+            stroke.translate(dx, dy);
+            after = stroke.extent();
+            seq = room.nextSequence();
+            if (storage_) storage_->logMove(room.getId(), strokeId, dx, dy);
+            return std::nullopt;
+        });
+        if (error) {
+            return error;
         }
+        maybeCompact(room);
 
-        // Only complete strokes can be moved
-        if (!stroke->complete) {
-            return ErrorCode::InvalidStroke;
-        }
+        // Broadcast to other users
+        OutboundFrame message = MessageCodec::createStrokeMove(strokeId, oderId, dx, dy, seq,
+                                                                room.wantsBinary());
 
-        // Translate points
-        stroke->translate(dx, dy);
+        room.publishStroke(seq, message, oderId, strokeId, before, after, sendFunc);
 
-        // Broadcast to other users
-        uint64_t seq = room.nextSequence();
-        std::string message = MessageCodec::createStrokeMove(strokeId, oderId, dx, dy, seq);
+        return std::nullopt;  // Success
+    }
 
-        room.broadcast(message, oderId, [&sendFunc, &message](std::shared_ptr<WsSession> session) {
-            sendFunc(session, message);
-        });
+    /**
+     * @brief Handle viewport message: scope the user's board updates to
+     *        the area it is looking at.
+     * @return Error code if failed, nullopt if success
+     */
+    std::optional<ErrorCode> handleViewport(
+        Room& room,
+        const std::string& oderId,
+        const Bounds& area,
+        FrameSendFunc sendFunc) {
 
+        if (area.empty()) {
+            return ErrorCode::InvalidField;
+        }
+        if (!room.setViewport(oderId, area, sendFunc)) {
+            return ErrorCode::NotInRoom;
+        }
         return std::nullopt;  // Success
     }
 
@@ -177,10 +257,26 @@ public:
      * @param room The room to snapshot
      * @return Snapshot message string
      */
-    std::string getSnapshot(Room& room) {
-        auto strokes = room.getStrokesSnapshot(snapshotLimit_);
-        uint64_t seq = room.currentSequence();
-        return MessageCodec::createRoomState(strokes, seq);
+    OutboundFrame getSnapshot(Room& room) {
+        return room.getSnapshotFrame(snapshotLimit_);
+    }
+
+    /**
+     * @brief Get board snapshot for a room as begin/chunk/end frames.
+     */
+    std::shared_ptr<const SnapshotChunks> getSnapshotChunks(Room& room) {
+        return room.getSnapshotChunks(snapshotLimit_);
+    }
+
+    /**
+     * @brief Get the snapshot a joining user needs.
+     * @param chunked Split into room_state_begin/chunk/end
+     * @param viewport Only the strokes in this (padded) area
+     * @param binary Include the binary encoding (for a binary client)
+     */
+    BoardSnapshot getJoinSnapshot(Room& room, bool chunked, const std::optional<Bounds>& viewport,
+                                  bool binary = true) {
+        return room.getJoinSnapshot(snapshotLimit_, chunked, viewport, binary);
     }
 
     /**
@@ -190,9 +286,40 @@ public:
         return room.getStrokeCount();
     }
 
+    /**
+     * @brief Snapshot the room to storage if anything was logged since its
+     * last snapshot, so a quiet room reloads from one file.
+     * @return true if a snapshot was queued
+     */
+    bool persist(Room& room) {
+        if (!storage_ || !storage_->needsCompaction(room.getId(), 1)) {
+            return false;
+        }
+        room.withStrokes([&](const StrokeStore& strokes) {
+            storage_->compact(room.getId(), strokes.copyNewest(strokes.size()));
+        });
+        return true;
+    }
+
 private:
+    /**
+     * @brief Snapshot the room to storage if its log is due for compaction.
+     */
+    void maybeCompact(Room& room) {
+        if (!storage_ || !storage_->needsCompaction(room.getId())) {
+            return;
+        }
+        // Captured under the lock the journal calls run under, so the
+        // snapshot includes exactly the records queued before it
+        room.withStrokes([&](const StrokeStore& strokes) {
+            storage_->compact(room.getId(), strokes.copyNewest(strokes.size()));
+        });
+    }
+
     size_t maxStrokesPerRoom_;
     size_t snapshotLimit_;
+    BoardStorage* storage_ = nullptr;
+    StrokeCompaction compaction_ = StrokeCompaction::none();
 };
 
 } // namespace collabboard
@@ -6,8 +6,9 @@
 
 #include "../models/room.hpp"
 #include "../models/user_info.hpp"
-#include "../utils/rate_limiter.hpp"
+#include "../utils/token_bucket.hpp"
 #include "../protocol/message_codec.hpp"
+#include "../protocol/message_types.hpp"
 
 namespace collabboard {
 
@@ -17,9 +18,29 @@ namespace collabboard {
 class PresenceService {
 public:
     PresenceService()
-        : rateLimiter_()  // Uses default 20 Hz, burst of 5
+        : cursorRate_(ProtocolConstants::CursorUpdatesPerSecond,
+                      ProtocolConstants::RateLimitBurstSize)  // 20 Hz, burst of 5
+        , cursorTickEnabled_(false)
     {}
 
+    /**
+     * @brief Switch between per-move broadcast and tick aggregation.
+     *
+     * With the tick enabled, handleCursorMove only records the position and
+     * flushCursorBatch sends every moved cursor in one frame per room. Set
+     * once at startup, before sessions are served.
+     */
+    void setCursorTickEnabled(bool enabled) { cursorTickEnabled_ = enabled; }
+    bool isCursorTickEnabled() const { return cursorTickEnabled_; }
+
+    /**
+     * @brief Per-user cursor update rate and burst. Set once at startup,
+     * before sessions are served.
+     */
+    void setCursorRate(double updatesPerSecond, double burst) {
+        cursorRate_ = TokenRate(updatesPerSecond, burst);
+    }
+
     /**
      * @brief Handle a cursor move from a user.
      * @param room The room to broadcast to
@@ -32,24 +53,21 @@ public:
     bool handleCursorMove(Room& room,
                           const std::string& oderId,
                           float x, float y,
-                          std::function<void(std::shared_ptr<WsSession>, const std::string&)> sendFunc) {
-        // Check rate limit
-        if (!rateLimiter_.tryConsume(oderId)) {
-            return false;  // Rate limited
+                          FrameSendFunc sendFunc) {
+        // Update cursor in room behind the user's own bucket (fails if
+        // rate limited or the user already left)
+        if (!room.updateCursor(oderId, x, y, cursorRate_)) {
+            return false;
         }
 
-        // Update cursor in room
-        room.updateCursor(oderId, x, y);
-
-        // Get user info for the cursor message
-        auto* user = room.getParticipant(oderId);
-        if (!user) {
-            return false;
+        // The next presence tick picks up the dirty cursor
+        if (cursorTickEnabled_) {
+            return true;
         }
 
         // Broadcast cursor position to other users
         uint64_t seq = room.nextSequence();
-        std::string message = MessageCodec::createCursorMove(oderId, x, y, seq);
+        OutboundFrame message = MessageCodec::createCursorMove(oderId, x, y, seq, room.wantsBinary());
 
         room.broadcast(message, oderId, [&sendFunc, &message](std::shared_ptr<WsSession> session) {
             sendFunc(session, message);
@@ -58,14 +76,36 @@ public:
         return true;
     }
 
+    /**
+     * @brief Broadcast every cursor that moved since the previous tick.
+     *
+     * One shared frame goes to each participant, including the movers; the
+     * client skips its own entry. Cost per tick is O(N) frames per room
+     * instead of O(N^2) per-move frames.
+     *
+     * @return Number of cursors sent (0 if nothing moved)
+     */
+    size_t flushCursorBatch(Room& room, FrameSendFunc sendFunc) {
+        auto cursors = room.takeDirtyCursors();
+        if (cursors.empty()) {
+            return 0;
+        }
+
+        uint64_t seq = room.nextSequence();
+        OutboundFrame message = MessageCodec::createCursorBatch(cursors, seq, room.wantsBinary());
+
+        room.broadcast(message, "", [&sendFunc, &message](std::shared_ptr<WsSession> session) {
+            sendFunc(session, message);
+        });
+
+        return cursors.size();
+    }
+
     /**
      * @brief Update a user's last seen timestamp.
      */
     void updateLastSeen(Room& room, const std::string& oderId) {
-        auto* user = room.getParticipant(oderId);
-        if (user) {
-            user->touch();
-        }
+        room.withParticipant(oderId, [](UserInfo& user) { user.touch(); });
     }
 
     /**
@@ -93,29 +133,31 @@ public:
     void markGhostsInactive(Room& room, int64_t timeoutMs = 3000) {
         auto ids = room.getParticipantIds();
         for (const auto& oderId : ids) {
-            auto* user = room.getParticipant(oderId);
-            if (user && user->isGhost(timeoutMs)) {
-                user->isActive = false;
-            }
+            room.withParticipant(oderId, [timeoutMs](UserInfo& user) {
+                if (user.isGhost(timeoutMs)) {
+                    user.isActive = false;
+                }
+            });
         }
     }
 
-    /**
-     * @brief Clean up rate limiter for a user who left.
-     */
-    void removeUser(const std::string& oderId) {
-        rateLimiter_.remove(oderId);
-    }
-
     /**
      * @brief Check if a user is currently rate limited.
      */
-    bool isRateLimited(const std::string& oderId) {
-        return !rateLimiter_.canConsume(oderId);
+    bool isRateLimited(Room& room, const std::string& oderId) {
+        bool limited = false;
+        int64_t now = CoarseClock::nowNs();
+        room.withParticipant(oderId, [&](UserInfo& user) {
+            limited = user.cursorBucket.creditNs(cursorRate_, now) < cursorRate_.intervalNs;
+        });
+        return limited;
     }
 
+    const TokenRate& getCursorRate() const { return cursorRate_; }
+
 private:
-    CursorRateLimiter rateLimiter_;
+    TokenRate cursorRate_;
+    bool cursorTickEnabled_;
 };
 
 } // namespace collabboard
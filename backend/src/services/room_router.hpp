@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * @brief One server in a cluster, as clients reach it.
+ */
+struct ClusterNode {
+    std::string id;   // Stable name; placement hashes it, so renaming moves rooms
+    std::string url;  // WebSocket URL clients are redirected to
+};
+
+/**
+ * @brief Assigns every room to exactly one cluster node.
+ *
+ * A consistent-hash ring with ClusterVirtualNodes points per node: each
+ * room belongs to the first point at or after the hash of its ID. Every
+ * node is started with the same node list, so all of them agree on the
+ * owner without talking to each other, and adding or removing a node
+ * only moves the rooms on that node's arcs (about 1/N of them).
+ *
+ * Only the owner ever creates the Room, so there is one nextSequence()
+ * counter per room cluster-wide and seq stays monotonic. Other nodes
+ * refuse the join with WRONG_NODE and the owner's URL. The hash is
+ * FNV-1a, not std::hash, so placement is the same on every build.
+ */
+class RoomRouter {
+public:
+    RoomRouter(std::string localId, std::vector<ClusterNode> nodes,
+               size_t virtualNodes = ProtocolConstants::ClusterVirtualNodes)
+        : localId_(std::move(localId))
+        , nodes_(std::move(nodes)) {
+        if (nodes_.empty()) {
+            throw std::invalid_argument("cluster has no nodes");
+        }
+        localIndex_ = nodes_.size();
+        for (size_t n = 0; n < nodes_.size(); ++n) {
+            if (nodes_[n].id == localId_) localIndex_ = n;
+        }
+        if (localIndex_ == nodes_.size()) {
+            throw std::invalid_argument("node '" + localId_ + "' is not in the cluster");
+        }
+
+        ring_.reserve(nodes_.size() * virtualNodes);
+        for (size_t n = 0; n < nodes_.size(); ++n) {
+            for (size_t v = 0; v < virtualNodes; ++v) {
+                std::string point = nodes_[n].id + "#" + std::to_string(v);
+                ring_.push_back({hash(point), static_cast<uint32_t>(n)});
+            }
+        }
+        std::sort(ring_.begin(), ring_.end(), [](const Point& a, const Point& b) {
+            return a.hash != b.hash ? a.hash < b.hash : a.node < b.node;
+        });
+    }
+
+    /**
+     * @brief Parse "id=url,id=url" (as in CLUSTER_NODES).
+     * @throws std::invalid_argument on an entry without '=' or a duplicate ID
+     */
+    static std::vector<ClusterNode> parseNodes(std::string_view spec) {
+        std::vector<ClusterNode> nodes;
+        while (!spec.empty()) {
+            size_t comma = spec.find(',');
+            std::string_view entry = spec.substr(0, comma);
+            spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+            if (entry.empty()) continue;
+
+            size_t eq = entry.find('=');
+            if (eq == 0 || eq == std::string_view::npos || eq + 1 == entry.size()) {
+                throw std::invalid_argument("cluster node must be id=url: " + std::string(entry));
+            }
+            ClusterNode node{std::string(entry.substr(0, eq)), std::string(entry.substr(eq + 1))};
+            for (const auto& existing : nodes) {
+                if (existing.id == node.id) {
+                    throw std::invalid_argument("duplicate cluster node: " + node.id);
+                }
+            }
+            nodes.push_back(std::move(node));
+        }
+        return nodes;
+    }
+
+    /**
+     * @brief The node that serves this room.
+     */
+    const ClusterNode& ownerOf(std::string_view roomId) const {
+        uint64_t h = hash(roomId);
+        auto it = std::lower_bound(ring_.begin(), ring_.end(), h,
+                                   [](const Point& p, uint64_t value) { return p.hash < value; });
+        if (it == ring_.end()) it = ring_.begin();
+        return nodes_[it->node];
+    }
+
+    bool isLocal(std::string_view roomId) const {
+        return &ownerOf(roomId) == &nodes_[localIndex_];
+    }
+
+    const ClusterNode& local() const { return nodes_[localIndex_]; }
+    const std::vector<ClusterNode>& nodes() const { return nodes_; }
+
+    /**
+     * @brief 64-bit FNV-1a with a final avalanche, so nearby IDs
+     *        ("room-1", "room-2") land far apart on the ring.
+     */
+    static uint64_t hash(std::string_view key) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    struct Point {
+        uint64_t hash;
+        uint32_t node;
+    };
+
+    std::string localId_;
+    std::vector<ClusterNode> nodes_;
+    size_t localIndex_ = 0;
+    std::vector<Point> ring_;
+};
+
+} // namespace collabboard
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <string>
+#include <span>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <optional>
 #include <functional>
 #include <array>
 #include <chrono>
+#include <vector>
+#include <algorithm>
 
 #include "../models/room.hpp"
 #include "../models/user_info.hpp"
@@ -16,6 +20,7 @@
 #include "../protocol/message_types.hpp"
 #include "presence_service.hpp"
 #include "board_service.hpp"
+#include "room_router.hpp"
 
 namespace collabboard {
 
@@ -31,6 +36,11 @@ struct JoinResult {
     std::string oderId;
     std::string color;
     std::string errorMessage;
+    bool binary = false;          // Client negotiated the binary protocol
+    bool resumed = false;         // Caught up from the replay log, no snapshot
+    std::string roomId{};         // Room joined (set on success)
+    std::string userName{};       // Display name joined with (set on success)
+    std::shared_ptr<Room> room{}; // Joined room, for the session to cache
 
     static JoinResult Success(const std::string& uid, const std::string& col) {
         return {true, ErrorCode::InternalError, uid, col, ""};
@@ -41,12 +51,50 @@ struct JoinResult {
     }
 };
 
+/**
+ * @brief Point-in-time counters for the stats endpoint.
+ */
+struct ServerStats {
+    struct RoomBytes {
+        std::string roomId;
+        size_t participants = 0;
+        size_t strokes = 0;
+        size_t boardBytes = 0;
+    };
+
+    size_t rooms = 0;
+    size_t participants = 0;
+    size_t boardBytes = 0;            // Sum of Stroke::estimateSize() over live rooms
+    size_t roomBudgetBytes = 0;       // 0 = unlimited
+    size_t totalBudgetBytes = 0;      // 0 = unlimited
+    uint64_t evictedStrokes = 0;      // Evicted to stay within a budget
+    std::vector<RoomBytes> largestRooms;  // By board bytes, largest first
+};
+
 /**
  * @brief Central service managing all rooms and routing messages.
+ *
+ * The room registry is split into shards by a hash of the room ID, each
+ * with its own reader/writer lock, so lookups for different rooms do not
+ * contend. Sessions cache the Room they joined and route through the
+ * Room& overloads, skipping the registry entirely. Rooms left empty are
+ * deleted by reapExpiredRooms(), which the server runs on a timer.
+ *
+ * If an executor factory is set, every new room gets its own executor and
+ * per-room work (message routes, presence ticks) is posted to it. If
+ * storage is set, boards are journaled to it and reloaded on demand.
+ *
+ * Every room reports its stroke bytes to one shared BoardMemory and keeps
+ * itself under the per-room budget; enforceMemoryBudget() trims the
+ * largest rooms when the server-wide total is over budget.
+ *
+ * If a router is set, the node only serves the rooms the cluster assigns
+ * to it; joins for any other room fail with WRONG_NODE.
  */
 class RoomService {
 public:
-    using SendFunc = std::function<void(std::shared_ptr<WsSession>, const std::string&)>;
+    using SendFunc = FrameSendFunc;
+    using ExecutorFactory = std::function<Room::Executor()>;
 
     explicit RoomService(std::chrono::seconds emptyRoomGracePeriod = std::chrono::seconds(60))
         : emptyRoomGracePeriod_(emptyRoomGracePeriod)
@@ -59,6 +107,71 @@ public:
         };
     }
 
+    /**
+     * @brief Give each room created from now on its own executor.
+     */
+    void setExecutorFactory(ExecutorFactory factory) {
+        executorFactory_ = std::move(factory);
+    }
+
+    /**
+     * @brief Build join snapshots on this executor instead of the joining
+     * session's thread.
+     *
+     * The joiner's board events are held by its room until the snapshot
+     * is delivered, so it still sees every event exactly once, after the
+     * snapshot. Unset, snapshots are built and sent inline.
+     */
+    void setSnapshotExecutor(Room::Executor executor) {
+        snapshotExecutor_ = std::move(executor);
+    }
+
+    /**
+     * @brief Persist boards to storage and load cold rooms from it.
+     *
+     * A room created from now on starts with the board stored for it, so
+     * a room reaped while empty, or lost to a restart, comes back on the
+     * next join. The storage must outlive this service.
+     */
+    void setStorage(BoardStorage* storage) {
+        storage_ = storage;
+        boardService_.setStorage(storage);
+    }
+
+    /**
+     * @brief Set stroke byte budgets for rooms created from now on and
+     * for enforceMemoryBudget().
+     */
+    void setMemoryBudget(const MemoryBudget& budget) {
+        memoryBudget_ = budget;
+    }
+
+    const MemoryBudget& getMemoryBudget() const { return memoryBudget_; }
+
+    /**
+     * @brief Set user and stroke caps for rooms created from now on.
+     */
+    void setRoomLimits(const RoomLimits& limits) {
+        roomLimits_ = limits;
+    }
+
+    const RoomLimits& getRoomLimits() const { return roomLimits_; }
+
+    /**
+     * @brief Serve only the rooms this cluster node owns. The router must
+     *        outlive this service; nullptr serves every room.
+     */
+    void setRouter(const RoomRouter* router) {
+        router_ = router;
+    }
+
+    const RoomRouter* getRouter() const { return router_; }
+
+    /**
+     * @brief Stroke bytes held by all live rooms.
+     */
+    size_t getBoardBytes() const { return memory_->totalBytes(); }
+
     // =========================================================================
     // Room Management
     // =========================================================================
@@ -69,55 +182,195 @@ public:
      */
     std::shared_ptr<Room> getOrCreateRoom(const std::string& roomId, 
                                            const std::string& password = "") {
-        std::lock_guard<std::mutex> lock(roomsMutex_);
-        cleanupExpiredRoomsLocked();
+        RoomShard& shard = shardFor(roomId);
+        std::unique_lock lock(shard.mutex);
 
         // Cancel any pending deletion - someone is joining
-        roomsPendingDeletion_.erase(roomId);
+        shard.pendingDeletion.erase(roomId);
 
-        auto it = rooms_.find(roomId);
-        if (it != rooms_.end()) {
+        auto it = shard.rooms.find(roomId);
+        if (it != shard.rooms.end()) {
             return it->second;
         }
 
-        auto room = std::make_shared<Room>(roomId, password);
-        rooms_[roomId] = room;
-        return room;
+        if (!storage_) {
+            auto room = createRoom(roomId, password);
+            shard.rooms[roomId] = room;
+            return room;
+        }
+
+        // Load from disk without holding the shard lock; if another join
+        // registered the room meanwhile, theirs wins
+        lock.unlock();
+        auto room = createRoom(roomId, password);
+        for (const Stroke& stroke : storage_->load(roomId, roomLimits_.maxStrokes)) {
+            room->addStroke(stroke);
+        }
+
+        lock.lock();
+        shard.pendingDeletion.erase(roomId);
+        return shard.rooms.try_emplace(roomId, room).first->second;
     }
 
     /**
      * @brief Get a room by ID.
      * @return Pointer to room, or nullptr if not found
      */
-    std::shared_ptr<Room> getRoom(const std::string& roomId) {
-        std::lock_guard<std::mutex> lock(roomsMutex_);
-        cleanupExpiredRoomsLocked();
-        auto it = rooms_.find(roomId);
-        return (it != rooms_.end()) ? it->second : nullptr;
+    std::shared_ptr<Room> getRoom(const std::string& roomId) const {
+        const RoomShard& shard = shardFor(roomId);
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.rooms.find(roomId);
+        return (it != shard.rooms.end()) ? it->second : nullptr;
     }
 
     /**
      * @brief Check if a room exists.
      */
-    bool roomExists(const std::string& roomId) {
-        std::lock_guard<std::mutex> lock(roomsMutex_);
-        return rooms_.find(roomId) != rooms_.end();
+    bool roomExists(const std::string& roomId) const {
+        return getRoom(roomId) != nullptr;
     }
 
     /**
      * @brief Delete a room.
      */
     void deleteRoom(const std::string& roomId) {
-        std::lock_guard<std::mutex> lock(roomsMutex_);
-        rooms_.erase(roomId);
+        RoomShard& shard = shardFor(roomId);
+        std::unique_lock lock(shard.mutex);
+        shard.rooms.erase(roomId);
+        shard.pendingDeletion.erase(roomId);
     }
 
     /**
      * @brief Get room count.
      */
     size_t getRoomCount() const {
-        std::lock_guard<std::mutex> lock(roomsMutex_);
-        return rooms_.size();
+        size_t count = 0;
+        for (const auto& shard : shards_) {
+            std::shared_lock lock(shard.mutex);
+            count += shard.rooms.size();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Delete rooms that have been empty past the grace period.
+     *
+     * A room that was rejoined since it was scheduled is kept.
+     *
+     * @return Number of rooms deleted
+     */
+    size_t reapExpiredRooms() {
+        auto now = std::chrono::steady_clock::now();
+        size_t reaped = 0;
+        for (auto& shard : shards_) {
+            std::unique_lock lock(shard.mutex);
+            for (auto it = shard.pendingDeletion.begin(); it != shard.pendingDeletion.end(); ) {
+                if (it->second > now) {
+                    ++it;
+                    continue;
+                }
+                auto roomIt = shard.rooms.find(it->first);
+                if (roomIt != shard.rooms.end() && roomIt->second->isEmpty()) {
+                    shard.rooms.erase(roomIt);
+                    ++reaped;
+                }
+                it = shard.pendingDeletion.erase(it);
+            }
+        }
+        return reaped;
+    }
+
+    /**
+     * @brief Hibernate rooms whose board has been idle for idleFor (see
+     * Room::hibernate()), snapshotting each to storage if one is set.
+     *
+     * @return Number of rooms hibernated
+     */
+    size_t hibernateIdleRooms(std::chrono::milliseconds idleFor) {
+        size_t hibernated = 0;
+        for (const auto& room : snapshotRooms()) {
+            if (room->hibernate(idleFor)) {
+                boardService_.persist(*room);
+                ServerMetrics::global().roomsHibernated.add();
+                ++hibernated;
+            }
+        }
+        return hibernated;
+    }
+
+    /**
+     * @brief Get every room currently registered.
+     */
+    std::vector<std::shared_ptr<Room>> getRooms() const {
+        return snapshotRooms();
+    }
+
+    /**
+     * @brief Bring the server-wide stroke bytes back under budget.
+     *
+     * Trims the largest boards first, each down to the size of the next
+     * largest (or to what the total still allows), so one runaway room
+     * pays for the overrun before quiet ones do. The server runs this on
+     * a timer next to reapExpiredRooms().
+     *
+     * @return Number of strokes evicted
+     */
+    size_t enforceMemoryBudget() {
+        size_t limit = memoryBudget_.totalBytes;
+        if (limit == 0 || memory_->totalBytes() <= limit) {
+            return 0;
+        }
+
+        std::vector<std::pair<size_t, std::shared_ptr<Room>>> rooms;
+        for (const auto& room : snapshotRooms()) {
+            rooms.emplace_back(room->getBoardBytes(), room);
+        }
+        std::sort(rooms.begin(), rooms.end(),
+                  [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        size_t evicted = 0;
+        for (size_t i = 0; i < rooms.size() && memory_->totalBytes() > limit; ++i) {
+            size_t excess = memory_->totalBytes() - limit;
+            size_t bytes = rooms[i].second->getBoardBytes();
+            size_t next = i + 1 < rooms.size() ? rooms[i + 1].first : 0;
+            size_t target = std::max(next, bytes > excess ? bytes - excess : 0);
+            evicted += rooms[i].second->trimToBytes(target);
+        }
+        return evicted;
+    }
+
+    /**
+     * @brief Collect counters for the stats endpoint.
+     * @param topRooms How many of the largest rooms to list
+     */
+    ServerStats getStats(size_t topRooms = 10) const {
+        ServerStats stats;
+        stats.boardBytes = memory_->totalBytes();
+        stats.roomBudgetBytes = memoryBudget_.roomBytes;
+        stats.totalBudgetBytes = memoryBudget_.totalBytes;
+        stats.evictedStrokes = memory_->evictedStrokes();
+
+        for (const auto& room : snapshotRooms()) {
+            ServerStats::RoomBytes entry;
+            entry.roomId = room->getId();
+            entry.participants = room->getParticipantCount();
+            entry.strokes = room->getStrokeCount();
+            entry.boardBytes = room->getBoardBytes();
+            ++stats.rooms;
+            stats.participants += entry.participants;
+            stats.largestRooms.push_back(std::move(entry));
+        }
+
+        auto byBytes = [](const auto& a, const auto& b) { return a.boardBytes > b.boardBytes; };
+        if (stats.largestRooms.size() > topRooms) {
+            std::partial_sort(stats.largestRooms.begin(),
+                              stats.largestRooms.begin() + static_cast<std::ptrdiff_t>(topRooms),
+                              stats.largestRooms.end(), byBytes);
+            stats.largestRooms.resize(topRooms);
+        } else {
+            std::sort(stats.largestRooms.begin(), stats.largestRooms.end(), byBytes);
+        }
+        return stats;
     }
 
     // =========================================================================
@@ -126,12 +379,31 @@ public:
 
     /**
      * @brief Join a user to a room.
+     * @param binary Client asked for the binary protocol; echoed in welcome
+     * @param chunkedState Client understands room_state_begin/chunk/end;
+     *        otherwise the snapshot goes out as a single room_state
+     * @param resume Set for a reconnect: if the room's replay log still
+     *        covers the client's lastSeq, the missed board events are
+     *        replayed instead of sending a snapshot
+     * @param viewport Board area the client displays. If set, the user
+     *        only gets the strokes in it (plus ViewportMargin): a fresh
+     *        join gets a snapshot of the newest of those, a resumed one a
+     *        region_state of them after the replay
      */
     JoinResult joinRoom(const std::string& roomId,
                         const std::string& userName,
                         const std::string& password,
                         std::shared_ptr<WsSession> session,
-                        SendFunc sendFunc) {
+                        SendFunc sendFunc,
+                        bool binary = false,
+                        bool chunkedState = false,
+                        const std::optional<ResumePoint>& resume = std::nullopt,
+                        const std::optional<Bounds>& viewport = std::nullopt) {
+        // Another node owns the room; send the client there
+        if (router_ && !router_->isLocal(roomId)) {
+            return JoinResult::Failure(ErrorCode::WrongNode, router_->ownerOf(roomId).url);
+        }
+
         // Get or create room
         auto room = getOrCreateRoom(roomId, password);
 
@@ -145,43 +417,68 @@ public:
             return JoinResult::Failure(ErrorCode::RoomFull);
         }
 
-        // Assign user ID and color
-        std::string oderId = generateUserId();
+        // Assign user ID and color. A resuming user with the right token
+        // keeps its old ID (so it still owns its strokes) unless someone
+        // else holds it now; the room decides under its lock.
         std::string color = getNextColor();
 
         // Create user info
-        UserInfo userInfo(oderId, userName, color);
+        UserInfo userInfo(generateUserId(), userName, color);
         userInfo.session = session;
+        userInfo.binary = binary;
+        if (viewport) {
+            userInfo.viewport = viewport->expanded(ProtocolConstants::ViewportMargin);
+        }
 
-        // Add to room
-        if (!room->addParticipant(oderId, userInfo)) {
+        // Add to room, send the welcome, and replay missed events if we can.
+        // Replay needs the old ID: the client filters out its own events.
+        auto admission = room->admitParticipant(userInfo, resume ? &*resume : nullptr,
+            [&](const std::vector<UserInfo>& existingUsers, bool resumed, const std::string& token) {
+                uint64_t welcomeSeq = room->nextSequence();
+                OutboundFrame welcomeMsg = MessageCodec::createWelcome(
+                    userInfo.userId, color, existingUsers, welcomeSeq, binary,
+                    room->getEpoch(), resumed, token
+                );
+                sendFunc(session, welcomeMsg);
+            },
+            [&](const OutboundFrame& missed) {
+                sendFunc(session, missed);
+            });
+
+        if (admission == Room::Admission::Full) {
             return JoinResult::Failure(ErrorCode::RoomFull);
         }
-
-        // Get existing users for welcome message
-        auto existingUsers = room->getParticipants();
-
-        // Send welcome to joining user
-        uint64_t welcomeSeq = room->nextSequence();
-        std::string welcomeMsg = MessageCodec::createWelcome(
-            oderId, color, existingUsers, welcomeSeq
-        );
-        sendFunc(session, welcomeMsg);
-
-        // Send room state (board snapshot)
-        std::string stateMsg = boardService_.getSnapshot(*room);
-        sendFunc(session, stateMsg);
+        const std::string& oderId = userInfo.userId;
+
+        // Send room state (board snapshot) unless the client was caught up
+        // from the log. Chunks and end are bulk frames, so the session
+        // interleaves live traffic ahead of them.
+        if (admission == Room::Admission::NeedsSnapshot) {
+            sendSnapshot(room, oderId, session, sendFunc, chunkedState, userInfo.viewport, binary);
+        } else if (userInfo.viewport) {
+            // The client only holds what was in its old view, and the
+            // replay only carries changes: resend what is in view now
+            if (auto region = room->getRegionFrame(*userInfo.viewport, binary)) {
+                sendFunc(session, *region);
+            }
+        }
 
         // Broadcast user_joined to others
         uint64_t joinSeq = room->nextSequence();
-        std::string joinMsg = MessageCodec::createUserJoined(
+        OutboundFrame joinMsg = MessageCodec::createUserJoined(
             oderId, userName, color, joinSeq
         );
         room->broadcast(joinMsg, oderId, [&sendFunc, &joinMsg](std::shared_ptr<WsSession> s) {
             sendFunc(s, joinMsg);
         });
 
-        return JoinResult::Success(oderId, color);
+        auto result = JoinResult::Success(oderId, color);
+        result.binary = binary;
+        result.resumed = admission == Room::Admission::Replayed;
+        result.roomId = roomId;
+        result.userName = userName;
+        result.room = room;
+        return result;
     }
 
     /**
@@ -193,15 +490,12 @@ public:
         auto room = getRoom(roomId);
         if (!room) return;
 
-        // Remove participant
+        // Remove participant (its cursor and rate bucket go with it)
         room->removeParticipant(oderId);
 
-        // Clean up presence tracking
-        presenceService_.removeUser(oderId);
-
         // Broadcast user_left
         uint64_t seq = room->nextSequence();
-        std::string leaveMsg = MessageCodec::createUserLeft(oderId, seq);
+        OutboundFrame leaveMsg = MessageCodec::createUserLeft(oderId, seq);
         room->broadcast(leaveMsg, "", [&sendFunc, &leaveMsg](std::shared_ptr<WsSession> s) {
             sendFunc(s, leaveMsg);
         });
@@ -209,7 +503,9 @@ public:
         // Schedule room deletion if empty - grace period allows reconnection on refresh
         if (room->isEmpty()) {
             auto deadline = std::chrono::steady_clock::now() + emptyRoomGracePeriod_;
-            roomsPendingDeletion_[roomId] = deadline;
+            RoomShard& shard = shardFor(roomId);
+            std::unique_lock lock(shard.mutex);
+            shard.pendingDeletion[roomId] = deadline;
         }
     }
 
@@ -217,6 +513,9 @@ public:
     // Message Routing
     // =========================================================================
 
+    // Each route has a by-ID form, which looks the room up, and a Room&
+    // form for sessions that cached their room at join.
+
     /**
      * @brief Route a cursor move message.
      * @return Error code if failed, nullopt if success
@@ -229,8 +528,15 @@ public:
         if (!room) {
             return ErrorCode::RoomNotFound;
         }
+        return handleCursorMove(*room, oderId, x, y, sendFunc);
+    }
 
-        if (!presenceService_.handleCursorMove(*room, oderId, x, y, sendFunc)) {
+    std::optional<ErrorCode> handleCursorMove(Room& room,
+                                               const std::string& oderId,
+                                               float x, float y,
+                                               SendFunc sendFunc) {
+        if (!presenceService_.handleCursorMove(room, oderId, x, y, sendFunc)) {
+            ServerMetrics::global().cursorRateLimited.add();
             return ErrorCode::RateLimited;
         }
 
@@ -250,8 +556,16 @@ public:
         if (!room) {
             return ErrorCode::RoomNotFound;
         }
+        return handleStrokeStart(*room, oderId, strokeId, color, width, sendFunc);
+    }
 
-        return boardService_.handleStrokeStart(*room, oderId, strokeId, color, width, sendFunc);
+    std::optional<ErrorCode> handleStrokeStart(Room& room,
+                                                const std::string& oderId,
+                                                const std::string& strokeId,
+                                                const std::string& color,
+                                                float width,
+                                                SendFunc sendFunc) {
+        return boardService_.handleStrokeStart(room, oderId, strokeId, color, width, sendFunc);
     }
 
     /**
@@ -260,17 +574,24 @@ public:
     std::optional<ErrorCode> handleStrokeAdd(const std::string& roomId,
                                               const std::string& oderId,
                                               const std::string& strokeId,
-                                              const std::vector<Point>& points,
+                                              std::span<const Point> points,
                                               SendFunc sendFunc) {
         auto room = getRoom(roomId);
         if (!room) {
             return ErrorCode::RoomNotFound;
         }
+        return handleStrokeAdd(*room, oderId, strokeId, points, sendFunc);
+    }
 
+    std::optional<ErrorCode> handleStrokeAdd(Room& room,
+                                              const std::string& oderId,
+                                              const std::string& strokeId,
+                                              std::span<const Point> points,
+                                              SendFunc sendFunc) {
         // Update user activity
-        presenceService_.updateLastSeen(*room, oderId);
+        presenceService_.updateLastSeen(room, oderId);
 
-        return boardService_.handleStrokeAdd(*room, oderId, strokeId, points, sendFunc);
+        return boardService_.handleStrokeAdd(room, oderId, strokeId, points, sendFunc);
     }
 
     /**
@@ -284,8 +605,14 @@ public:
         if (!room) {
             return ErrorCode::RoomNotFound;
         }
+        return handleStrokeEnd(*room, oderId, strokeId, sendFunc);
+    }
 
-        return boardService_.handleStrokeEnd(*room, oderId, strokeId, sendFunc);
+    std::optional<ErrorCode> handleStrokeEnd(Room& room,
+                                              const std::string& oderId,
+                                              const std::string& strokeId,
+                                              SendFunc sendFunc) {
+        return boardService_.handleStrokeEnd(room, oderId, strokeId, sendFunc);
     }
 
     /**
@@ -300,8 +627,39 @@ public:
         if (!room) {
             return ErrorCode::RoomNotFound;
         }
+        return handleStrokeMove(*room, oderId, strokeId, dx, dy, sendFunc);
+    }
 
-        return boardService_.handleStrokeMove(*room, oderId, strokeId, dx, dy, sendFunc);
+    std::optional<ErrorCode> handleStrokeMove(Room& room,
+                                              const std::string& oderId,
+                                              const std::string& strokeId,
+                                              float dx, float dy,
+                                              SendFunc sendFunc) {
+        return boardService_.handleStrokeMove(room, oderId, strokeId, dx, dy, sendFunc);
+    }
+
+    /**
+     * @brief Route a viewport message.
+     */
+    std::optional<ErrorCode> handleViewport(Room& room,
+                                            const std::string& oderId,
+                                            const Bounds& area,
+                                            SendFunc sendFunc) {
+        return boardService_.handleViewport(room, oderId, area, sendFunc);
+    }
+
+    /**
+     * @brief Run one presence tick across all rooms, each on its executor.
+     * @return Number of rooms ticked
+     */
+    size_t flushCursorBatches(SendFunc sendFunc) {
+        auto rooms = snapshotRooms();
+        for (const auto& room : rooms) {
+            room->post([this, room, sendFunc]() {
+                presenceService_.flushCursorBatch(*room, sendFunc);
+            });
+        }
+        return rooms.size();
     }
 
     // =========================================================================
@@ -313,18 +671,63 @@ public:
 
 private:
     /**
-     * @brief Delete rooms that have been empty past the grace period.
-     * Must be called with roomsMutex_ held.
+     * @brief One slice of the room registry.
      */
-    void cleanupExpiredRoomsLocked() {
-        auto now = std::chrono::steady_clock::now();
-        for (auto it = roomsPendingDeletion_.begin(); it != roomsPendingDeletion_.end(); ) {
-            if (it->second <= now) {
-                rooms_.erase(it->first);
-                it = roomsPendingDeletion_.erase(it);
-            } else {
-                ++it;
+    struct RoomShard {
+        std::unordered_map<std::string, std::shared_ptr<Room>> rooms;
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> pendingDeletion;
+        mutable std::shared_mutex mutex;
+    };
+
+    std::shared_ptr<Room> createRoom(const std::string& roomId, const std::string& password) {
+        auto room = std::make_shared<Room>(roomId, password, roomLimits_);
+        room->setMemoryBudget(memoryBudget_.roomBytes, memory_);
+        if (executorFactory_) {
+            room->setExecutor(executorFactory_());
+        }
+        return room;
+    }
+
+    std::vector<std::shared_ptr<Room>> snapshotRooms() const {
+        std::vector<std::shared_ptr<Room>> rooms;
+        for (const auto& shard : shards_) {
+            std::shared_lock lock(shard.mutex);
+            for (const auto& [id, room] : shard.rooms) {
+                rooms.push_back(room);
+            }
+        }
+        return rooms;
+    }
+
+    RoomShard& shardFor(const std::string& roomId) {
+        return shards_[std::hash<std::string>{}(roomId) % shards_.size()];
+    }
+
+    const RoomShard& shardFor(const std::string& roomId) const {
+        return shards_[std::hash<std::string>{}(roomId) % shards_.size()];
+    }
+
+    /**
+     * @brief Build a joiner's snapshot and hand it to its session, on the
+     * snapshot executor if one is set.
+     *
+     * The task holds the room and session alive; if the user left or
+     * rejoined elsewhere by the time it runs, the room drops it.
+     */
+    void sendSnapshot(const std::shared_ptr<Room>& room, const std::string& oderId,
+                      const std::shared_ptr<WsSession>& session, const SendFunc& sendFunc,
+                      bool chunked, const std::optional<Bounds>& viewport, bool binary) {
+        int64_t startNs = metricNowNs();
+        auto task = [this, room, oderId, session, sendFunc, chunked, viewport, binary, startNs] {
+            BoardSnapshot snapshot = boardService_.getJoinSnapshot(*room, chunked, viewport, binary);
+            if (room->deliverSnapshot(oderId, session, snapshot, sendFunc)) {
+                ServerMetrics::global().snapshotDeliveryNs.recordSince(startNs);
             }
+        };
+        if (snapshotExecutor_) {
+            snapshotExecutor_(std::move(task));
+        } else {
+            task();
         }
     }
 
@@ -339,9 +742,14 @@ private:
     }
 
     std::chrono::seconds emptyRoomGracePeriod_;
-    std::unordered_map<std::string, std::shared_ptr<Room>> rooms_;
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> roomsPendingDeletion_;
-    mutable std::mutex roomsMutex_;
+    std::array<RoomShard, ProtocolConstants::RoomRegistryShards> shards_;
+    ExecutorFactory executorFactory_;
+    Room::Executor snapshotExecutor_;
+    BoardStorage* storage_ = nullptr;
+    const RoomRouter* router_ = nullptr;
+    MemoryBudget memoryBudget_;
+    RoomLimits roomLimits_;
+    std::shared_ptr<BoardMemory> memory_ = std::make_shared<BoardMemory>();
 
     PresenceService presenceService_;
     BoardService boardService_;
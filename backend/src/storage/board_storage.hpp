@@ -0,0 +1,782 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <filesystem>
+#include <stdexcept>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../models/stroke.hpp"
+#include "../models/stroke_store.hpp"
+#include "../protocol/binary_codec.hpp"
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+/**
+ * On-disk layout, one pair of files per room in the data directory:
+ *
+ *   <key>.log   header, then records appended as the board changes
+ *   <key>.snap  compacted board, replaced atomically by rename
+ *
+ *   log header := 8 bytes "CBLOG\0\0\1", u64 generation
+ *   record     := varint length, u32 fnv1a(body), body
+ *   body       := u8 op, str strokeId, op fields
+ *     start      str userId, str color, f32 width
+ *     add        points
+ *     end        (none)
+ *     move       f32 dx, f32 dy
+ *     points     points (replace all, e.g. after compaction)
+ *
+ *   snapshot   := 8 bytes "CBSNAP\0\1", u64 generation, varint n,
+ *                 n x stroke, u32 fnv1a(everything after the magic)
+ *   stroke     := str strokeId, str userId, str color, f32 width,
+ *                 u8 complete, points
+ *
+ * Fields use the binary protocol encodings (see binary_codec.hpp), but
+ * IDs are always plain str: the wire's compact id form may change with
+ * the protocol, and data directories must outlive that. A
+ * compaction writes snapshot generation g + 1 and then restarts the log
+ * with that generation, so a log whose generation differs from the
+ * snapshot's is already folded into it and is ignored. Replay stops at
+ * the first short or corrupt record (a torn tail from a crash).
+ */
+namespace StorageFormat {
+    constexpr char LogMagic[8] = {'C', 'B', 'L', 'O', 'G', 0, 0, 1};
+    constexpr char SnapshotMagic[8] = {'C', 'B', 'S', 'N', 'A', 'P', 0, 1};
+    constexpr size_t HeaderBytes = 16;
+
+    constexpr uint8_t OpStart = 1;
+    constexpr uint8_t OpAdd   = 2;
+    constexpr uint8_t OpEnd   = 3;
+    constexpr uint8_t OpMove  = 4;
+    constexpr uint8_t OpPoints = 5;
+
+    inline uint32_t fnv1a(std::string_view bytes) {
+        uint32_t hash = 2166136261u;
+        for (char c : bytes) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    inline void appendU32(std::string& out, uint32_t value) {
+        char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        out.append(bytes, sizeof(value));
+    }
+
+    inline void appendU64(std::string& out, uint64_t value) {
+        char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        out.append(bytes, sizeof(value));
+    }
+
+    inline uint32_t readU32(const char* src) {
+        uint32_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t readU64(const char* src) {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    inline void writeStroke(BinaryWriter& w, const Stroke& stroke) {
+        w.str(stroke.strokeId);
+        w.str(stroke.oderId);
+        w.str(stroke.color);
+        w.f32(stroke.width);
+        w.u8(stroke.complete ? 1 : 0);
+        w.points(stroke.points);
+    }
+
+    inline Stroke readStroke(BinaryReader& r) {
+        Stroke stroke;
+        stroke.strokeId = r.str();
+        stroke.oderId = r.str();
+        stroke.color = r.str();
+        stroke.width = r.f32();
+        stroke.complete = r.u8() != 0;
+        stroke.points = r.points(ProtocolConstants::MaxPointsPerStroke);
+        stroke.recomputeBounds();
+        return stroke;
+    }
+
+    inline std::string header(const char (&magic)[8], uint64_t generation) {
+        std::string out(magic, sizeof(magic));
+        appendU64(out, generation);
+        return out;
+    }
+
+    /**
+     * @brief Read a file header.
+     * @return false if the bytes do not start with this magic
+     */
+    inline bool readHeader(std::string_view bytes, const char (&magic)[8], uint64_t& generation) {
+        if (bytes.size() < HeaderBytes || std::memcmp(bytes.data(), magic, sizeof(magic)) != 0) {
+            return false;
+        }
+        generation = readU64(bytes.data() + sizeof(magic));
+        return true;
+    }
+
+    /**
+     * @brief Visit the intact records of a log body (after the header).
+     * @param fn Called as fn(std::string_view body) for each record
+     * @return Bytes covered by intact records; anything after is a torn tail
+     */
+    template<typename Fn>
+    size_t scanRecords(std::string_view bytes, Fn&& fn) {
+        size_t pos = 0;
+        while (pos < bytes.size()) {
+            BinaryReader r(bytes.substr(pos));
+            uint64_t length = r.varint();
+            if (!r.ok()) break;
+            size_t prefix = r.position();
+            if (length > bytes.size() - pos - prefix ||
+                bytes.size() - pos - prefix - length < sizeof(uint32_t)) {
+                break;
+            }
+            const char* checksum = bytes.data() + pos + prefix;
+            std::string_view body(checksum + sizeof(uint32_t), length);
+            if (readU32(checksum) != fnv1a(body)) break;
+            fn(body);
+            pos += prefix + sizeof(uint32_t) + length;
+        }
+        return pos;
+    }
+}
+
+/**
+ * @brief Tuning for BoardStorage.
+ */
+struct StorageOptions {
+    std::string directory;
+    size_t compactAfterRecords = ProtocolConstants::StorageCompactRecords;
+    bool sync = true;   // fdatasync each group commit (off: leave it to the OS)
+};
+
+/**
+ * @brief Durable per-room board storage: an append-only log of stroke
+ * events plus periodically compacted, memory-mapped snapshots.
+ *
+ * The log* calls only encode a record and queue it, so they are cheap
+ * enough to call from the io threads with the room lock held; that lock
+ * is what keeps each room's records in board order. A single writer
+ * thread drains the queue in batches: everything queued while it was
+ * busy is written with one write() per room and one fdatasync() per
+ * touched file, which is the group commit.
+ *
+ * Rooms are loaded back with load(), which maps the snapshot and replays
+ * the log on top of it.
+ */
+class BoardStorage {
+public:
+    explicit BoardStorage(StorageOptions options)
+        : options_(std::move(options)) {
+        std::error_code ec;
+        std::filesystem::create_directories(options_.directory, ec);
+        if (ec) {
+            throw std::runtime_error("Cannot create data directory " + options_.directory +
+                                     ": " + ec.message());
+        }
+        writer_ = std::thread([this] { run(); });
+    }
+
+    ~BoardStorage() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+        for (auto& [key, log] : logs_) {
+            ::close(log.fd);
+        }
+    }
+
+    BoardStorage(const BoardStorage&) = delete;
+    BoardStorage& operator=(const BoardStorage&) = delete;
+
+    // =========================================================================
+    // Recording (any thread)
+    // =========================================================================
+
+    void logStart(const std::string& roomId, const Stroke& stroke) {
+        BinaryWriter w(32 + stroke.strokeId.size() + stroke.oderId.size());
+        w.u8(StorageFormat::OpStart);
+        w.str(stroke.strokeId);
+        w.str(stroke.oderId);
+        w.str(stroke.color);
+        w.f32(stroke.width);
+        enqueueRecord(roomId, w.take());
+    }
+
+    void logAdd(const std::string& roomId, const std::string& strokeId,
+                std::span<const Point> points) {
+        BinaryWriter w(16 + strokeId.size() + points.size() * 2 * sizeof(float));
+        w.u8(StorageFormat::OpAdd);
+        w.str(strokeId);
+        w.points(points);
+        enqueueRecord(roomId, w.take());
+    }
+
+    void logEnd(const std::string& roomId, const std::string& strokeId) {
+        BinaryWriter w(8 + strokeId.size());
+        w.u8(StorageFormat::OpEnd);
+        w.str(strokeId);
+        enqueueRecord(roomId, w.take());
+    }
+
+    void logMove(const std::string& roomId, const std::string& strokeId, float dx, float dy) {
+        BinaryWriter w(16 + strokeId.size());
+        w.u8(StorageFormat::OpMove);
+        w.str(strokeId);
+        w.f32(dx);
+        w.f32(dy);
+        enqueueRecord(roomId, w.take());
+    }
+
+    void logPoints(const std::string& roomId, const std::string& strokeId,
+                   std::span<const Point> points) {
+        BinaryWriter w(16 + strokeId.size() + points.size() * 2 * sizeof(float));
+        w.u8(StorageFormat::OpPoints);
+        w.str(strokeId);
+        w.points(points);
+        enqueueRecord(roomId, w.take());
+    }
+
+    /**
+     * @brief Check whether a room's log has grown enough to compact.
+     */
+    bool needsCompaction(const std::string& roomId) const {
+        return needsCompaction(roomId, options_.compactAfterRecords);
+    }
+
+    /**
+     * @brief Check whether a room has logged at least minRecords since its
+     *        last compaction (1: anything at all).
+     */
+    bool needsCompaction(const std::string& roomId, size_t minRecords) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = uncompacted_.find(roomId);
+        return it != uncompacted_.end() && it->second >= minRecords;
+    }
+
+    /**
+     * @brief Replace a room's snapshot with these strokes and restart its log.
+     *
+     * strokes must be the board after every record logged so far for the
+     * room, so capture them under the same lock the log* calls run under.
+     */
+    void compact(const std::string& roomId, std::vector<Stroke> strokes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uncompacted_.erase(roomId);
+            queue_.push_back(Job{roomId, {}, std::move(strokes), true});
+            ++enqueued_;
+            ++pending_[roomId];
+        }
+        wake_.notify_one();
+    }
+
+    /**
+     * @brief Block until everything queued so far is written (and synced).
+     */
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = enqueued_;
+        done_.wait(lock, [&] { return committed_ >= target; });
+    }
+
+    /**
+     * @brief Block until everything queued for one room is written; other
+     *        rooms' queued work is not waited for.
+     */
+    void flush(const std::string& roomId) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return pending_.find(roomId) == pending_.end(); });
+    }
+
+    // =========================================================================
+    // Loading
+    // =========================================================================
+
+    /**
+     * @brief Rebuild a room's board from disk, oldest stroke first.
+     *
+     * Flushes the room's own queued records first so they are included,
+     * without waiting on other rooms' writes (a join loads on an io
+     * thread). The room must not be live: nothing may log to it while it
+     * loads.
+     *
+     * @param capacity Strokes to keep, as Room keeps (older ones are evicted)
+     */
+    std::vector<Stroke> load(const std::string& roomId,
+                             size_t capacity = ProtocolConstants::MaxStrokesPerRoom) {
+        flush(roomId);
+        std::string key = fileKey(roomId);
+        StrokeStore strokes(capacity);
+
+        uint64_t generation = 0;
+        MappedFile snapshot(path(key, ".snap"));
+        if (!readSnapshot(snapshot.view(), strokes, generation)) {
+            generation = 0;
+        }
+
+        MappedFile log(path(key, ".log"));
+        uint64_t logGeneration = 0;
+        if (StorageFormat::readHeader(log.view(), StorageFormat::LogMagic, logGeneration) &&
+            logGeneration == generation) {
+            StorageFormat::scanRecords(log.view().substr(StorageFormat::HeaderBytes),
+                                       [&](std::string_view body) { apply(strokes, body); });
+        }
+        return strokes.copyNewest(strokes.size());
+    }
+
+    // =========================================================================
+    // Stats (for tests/metrics)
+    // =========================================================================
+
+    uint64_t recordsWritten() const { return recordsWritten_.load(std::memory_order_relaxed); }
+    uint64_t commits() const { return commits_.load(std::memory_order_relaxed); }
+    uint64_t compactions() const { return compactions_.load(std::memory_order_relaxed); }
+    uint64_t errors() const { return errors_.load(std::memory_order_relaxed); }
+
+    const std::string& directory() const { return options_.directory; }
+
+private:
+    struct Job {
+        std::string roomId;
+        std::string record;           // Encoded body (record jobs)
+        std::vector<Stroke> strokes;  // Board to snapshot (compaction jobs)
+        bool compaction = false;
+    };
+
+    struct OpenLog {
+        int fd = -1;
+        uint64_t generation = 0;
+    };
+
+    /**
+     * @brief Read-only mapping of a whole file; empty if it is missing.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                                    MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    data_ = static_cast<const char*>(data);
+                    size_ = static_cast<size_t>(st.st_size);
+                }
+            }
+            ::close(fd);
+        }
+
+        ~MappedFile() {
+            if (data_) {
+                ::munmap(const_cast<char*>(data_), size_);
+            }
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        std::string_view view() const { return data_ ? std::string_view(data_, size_) : std::string_view(); }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    void enqueueRecord(const std::string& roomId, std::string body) {
+        std::string record;
+        record.reserve(body.size() + 16);
+        BinaryWriter::appendVarint(record, body.size());
+        StorageFormat::appendU32(record, StorageFormat::fnv1a(body));
+        record += body;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++uncompacted_[roomId];
+            queue_.push_back(Job{roomId, std::move(record), {}, false});
+            ++enqueued_;
+            ++pending_[roomId];
+        }
+        wake_.notify_one();
+    }
+
+    // =========================================================================
+    // Writer thread
+    // =========================================================================
+
+    void run() {
+        std::vector<Job> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;  // Stopping and drained
+                }
+                batch.swap(queue_);
+            }
+
+            commit(batch);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                committed_ += batch.size();
+                for (const Job& job : batch) {
+                    auto it = pending_.find(job.roomId);
+                    if (--it->second == 0) {
+                        pending_.erase(it);
+                    }
+                }
+            }
+            done_.notify_all();
+            batch.clear();
+        }
+    }
+
+    /**
+     * @brief Write one batch: coalesce records per room, then sync once each.
+     */
+    void commit(std::vector<Job>& batch) {
+        // Rooms in first-touched order, each with its pending bytes
+        std::vector<std::pair<std::string, std::string>> pending;
+        std::unordered_map<std::string, size_t> slot;
+        size_t records = 0;
+
+        for (Job& job : batch) {
+            auto [it, inserted] = slot.try_emplace(job.roomId, pending.size());
+            if (inserted) {
+                pending.emplace_back(job.roomId, std::string());
+            }
+            std::string& bytes = pending[it->second].second;
+
+            if (job.compaction) {
+                // The strokes already include every earlier record; if the
+                // snapshot is not written those still go to the old log
+                if (writeSnapshot(job.roomId, job.strokes)) {
+                    bytes.clear();
+                }
+            } else {
+                bytes += job.record;
+                ++records;
+            }
+        }
+
+        std::vector<int> touched;
+        for (auto& [roomId, bytes] : pending) {
+            if (bytes.empty()) continue;
+            OpenLog* log = openLog(roomId);
+            if (!log || !writeAll(log->fd, bytes)) {
+                report("append to log for room " + roomId);
+                continue;
+            }
+            touched.push_back(log->fd);
+        }
+        if (options_.sync) {
+            for (int fd : touched) {
+                if (::fdatasync(fd) != 0) {
+                    report("sync log");
+                }
+            }
+        }
+
+        recordsWritten_.fetch_add(records, std::memory_order_relaxed);
+        commits_.fetch_add(1, std::memory_order_relaxed);
+
+        if (logs_.size() > ProtocolConstants::StorageOpenLogs) {
+            for (auto& [key, log] : logs_) {
+                ::close(log.fd);
+            }
+            logs_.clear();
+        }
+    }
+
+    /**
+     * @brief Write a new snapshot generation, then restart the log on it.
+     *
+     * If the log cannot be restarted its cached handle is dropped, so the
+     * next openLog() finds the new snapshot and starts the log over.
+     *
+     * @return false if the snapshot was not replaced (the room's log and
+     *         old snapshot still hold the board)
+     */
+    bool writeSnapshot(const std::string& roomId, const std::vector<Stroke>& strokes) {
+        std::string key = fileKey(roomId);
+        OpenLog* log = openLog(roomId);
+        if (!log) {
+            report("open log for room " + roomId);
+            return false;
+        }
+        uint64_t generation = log->generation + 1;
+
+        size_t estimate = StorageFormat::HeaderBytes + 16;
+        for (const Stroke& stroke : strokes) {
+            estimate += 64 + stroke.points.size() * 2 * sizeof(float);
+        }
+        BinaryWriter body(estimate);
+        body.varint(strokes.size());
+        for (const Stroke& stroke : strokes) {
+            StorageFormat::writeStroke(body, stroke);
+        }
+        std::string bytes = StorageFormat::header(StorageFormat::SnapshotMagic, generation);
+        bytes += body.take();
+        StorageFormat::appendU32(bytes, StorageFormat::fnv1a(
+            std::string_view(bytes).substr(sizeof(StorageFormat::SnapshotMagic))));
+
+        std::string finalPath = path(key, ".snap");
+        std::string tmpPath = finalPath + ".tmp";
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            report("create snapshot for room " + roomId);
+            return false;
+        }
+        bool ok = writeAll(fd, bytes) && (!options_.sync || ::fsync(fd) == 0);
+        ::close(fd);
+        if (!ok || ::rename(tmpPath.c_str(), finalPath.c_str()) != 0) {
+            report("write snapshot for room " + roomId);
+            ::unlink(tmpPath.c_str());
+            return false;
+        }
+        syncDirectory();
+
+        // The old log is folded into the snapshot now
+        if (!restartLog(*log, generation)) {
+            report("restart log for room " + roomId);
+            ::close(log->fd);
+            logs_.erase(key);
+        }
+        compactions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Open (or create) a room's log for appending.
+     *
+     * An existing log is cut back to its last intact record, and one left
+     * behind by an interrupted compaction is restarted.
+     */
+    OpenLog* openLog(const std::string& roomId) {
+        std::string key = fileKey(roomId);
+        auto it = logs_.find(key);
+        if (it != logs_.end()) {
+            return &it->second;
+        }
+
+        uint64_t snapshotGeneration = 0;
+        {
+            MappedFile snapshot(path(key, ".snap"));
+            StorageFormat::readHeader(snapshot.view(), StorageFormat::SnapshotMagic, snapshotGeneration);
+        }
+
+        std::string logPath = path(key, ".log");
+        OpenLog log;
+        size_t validBytes = 0;
+        bool current = false;
+        {
+            MappedFile existing(logPath);
+            uint64_t generation = 0;
+            if (StorageFormat::readHeader(existing.view(), StorageFormat::LogMagic, generation) &&
+                generation == snapshotGeneration) {
+                current = true;
+                validBytes = StorageFormat::HeaderBytes + StorageFormat::scanRecords(
+                    existing.view().substr(StorageFormat::HeaderBytes), [](std::string_view) {});
+            }
+        }
+
+        log.fd = ::open(logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (log.fd < 0) {
+            return nullptr;
+        }
+        log.generation = snapshotGeneration;
+        bool ok = current ? ::ftruncate(log.fd, static_cast<off_t>(validBytes)) == 0
+                          : restartLog(log, snapshotGeneration);
+        if (!ok) {
+            ::close(log.fd);
+            return nullptr;
+        }
+        return &logs_.emplace(std::move(key), log).first->second;
+    }
+
+    bool restartLog(OpenLog& log, uint64_t generation) {
+        if (::ftruncate(log.fd, 0) != 0) {
+            return false;
+        }
+        log.generation = generation;
+        return writeAll(log.fd, StorageFormat::header(StorageFormat::LogMagic, generation)) &&
+               (!options_.sync || ::fdatasync(log.fd) == 0);
+    }
+
+    void syncDirectory() {
+        if (!options_.sync) return;
+        int fd = ::open(options_.directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    static bool writeAll(int fd, std::string_view bytes) {
+        while (!bytes.empty()) {
+            ssize_t n = ::write(fd, bytes.data(), bytes.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            bytes.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    void report(const std::string& what) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Storage: cannot " << what << ": " << std::strerror(errno) << std::endl;
+    }
+
+    // =========================================================================
+    // Decoding
+    // =========================================================================
+
+    static bool readSnapshot(std::string_view bytes, StrokeStore& strokes, uint64_t& generation) {
+        if (!StorageFormat::readHeader(bytes, StorageFormat::SnapshotMagic, generation) ||
+            bytes.size() < StorageFormat::HeaderBytes + sizeof(uint32_t)) {
+            return false;
+        }
+        std::string_view covered = bytes.substr(sizeof(StorageFormat::SnapshotMagic),
+                                                bytes.size() - sizeof(StorageFormat::SnapshotMagic) - sizeof(uint32_t));
+        if (StorageFormat::readU32(bytes.data() + bytes.size() - sizeof(uint32_t)) !=
+            StorageFormat::fnv1a(covered)) {
+            return false;
+        }
+
+        BinaryReader r(covered.substr(StorageFormat::HeaderBytes - sizeof(StorageFormat::SnapshotMagic)));
+        uint64_t count = r.varint();
+        for (uint64_t i = 0; i < count && r.ok(); ++i) {
+            Stroke stroke = StorageFormat::readStroke(r);
+            if (r.ok()) {
+                strokes.push(std::move(stroke));
+            }
+        }
+        return r.ok();
+    }
+
+    static void apply(StrokeStore& strokes, std::string_view body) {
+        BinaryReader r(body);
+        uint8_t op = r.u8();
+        std::string strokeId = r.str();
+
+        if (op == StorageFormat::OpStart) {
+            std::string oderId = r.str();
+            std::string color = r.str();
+            float width = r.f32();
+            if (r.ok()) {
+                strokes.push(Stroke(strokeId, oderId, color, width));
+            }
+            return;
+        }
+
+        auto stroke = strokes.find(strokeId);
+        if (!stroke) {
+            return;  // Evicted since
+        }
+        if (op == StorageFormat::OpAdd) {
+            std::vector<Point> points = r.points(ProtocolConstants::MaxPointsPerStroke);
+            if (r.ok()) stroke->addPoints(points);
+        } else if (op == StorageFormat::OpEnd) {
+            if (r.ok()) stroke->finish();
+        } else if (op == StorageFormat::OpMove) {
+            float dx = r.f32();
+            float dy = r.f32();
+            if (r.ok()) stroke->translate(dx, dy);
+        } else if (op == StorageFormat::OpPoints) {
+            std::vector<Point> points = r.points(ProtocolConstants::MaxPointsPerStroke);
+            if (r.ok()) stroke->replacePoints(std::move(points));
+        }
+    }
+
+    // =========================================================================
+    // Paths
+    // =========================================================================
+
+    /**
+     * @brief File name stem for a room: its ID in hex, so any ID is a safe
+     * name (long IDs are cut short and disambiguated by a hash).
+     */
+    static std::string fileKey(const std::string& roomId) {
+        static constexpr char digits[] = "0123456789abcdef";
+        constexpr size_t maxBytes = 96;
+        std::string_view id = roomId;
+        std::string key;
+        key.reserve(2 * std::min(id.size(), maxBytes) + 9);
+        for (char c : id.substr(0, maxBytes)) {
+            key.push_back(digits[static_cast<uint8_t>(c) >> 4]);
+            key.push_back(digits[static_cast<uint8_t>(c) & 0x0F]);
+        }
+        if (id.size() > maxBytes) {
+            uint32_t hash = StorageFormat::fnv1a(id);
+            key.push_back('-');
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                key.push_back(digits[(hash >> shift) & 0x0F]);
+            }
+        }
+        if (key.empty()) {
+            key = "_";
+        }
+        return key;
+    }
+
+    std::string path(const std::string& key, const char* extension) const {
+        return (std::filesystem::path(options_.directory) / (key + extension)).string();
+    }
+
+    StorageOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<Job> queue_;
+    uint64_t enqueued_ = 0;
+    uint64_t committed_ = 0;
+    std::unordered_map<std::string, size_t> pending_;     // Queued, uncommitted jobs per room
+    bool stopping_ = false;
+    std::unordered_map<std::string, size_t> uncompacted_;  // Records since the last compaction
+
+    // Writer thread only
+    std::unordered_map<std::string, OpenLog> logs_;
+
+    std::atomic<uint64_t> recordsWritten_{0};
+    std::atomic<uint64_t> commits_{0};
+    std::atomic<uint64_t> compactions_{0};
+    std::atomic<uint64_t> errors_{0};
+
+    std::thread writer_;
+};
+
+} // namespace collabboard
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace collabboard {
+
+/**
+ * @brief A stroke or user ID as 128 bits, for use as a map key.
+ *
+ * IDs travel as text (JSON, logs), but inside the server they are only
+ * ever compared and hashed, so the maps key on this instead: 16 bytes
+ * inline rather than a 41-char heap string, compared with two integer
+ * compares and hashed without reading the text again.
+ *
+ * A lowercase canonical UUID (what generateUUID() and the frontend's
+ * crypto.randomUUID() produce) maps to its own bits, losslessly. Any
+ * other text, including "user-<uuid>", maps to a 128-bit hash of it with
+ * the UUID version nibble set to 8, so it can never equal a v4 UUID.
+ * Hashed keys cannot be turned back into text; holders keep the text
+ * alongside where they need to send it, and lookups keyed by
+ * client-chosen text should confirm a hit against that text.
+ */
+struct Id128 {
+    static constexpr size_t UuidLength = 36;
+
+    uint64_t hi = 0;   // UUID bytes 0-7, big-endian
+    uint64_t lo = 0;   // UUID bytes 8-15, big-endian
+
+    /**
+     * @brief Parse a lowercase canonical UUID (8-4-4-4-12).
+     * @return nullopt for anything else; uppercase is rejected so that
+     *         toUuid() gives back exactly the text parsed
+     */
+    static std::optional<Id128> parseUuid(std::string_view text) {
+        if (text.size() != UuidLength ||
+            text[8] != '-' || text[13] != '-' || text[18] != '-' || text[23] != '-') {
+            return std::nullopt;
+        }
+        Id128 id;
+        int nibbles = 0;
+        for (char c : text) {
+            if (c == '-') continue;
+            int digit = hexValue(c);
+            if (digit < 0) return std::nullopt;
+            uint64_t& half = nibbles < 16 ? id.hi : id.lo;
+            half = (half << 4) | static_cast<uint64_t>(digit);
+            ++nibbles;
+        }
+        return id;
+    }
+
+    /**
+     * @brief The key for any ID text.
+     */
+    static Id128 fromText(std::string_view text) {
+        if (auto uuid = parseUuid(text)) {
+            return *uuid;
+        }
+        Id128 id;
+        id.hi = mix(fnv1a(text, 14695981039346656037ull));
+        id.lo = mix(fnv1a(text, 0x84222325cbf29ce4ull) ^ text.size());
+        id.hi = (id.hi & ~VersionMask) | (uint64_t{8} << VersionShift);
+        return id;
+    }
+
+    /**
+     * @brief From 16 raw bytes, as sent on the binary protocol.
+     */
+    static Id128 fromBytes(const char* bytes) {
+        Id128 id;
+        for (int i = 0; i < 8; ++i) {
+            id.hi = (id.hi << 8) | static_cast<uint8_t>(bytes[i]);
+            id.lo = (id.lo << 8) | static_cast<uint8_t>(bytes[8 + i]);
+        }
+        return id;
+    }
+
+    /**
+     * @brief Append the 16 raw bytes, big-endian.
+     */
+    void appendBytes(std::string& out) const {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<char>(hi >> shift));
+        }
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<char>(lo >> shift));
+        }
+    }
+
+    /**
+     * @brief Append lowercase canonical UUID text.
+     */
+    void appendUuid(std::string& out) const {
+        static constexpr char Digits[] = "0123456789abcdef";
+        for (int nibble = 0; nibble < 32; ++nibble) {
+            if (nibble == 8 || nibble == 12 || nibble == 16 || nibble == 20) {
+                out.push_back('-');
+            }
+            uint64_t half = nibble < 16 ? hi : lo;
+            out.push_back(Digits[(half >> (60 - 4 * (nibble % 16))) & 0xF]);
+        }
+    }
+
+    std::string toUuid() const {
+        std::string out;
+        out.reserve(UuidLength);
+        appendUuid(out);
+        return out;
+    }
+
+    bool operator==(const Id128&) const = default;
+
+private:
+    static constexpr int VersionShift = 12;
+    static constexpr uint64_t VersionMask = uint64_t{0xF} << VersionShift;
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    static uint64_t fnv1a(std::string_view text, uint64_t basis) {
+        uint64_t h = basis;
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+/**
+ * @brief Hash for Id128 keys.
+ *
+ * UUID bits are already random, and hashed keys are mixed, so folding
+ * the halves is enough.
+ */
+struct Id128Hash {
+    size_t operator()(const Id128& id) const noexcept {
+        return static_cast<size_t>(id.hi ^ (id.lo * 0x9e3779b97f4a7c15ull));
+    }
+};
+
+} // namespace collabboard
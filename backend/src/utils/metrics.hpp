@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <charconv>
+
+#include "../protocol/message_types.hpp"
+
+namespace collabboard {
+
+// =============================================================================
+// Primitives
+// =============================================================================
+
+/**
+ * @brief Number of cells each counter and histogram is split into.
+ *
+ * Every thread writes to the cell picked for it on first use, so threads
+ * on different cells never share a cache line; reads sum all cells.
+ */
+inline constexpr size_t MetricStripes = 8;
+
+inline size_t metricStripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % MetricStripes;
+    return stripe;
+}
+
+/**
+ * @brief Nanoseconds on the steady clock, for latency measurements.
+ */
+inline int64_t metricNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Monotonic counter; add() is one relaxed atomic add on this thread's cell.
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1) {
+        cells_[metricStripe()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& cell : cells_) {
+            total += cell.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Cell, MetricStripes> cells_;
+};
+
+/**
+ * @brief Value that goes up and down (connected sessions).
+ */
+class Gauge {
+public:
+    void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+/**
+ * @brief Log-linear histogram of non-negative integer samples, HDR style.
+ *
+ * Each power of two is split into SubBuckets equal slices, so a sample
+ * lands in a bucket no wider than 1/SubBuckets of its value (25%) over
+ * the full uint64_t range, with no configuration. record() is a count
+ * leading zeros and two relaxed adds on this thread's cell.
+ */
+class Histogram {
+public:
+    static constexpr int SubBits = 2;
+    static constexpr size_t SubBuckets = size_t{1} << SubBits;
+    static constexpr size_t Buckets = (64 - SubBits + 1) * SubBuckets;
+
+    /**
+     * @brief Bucket holding value: values below SubBuckets map to themselves,
+     * then SubBuckets buckets per power of two.
+     */
+    static constexpr size_t bucketOf(uint64_t value) {
+        if (value < SubBuckets) return static_cast<size_t>(value);
+        int exponent = 63 - std::countl_zero(value);
+        size_t sub = static_cast<size_t>(value >> (exponent - SubBits)) & (SubBuckets - 1);
+        return static_cast<size_t>(exponent - SubBits + 1) * SubBuckets + sub;
+    }
+
+    /**
+     * @brief Smallest value in a bucket.
+     */
+    static constexpr uint64_t bucketLowerBound(size_t bucket) {
+        if (bucket < SubBuckets) return bucket;
+        int exponent = static_cast<int>(bucket / SubBuckets) + SubBits - 1;
+        uint64_t sub = bucket % SubBuckets;
+        return (uint64_t{1} << exponent) + (sub << (exponent - SubBits));
+    }
+
+    /**
+     * @brief Merged counts of all cells at one point in time.
+     */
+    struct Snapshot {
+        std::array<uint64_t, Buckets> counts{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        /**
+         * @brief Samples below value (exact when value is a bucket boundary).
+         */
+        uint64_t countBelow(uint64_t value) const {
+            uint64_t total = 0;
+            for (size_t i = 0; i < Buckets && bucketLowerBound(i) < value; ++i) {
+                total += counts[i];
+            }
+            return total;
+        }
+
+        /**
+         * @brief Lower bound of the bucket holding the q-th quantile (0..1).
+         */
+        uint64_t quantile(double q) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < Buckets; ++i) {
+                seen += counts[i];
+                if (seen > rank) return bucketLowerBound(i);
+            }
+            return bucketLowerBound(Buckets - 1);
+        }
+    };
+
+    void record(uint64_t value) {
+        Cell& cell = cells_[metricStripe()];
+        cell.counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        cell.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record the time since startNs (from metricNowNs()).
+     */
+    void recordSince(int64_t startNs) {
+        int64_t elapsed = metricNowNs() - startNs;
+        record(elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot result;
+        for (const auto& cell : cells_) {
+            for (size_t i = 0; i < Buckets; ++i) {
+                uint64_t n = cell.counts[i].load(std::memory_order_relaxed);
+                result.counts[i] += n;
+                result.count += n;
+            }
+            result.sum += cell.sum.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::array<std::atomic<uint64_t>, Buckets> counts{};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::array<Cell, MetricStripes> cells_;
+};
+
+// =============================================================================
+// Prometheus Text Format
+// =============================================================================
+
+/**
+ * @brief Appends metrics in the Prometheus text exposition format.
+ */
+class PrometheusWriter {
+public:
+    void counter(std::string_view name, std::string_view help, uint64_t value,
+                 std::string_view labels = {}) {
+        family(name, help, "counter");
+        sample(name, "", labels, static_cast<double>(value));
+    }
+
+    void gauge(std::string_view name, std::string_view help, double value,
+               std::string_view labels = {}) {
+        family(name, help, "gauge");
+        sample(name, "", labels, value);
+    }
+
+    /**
+     * @brief Write a histogram with a bucket per power of two from
+     * minValue to maxValue (in recorded units), each multiplied by scale
+     * (e.g. 1e-9 to report nanoseconds as seconds).
+     */
+    void histogram(std::string_view name, std::string_view help,
+                   const Histogram::Snapshot& snapshot,
+                   uint64_t minValue, uint64_t maxValue, double scale = 1.0,
+                   std::string_view labels = {}) {
+        family(name, help, "histogram");
+        std::string bucketLabels;
+        for (uint64_t bound = std::bit_ceil(std::max<uint64_t>(minValue, 1));
+             bound <= maxValue && bound != 0; bound <<= 1) {
+            bucketLabels.assign(labels);
+            if (!bucketLabels.empty()) bucketLabels += ',';
+            bucketLabels += "le=\"";
+            appendNumber(bucketLabels, static_cast<double>(bound) * scale);
+            bucketLabels += '"';
+            sample(name, "_bucket", bucketLabels, static_cast<double>(snapshot.countBelow(bound)));
+        }
+        bucketLabels.assign(labels);
+        if (!bucketLabels.empty()) bucketLabels += ',';
+        bucketLabels += "le=\"+Inf\"";
+        sample(name, "_bucket", bucketLabels, static_cast<double>(snapshot.count));
+        sample(name, "_sum", labels, static_cast<double>(snapshot.sum) * scale);
+        sample(name, "_count", labels, static_cast<double>(snapshot.count));
+    }
+
+    const std::string& view() const { return out_; }
+    std::string str() const { return out_; }
+
+private:
+    // HELP and TYPE once per family, so labelled series can share a name
+    void family(std::string_view name, std::string_view help, std::string_view type) {
+        if (name == lastFamily_) return;
+        lastFamily_.assign(name);
+        out_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+        out_.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    }
+
+    void sample(std::string_view name, std::string_view suffix,
+                std::string_view labels, double value) {
+        out_.append(name).append(suffix);
+        if (!labels.empty()) {
+            out_.append("{").append(labels).append("}");
+        }
+        out_.push_back(' ');
+        appendNumber(out_, value);
+        out_.push_back('\n');
+    }
+
+    static void appendNumber(std::string& out, double value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    std::string out_;
+    std::string lastFamily_;
+};
+
+// =============================================================================
+// Server Metrics
+// =============================================================================
+
+/**
+ * @brief Process-wide hot-path metrics, exported at /metrics.
+ *
+ * Everything here is written with relaxed atomics on per-thread cells, so
+ * instrumented paths pay a clock read and a couple of uncontended adds.
+ */
+struct ServerMetrics {
+    static constexpr size_t MessageTypes = static_cast<size_t>(MessageType::Unknown) + 1;
+
+    // Receipt of a client message to the end of its handling, by type;
+    // room-scoped messages include the wait for the room's executor
+    std::array<Histogram, MessageTypes> handleNs;
+
+    Histogram fanoutNs;            // One broadcast to a room
+    Histogram fanoutRecipients;    // Sessions reached by one broadcast
+    Histogram snapshotBuildNs;     // Building a room_state (or its chunks)
+    Histogram snapshotBytes;       // JSON bytes of a built snapshot
+    Histogram snapshotDeliveryNs;  // Join admitted to its snapshot handed to the session
+    Histogram writeQueueBytes;     // Session queue depth at each socket write
+
+    Counter framesDropped;         // Loss-tolerant frames shed under backpressure
+    Counter framesConflated;       // Frames replaced by a newer one while queued
+    Counter slowConsumerDisconnects;
+    Counter ingressRejected;       // Messages over a session's ingress budget
+    Counter cursorRateLimited;     // Cursor moves over the participant's rate
+    Counter sessionsShed;          // Sessions disconnected for flooding
+    Counter heartbeatTimeouts;     // Sessions dropped for going silent
+    Counter roomsHibernated;       // Idle rooms that released their caches
+    std::array<Counter, 3> sessionErrors;  // By SessionOp
+
+    Gauge sessions;                // Open WebSocket sessions
+
+    enum class SessionOp : size_t { Accept, Read, Write };
+
+    Histogram& handle(MessageType type) {
+        return handleNs[static_cast<size_t>(type)];
+    }
+
+    Counter& sessionError(SessionOp op) {
+        return sessionErrors[static_cast<size_t>(op)];
+    }
+
+    static ServerMetrics& global() {
+        static ServerMetrics metrics;
+        return metrics;
+    }
+
+    /**
+     * @brief Append every metric to a Prometheus writer.
+     */
+    void write(PrometheusWriter& out) const {
+        constexpr uint64_t MinNs = 1'000;              // 1 us
+        constexpr uint64_t MaxNs = 10'000'000'000;     // ~8.6 s top bucket
+        constexpr double Seconds = 1e-9;
+
+        for (size_t i = 0; i < MessageTypes; ++i) {
+            Histogram::Snapshot snapshot = handleNs[i].snapshot();
+            if (snapshot.count == 0) continue;
+            // Malformed and unknown-type messages land in the Unknown
+            // slot, which has no wire name
+            auto type = static_cast<MessageType>(i);
+            std::string labels = "type=\"";
+            labels.append(type == MessageType::Unknown ? std::string_view("unknown")
+                                                       : messageTypeToString(type));
+            labels += '"';
+            out.histogram("collabboard_message_handle_seconds",
+                          "Time from receiving a client message to finishing it",
+                          snapshot, MinNs, MaxNs, Seconds, labels);
+        }
+
+        out.histogram("collabboard_broadcast_fanout_seconds",
+                      "Time to hand one broadcast to every recipient",
+                      fanoutNs.snapshot(), MinNs, MaxNs, Seconds);
+        out.histogram("collabboard_broadcast_recipients",
+                      "Sessions reached by one broadcast",
+                      fanoutRecipients.snapshot(), 1, 1 << 12);
+        out.histogram("collabboard_snapshot_build_seconds",
+                      "Time to build a room_state snapshot",
+                      snapshotBuildNs.snapshot(), MinNs, MaxNs, Seconds);
+        out.histogram("collabboard_snapshot_bytes",
+                      "JSON size of a built room_state snapshot",
+                      snapshotBytes.snapshot(), 1 << 8, 1 << 26);
+        out.histogram("collabboard_snapshot_delivery_seconds",
+                      "Time from a join being admitted to its snapshot being sent",
+                      snapshotDeliveryNs.snapshot(), MinNs, MaxNs, Seconds);
+        out.histogram("collabboard_write_queue_bytes",
+                      "Session outbound queue depth at each socket write",
+                      writeQueueBytes.snapshot(), 1 << 8, 1 << 24);
+
+        out.counter("collabboard_frames_dropped_total",
+                    "Loss-tolerant frames dropped under backpressure", framesDropped.value());
+        out.counter("collabboard_frames_conflated_total",
+                    "Queued frames replaced by a newer one", framesConflated.value());
+        out.counter("collabboard_slow_consumer_disconnects_total",
+                    "Sessions disconnected for not draining their queue",
+                    slowConsumerDisconnects.value());
+        out.counter("collabboard_rate_limited_total", "Messages rejected by a rate limit",
+                    ingressRejected.value(), R"(limit="ingress")");
+        out.counter("collabboard_rate_limited_total", "Messages rejected by a rate limit",
+                    cursorRateLimited.value(), R"(limit="cursor")");
+        out.counter("collabboard_sessions_shed_total",
+                    "Sessions disconnected for flooding", sessionsShed.value());
+        out.counter("collabboard_heartbeat_timeouts_total",
+                    "Sessions dropped for missing their heartbeat", heartbeatTimeouts.value());
+        out.counter("collabboard_rooms_hibernated_total",
+                    "Idle rooms that released their snapshot caches", roomsHibernated.value());
+        static constexpr std::array<std::string_view, 3> Ops = {
+            R"(op="accept")", R"(op="read")", R"(op="write")"
+        };
+        for (size_t i = 0; i < Ops.size(); ++i) {
+            out.counter("collabboard_session_errors_total",
+                        "WebSocket operations that failed", sessionErrors[i].value(), Ops[i]);
+        }
+        out.gauge("collabboard_sessions", "Open WebSocket sessions",
+                  static_cast<double>(sessions.value()));
+    }
+};
+
+} // namespace collabboard
@@ -6,24 +6,13 @@
 #include <chrono>
 #include <mutex>
 #include <optional>
+#include <array>
+#include <functional>
 
-namespace collabboard {
-
-/**
- * @brief Token bucket for rate limiting.
- * 
- * Each bucket tracks available tokens and refills over time.
- * Tokens are consumed when actions are performed.
- */
-struct TokenBucket {
-    double tokens;
-    std::chrono::steady_clock::time_point lastRefill;
+#include "token_bucket.hpp"
+#include "id128.hpp"
 
-    TokenBucket(double initialTokens = 0.0)
-        : tokens(initialTokens)
-        , lastRefill(std::chrono::steady_clock::now())
-    {}
-};
+namespace collabboard {
 
 /**
  * @brief Token bucket rate limiter for controlling message frequency.
@@ -34,7 +23,14 @@ struct TokenBucket {
  * - If no tokens available, the action is rate limited
  * - Bucket has a maximum capacity (burst size)
  * 
- * Thread-safe: All operations are protected by mutex.
+ * Thread-safe: buckets are split across shards by a hash of the user ID,
+ * each with its own mutex, so users rarely contend. Buckets are fixed
+ * point (see TokenBucket) and read CoarseClock, so a check is a hash, a
+ * shard lock and a few integer ops.
+ *
+ * Keyed by user ID (held as its Id128) for callers without per-user
+ * state to hang a bucket on; cursor moves use the TokenBucket kept with
+ * each room participant.
  * 
  * Example usage:
  *   RateLimiter limiter(20.0, 5.0);  // 20 tokens/sec, burst of 5
@@ -55,6 +51,7 @@ public:
     explicit RateLimiter(double tokensPerSecond = 20.0, double maxTokens = 5.0)
         : tokensPerSecond_(tokensPerSecond)
         , maxTokens_(maxTokens)
+        , rate_(tokensPerSecond, maxTokens)
     {}
 
     /**
@@ -64,21 +61,13 @@ public:
      * @return false if rate limited (no tokens available)
      */
     bool tryConsume(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        auto& bucket = getOrCreateBucket(userId);
-
-        // Refill tokens based on elapsed time
-        refillBucket(bucket, now);
-
-        // Try to consume a token
-        if (bucket.tokens >= 1.0) {
-            bucket.tokens -= 1.0;
-            return true;
-        }
+        return tryConsume(Id128::fromText(userId));
+    }
 
-        return false;
+    bool tryConsume(const Id128& key) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.buckets[key].tryConsume(rate_, CoarseClock::nowNs());
     }
 
     /**
@@ -89,19 +78,10 @@ public:
      * @return false if rate limited (not enough tokens)
      */
     bool tryConsume(const std::string& userId, double count) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        auto& bucket = getOrCreateBucket(userId);
-
-        refillBucket(bucket, now);
-
-        if (bucket.tokens >= count) {
-            bucket.tokens -= count;
-            return true;
-        }
-
-        return false;
+        Id128 key = Id128::fromText(userId);
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.buckets[key].tryConsume(rate_, rate_.costNs(count), CoarseClock::nowNs());
     }
 
     /**
@@ -111,14 +91,14 @@ public:
      * @return false if rate limited
      */
     bool canConsume(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        auto& bucket = getOrCreateBucket(userId);
-
-        refillBucket(bucket, now);
-
-        return bucket.tokens >= 1.0;
+        Id128 key = Id128::fromText(userId);
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.buckets.find(key);
+        if (it == shard.buckets.end()) {
+            return true;  // A new bucket starts full
+        }
+        return it->second.creditNs(rate_, CoarseClock::nowNs()) >= rate_.intervalNs;
     }
 
     /**
@@ -127,17 +107,15 @@ public:
      * @return Current token count, or nullopt if user has no bucket
      */
     std::optional<double> getTokens(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto it = buckets_.find(userId);
-        if (it == buckets_.end()) {
+        Id128 key = Id128::fromText(userId);
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.buckets.find(key);
+        if (it == shard.buckets.end()) {
             return std::nullopt;
         }
-
-        auto now = std::chrono::steady_clock::now();
-        refillBucket(it->second, now);
-
-        return it->second.tokens;
+        return static_cast<double>(it->second.creditNs(rate_, CoarseClock::nowNs())) /
+               static_cast<double>(rate_.intervalNs);
     }
 
     /**
@@ -146,21 +124,15 @@ public:
      * @return Milliseconds until next token, 0 if tokens available
      */
     int64_t getWaitTimeMs(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        auto& bucket = getOrCreateBucket(userId);
-
-        refillBucket(bucket, now);
-
-        if (bucket.tokens >= 1.0) {
+        Id128 key = Id128::fromText(userId);
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.buckets.find(key);
+        if (it == shard.buckets.end()) {
             return 0;
         }
-
-        // Calculate time to get one token
-        double tokensNeeded = 1.0 - bucket.tokens;
-        double secondsToWait = tokensNeeded / tokensPerSecond_;
-        return static_cast<int64_t>(secondsToWait * 1000.0);
+        int64_t missingNs = rate_.intervalNs - it->second.creditNs(rate_, CoarseClock::nowNs());
+        return missingNs > 0 ? missingNs / 1'000'000 : 0;
     }
 
     /**
@@ -170,12 +142,12 @@ public:
      * Useful after a mute period ends or for testing.
      */
     void reset(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto it = buckets_.find(userId);
-        if (it != buckets_.end()) {
-            it->second.tokens = maxTokens_;
-            it->second.lastRefill = std::chrono::steady_clock::now();
+        Id128 key = Id128::fromText(userId);
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.buckets.find(key);
+        if (it != shard.buckets.end()) {
+            it->second.refill(CoarseClock::nowNs());
         }
     }
 
@@ -186,8 +158,13 @@ public:
      * Call when user disconnects to free memory.
      */
     void remove(const std::string& userId) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        buckets_.erase(userId);
+        remove(Id128::fromText(userId));
+    }
+
+    void remove(const Id128& key) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.buckets.erase(key);
     }
 
     /**
@@ -198,21 +175,14 @@ public:
      * Call periodically to prevent memory growth from inactive users.
      */
     size_t cleanup(int maxAgeSeconds = 300) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        auto now = std::chrono::steady_clock::now();
-        auto maxAge = std::chrono::seconds(maxAgeSeconds);
+        int64_t cutoff = CoarseClock::nowNs() - static_cast<int64_t>(maxAgeSeconds) * 1'000'000'000;
         size_t removed = 0;
-
-        for (auto it = buckets_.begin(); it != buckets_.end(); ) {
-            if (now - it->second.lastRefill > maxAge) {
-                it = buckets_.erase(it);
-                ++removed;
-            } else {
-                ++it;
-            }
+        for (Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            removed += std::erase_if(shard.buckets, [cutoff](const auto& entry) {
+                return entry.second.lastUsedNs < cutoff;
+            });
         }
-
         return removed;
     }
 
@@ -221,60 +191,45 @@ public:
      * @return Number of active buckets
      */
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return buckets_.size();
+        size_t total = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.buckets.size();
+        }
+        return total;
     }
 
     /**
      * @brief Clear all buckets.
      */
     void clear() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        buckets_.clear();
+        for (Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.buckets.clear();
+        }
     }
 
     // Getters for configuration
     double getTokensPerSecond() const { return tokensPerSecond_; }
     double getMaxTokens() const { return maxTokens_; }
+    const TokenRate& getRate() const { return rate_; }
 
 private:
-    /**
-     * @brief Get or create a bucket for the user.
-     * @param userId The user identifier
-     * @return Reference to the user's bucket
-     * 
-     * Note: Must be called with mutex held.
-     */
-    TokenBucket& getOrCreateBucket(const std::string& userId) {
-        auto it = buckets_.find(userId);
-        if (it == buckets_.end()) {
-            // Create new bucket with max tokens (allows initial burst)
-            auto [newIt, _] = buckets_.emplace(userId, TokenBucket(maxTokens_));
-            return newIt->second;
-        }
-        return it->second;
-    }
+    static constexpr size_t ShardCount = 16;
 
-    /**
-     * @brief Refill tokens based on elapsed time.
-     * @param bucket The bucket to refill
-     * @param now Current time point
-     * 
-     * Note: Must be called with mutex held.
-     */
-    void refillBucket(TokenBucket& bucket, 
-                      std::chrono::steady_clock::time_point now) {
-        auto elapsed = std::chrono::duration<double>(now - bucket.lastRefill);
-        double tokensToAdd = elapsed.count() * tokensPerSecond_;
+    struct Shard {
+        std::unordered_map<Id128, TokenBucket, Id128Hash> buckets;
+        mutable std::mutex mutex;
+    };
 
-        bucket.tokens = std::min(bucket.tokens + tokensToAdd, maxTokens_);
-        bucket.lastRefill = now;
+    Shard& shardFor(const Id128& key) {
+        return shards_[Id128Hash{}(key) % ShardCount];
     }
 
     double tokensPerSecond_;
     double maxTokens_;
-    std::unordered_map<std::string, TokenBucket> buckets_;
-    mutable std::mutex mutex_;
+    TokenRate rate_;
+    std::array<Shard, ShardCount> shards_;
 };
 
 /**
@@ -324,10 +279,11 @@ public:
      * @return false if rate limited or muted
      */
     bool tryConsume(const std::string& userId) {
+        Id128 key = Id128::fromText(userId);
         std::lock_guard<std::mutex> lock(mutex_);
 
         // Check if user is muted
-        auto muteIt = mutedUntil_.find(userId);
+        auto muteIt = mutedUntil_.find(key);
         if (muteIt != mutedUntil_.end()) {
             auto now = std::chrono::steady_clock::now();
             if (now < muteIt->second) {
@@ -335,23 +291,23 @@ public:
             }
             // Mute expired, remove it
             mutedUntil_.erase(muteIt);
-            violations_.erase(userId);
+            violations_.erase(key);
         }
 
         // Try normal rate limiting
-        if (limiter_.tryConsume(userId)) {
+        if (limiter_.tryConsume(key)) {
             return true;
         }
 
         // Rate limited - track violation
-        int& count = violations_[userId];
+        int& count = violations_[key];
         ++count;
 
         if (count >= violationsBeforeMute_) {
             // Mute the user
             auto muteUntil = std::chrono::steady_clock::now() + 
                              std::chrono::milliseconds(muteDurationMs_);
-            mutedUntil_[userId] = muteUntil;
+            mutedUntil_[key] = muteUntil;
         }
 
         return false;
@@ -363,9 +319,10 @@ public:
      * @return true if muted, false otherwise
      */
     bool isMuted(const std::string& userId) {
+        Id128 key = Id128::fromText(userId);
         std::lock_guard<std::mutex> lock(mutex_);
 
-        auto it = mutedUntil_.find(userId);
+        auto it = mutedUntil_.find(key);
         if (it == mutedUntil_.end()) {
             return false;
         }
@@ -374,7 +331,7 @@ public:
         if (now >= it->second) {
             // Mute expired
             mutedUntil_.erase(it);
-            violations_.erase(userId);
+            violations_.erase(key);
             return false;
         }
 
@@ -387,9 +344,10 @@ public:
      * @return Milliseconds remaining, 0 if not muted
      */
     int64_t getMuteTimeRemainingMs(const std::string& userId) {
+        Id128 key = Id128::fromText(userId);
         std::lock_guard<std::mutex> lock(mutex_);
 
-        auto it = mutedUntil_.find(userId);
+        auto it = mutedUntil_.find(key);
         if (it == mutedUntil_.end()) {
             return 0;
         }
@@ -411,10 +369,11 @@ public:
      * @param userId The user identifier
      */
     void remove(const std::string& userId) {
+        Id128 key = Id128::fromText(userId);
         std::lock_guard<std::mutex> lock(mutex_);
-        limiter_.remove(userId);
-        violations_.erase(userId);
-        mutedUntil_.erase(userId);
+        limiter_.remove(key);
+        violations_.erase(key);
+        mutedUntil_.erase(key);
     }
 
     /**
@@ -431,8 +390,8 @@ private:
     RateLimiter limiter_;
     int64_t muteDurationMs_;
     int violationsBeforeMute_;
-    std::unordered_map<std::string, int> violations_;
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> mutedUntil_;
+    std::unordered_map<Id128, int, Id128Hash> violations_;
+    std::unordered_map<Id128, std::chrono::steady_clock::time_point, Id128Hash> mutedUntil_;
     std::mutex mutex_;
 };
 
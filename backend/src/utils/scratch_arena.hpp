@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+namespace collabboard {
+
+/**
+ * @brief Per-thread bump allocator for temporaries that die with one
+ *        message (decode, validate, encode).
+ *
+ * A Scope hands out a monotonic_buffer_resource over a fixed thread-local
+ * block; allocations are a pointer bump and frees are no-ops. When the
+ * outermost Scope on the thread closes, the whole arena is rewound, so
+ * nested Scopes share it safely. Past the block, the resource falls back
+ * to new/delete until the rewind.
+ *
+ * Memory from a Scope must not outlive it or leave the thread: use it
+ * for std::pmr containers local to one call, never for anything stored
+ * or posted to another executor.
+ */
+class ScratchArena {
+public:
+    static constexpr size_t BlockBytes = 64 * 1024;
+
+    class Scope {
+    public:
+        Scope() : arena_(local()) { ++arena_.depth_; }
+        ~Scope() {
+            if (--arena_.depth_ == 0) {
+                arena_.resource_.release();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* resource() { return &arena_.resource_; }
+
+    private:
+        ScratchArena& arena_;
+    };
+
+private:
+    ScratchArena()
+        : resource_(block_.data(), block_.size(), std::pmr::new_delete_resource())
+    {}
+
+    static ScratchArena& local() {
+        thread_local ScratchArena arena;
+        return arena;
+    }
+
+    alignas(std::max_align_t) std::array<std::byte, BlockBytes> block_;
+    std::pmr::monotonic_buffer_resource resource_;
+    int depth_ = 0;
+};
+
+} // namespace collabboard
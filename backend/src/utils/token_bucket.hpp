@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#include <time.h>
+
+namespace collabboard {
+
+/**
+ * @brief Cheap monotonic clock for rate limiting.
+ *
+ * On Linux this reads CLOCK_MONOTONIC_COARSE, a vDSO read of the last
+ * timer tick (a few ms resolution) without touching the hardware clock.
+ * Elsewhere it falls back to steady_clock.
+ */
+struct CoarseClock {
+    static int64_t nowNs() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+/**
+ * @brief Refill rate and burst size of a token bucket, in fixed point.
+ *
+ * Tokens are measured in nanoseconds of credit: one token is intervalNs,
+ * so refilling needs no multiply or divide, just the clock.
+ */
+struct TokenRate {
+    int64_t intervalNs;   // Time to earn one token
+    int64_t burstNs;      // Bucket capacity (maxTokens * intervalNs)
+
+    TokenRate(double tokensPerSecond, double maxTokens)
+        : intervalNs(static_cast<int64_t>(1e9 / std::max(tokensPerSecond, 1e-9)))
+        , burstNs(static_cast<int64_t>(maxTokens * static_cast<double>(intervalNs)))
+    {}
+
+    int64_t costNs(double tokens) const {
+        return static_cast<int64_t>(tokens * static_cast<double>(intervalNs));
+    }
+};
+
+/**
+ * @brief Token bucket kept as a single timestamp.
+ *
+ * readyNs is when the bucket will be full again (the GCRA "theoretical
+ * arrival time"): the credit held now is burst - (readyNs - now), and
+ * consuming pushes readyNs later by the cost. A new bucket starts full.
+ *
+ * Not thread-safe; the owner serializes access (Room's mutex for cursor
+ * buckets, a shard lock in RateLimiter).
+ */
+struct TokenBucket {
+    int64_t readyNs = 0;
+    int64_t lastUsedNs = 0;
+
+    /**
+     * @brief Take costNs of credit if the bucket holds that much.
+     */
+    bool tryConsume(const TokenRate& rate, int64_t costNs, int64_t nowNs) {
+        lastUsedNs = nowNs;
+        int64_t ready = std::max(readyNs, nowNs);
+        if (ready + costNs - nowNs > rate.burstNs) {
+            return false;
+        }
+        readyNs = ready + costNs;
+        return true;
+    }
+
+    bool tryConsume(const TokenRate& rate, int64_t nowNs) {
+        return tryConsume(rate, rate.intervalNs, nowNs);
+    }
+
+    /**
+     * @brief Credit currently held, in nanoseconds (0..burstNs).
+     */
+    int64_t creditNs(const TokenRate& rate, int64_t nowNs) const {
+        return rate.burstNs - std::max<int64_t>(readyNs - nowNs, 0);
+    }
+
+    void refill(int64_t nowNs) {
+        readyNs = nowNs;
+        lastUsedNs = nowNs;
+    }
+};
+
+} // namespace collabboard
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <iomanip>
 #include <array>
+#include <cstdint>
 
 
 namespace collabboard {
@@ -122,6 +123,28 @@ inline std::string generateShortId() {
     thread_local UUIDGenerator generator;
     return generator.generateShort();
 }
+
+/**
+ * @brief Generate an unguessable 128-bit token as 32 hex characters.
+ * @return Token drawn straight from std::random_device
+ *
+ * For secrets (resume tokens). The IDs above come from a seeded
+ * mt19937, whose output can be predicted from enough samples.
+ */
+inline std::string generateSecretToken() {
+    static constexpr char Digits[] = "0123456789abcdef";
+    std::random_device device;
+    std::string token;
+    token.reserve(32);
+    for (int word = 0; word < 4; ++word) {
+        uint32_t bits = device();
+        for (int nibble = 0; nibble < 8; ++nibble) {
+            token.push_back(Digits[(bits >> (28 - 4 * nibble)) & 0xF]);
+        }
+    }
+    return token;
+}
+
 /**
  * @brief Validate if a string is a valid UUID v4 format.
  * @param uuid The string to validate
@@ -6,6 +6,9 @@
  * - message_types.hpp: Enum conversions, error codes, constants
  * - uuid.hpp: UUID generation, validation, uniqueness
  * - rate_limiter.hpp: Token consumption, rate limiting, muting
+ * - metrics.hpp: Striped counters, log-linear histograms, Prometheus text
+ * - scratch_arena.hpp: Per-thread bump allocation for message temporaries
+ * - id128.hpp: Binary ID keys, UUID round trips, hashed non-UUID text
  * 
  * Build and run:
  *   cd backend/build
@@ -24,6 +27,9 @@
 #include "../src/protocol/message_types.hpp"
 #include "../src/utils/uuid.hpp"
 #include "../src/utils/rate_limiter.hpp"
+#include "../src/utils/metrics.hpp"
+#include "../src/utils/scratch_arena.hpp"
+#include "../src/utils/id128.hpp"
 
 using namespace collabboard;
 
@@ -44,6 +50,7 @@ TEST_F(MessageTypesTest, MessageTypeToString) {
     EXPECT_EQ(messageTypeToString(MessageType::UserJoined), "user_joined");
     EXPECT_EQ(messageTypeToString(MessageType::UserLeft), "user_left");
     EXPECT_EQ(messageTypeToString(MessageType::CursorMove), "cursor_move");
+    EXPECT_EQ(messageTypeToString(MessageType::CursorBatch), "cursor_batch");
     EXPECT_EQ(messageTypeToString(MessageType::StrokeStart), "stroke_start");
     EXPECT_EQ(messageTypeToString(MessageType::StrokeAdd), "stroke_add");
     EXPECT_EQ(messageTypeToString(MessageType::StrokeEnd), "stroke_end");
@@ -51,6 +58,7 @@ TEST_F(MessageTypesTest, MessageTypeToString) {
     EXPECT_EQ(messageTypeToString(MessageType::Ping), "ping");
     EXPECT_EQ(messageTypeToString(MessageType::Pong), "pong");
     EXPECT_EQ(messageTypeToString(MessageType::Error), "error");
+    EXPECT_EQ(messageTypeToString(MessageType::Batch), "batch");
 }
 
 // Test: Unknown message type throws exception
@@ -65,6 +73,7 @@ TEST_F(MessageTypesTest, StringToMessageType) {
     EXPECT_EQ(stringToMessageType("user_joined"), MessageType::UserJoined);
     EXPECT_EQ(stringToMessageType("user_left"), MessageType::UserLeft);
     EXPECT_EQ(stringToMessageType("cursor_move"), MessageType::CursorMove);
+    EXPECT_EQ(stringToMessageType("cursor_batch"), MessageType::CursorBatch);
     EXPECT_EQ(stringToMessageType("stroke_start"), MessageType::StrokeStart);
     EXPECT_EQ(stringToMessageType("stroke_add"), MessageType::StrokeAdd);
     EXPECT_EQ(stringToMessageType("stroke_end"), MessageType::StrokeEnd);
@@ -72,6 +81,7 @@ TEST_F(MessageTypesTest, StringToMessageType) {
     EXPECT_EQ(stringToMessageType("ping"), MessageType::Ping);
     EXPECT_EQ(stringToMessageType("pong"), MessageType::Pong);
     EXPECT_EQ(stringToMessageType("error"), MessageType::Error);
+    EXPECT_EQ(stringToMessageType("batch"), MessageType::Batch);
 }
 
 // Test: Unknown string returns Unknown type
@@ -115,7 +125,7 @@ TEST_F(MessageTypesTest, ErrorCodeToMessage) {
 // Test: Protocol constants are reasonable
 TEST_F(MessageTypesTest, ProtocolConstants) {
     EXPECT_EQ(ProtocolConstants::MaxUsersPerRoom, 15);
-    EXPECT_EQ(ProtocolConstants::MaxStrokesPerRoom, 1000);
+    EXPECT_EQ(ProtocolConstants::MaxStrokesPerRoom, 10000);
     EXPECT_EQ(ProtocolConstants::MaxMessageSize, 64 * 1024);
     EXPECT_GT(ProtocolConstants::HeartbeatTimeoutMs, ProtocolConstants::HeartbeatIntervalMs);
     EXPECT_EQ(ProtocolConstants::CursorUpdatesPerSecond, 20.0);
@@ -460,6 +470,24 @@ TEST_F(RateLimiterTest, ThreadSafety) {
     EXPECT_GE(successCount, 100);
 }
 
+// Test: Fixed-point bucket refills from the clock it is given
+TEST_F(RateLimiterTest, FixedPointBucket) {
+    TokenRate rate(10.0, 2.0);  // One token per 100ms
+    EXPECT_EQ(rate.intervalNs, 100'000'000);
+    EXPECT_EQ(rate.burstNs, 200'000'000);
+
+    TokenBucket bucket;
+    int64_t t0 = 5'000'000'000;
+    EXPECT_TRUE(bucket.tryConsume(rate, t0));
+    EXPECT_TRUE(bucket.tryConsume(rate, t0));
+    EXPECT_FALSE(bucket.tryConsume(rate, t0));
+    EXPECT_FALSE(bucket.tryConsume(rate, t0 + 99'000'000));
+    EXPECT_TRUE(bucket.tryConsume(rate, t0 + 100'000'000));
+
+    // Idle time never banks more than the burst
+    EXPECT_EQ(bucket.creditNs(rate, t0 + 10'000'000'000), rate.burstNs);
+}
+
 // =============================================================================
 // MUTING RATE LIMITER TESTS
 // =============================================================================
@@ -550,6 +578,179 @@ TEST_F(MutingRateLimiterTest, RemoveClearsMute) {
     EXPECT_TRUE(limiter.tryConsume(userId));
 }
 
+// =============================================================================
+// METRICS TESTS
+// =============================================================================
+
+class MetricsTest : public ::testing::Test {};
+
+// Test: Buckets tile the value range, each within 25% of its values
+TEST_F(MetricsTest, HistogramBucketsAreLogLinear) {
+    for (uint64_t v : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 1000ull, 123456789ull,
+                       (1ull << 40) + 12345, ~0ull}) {
+        size_t bucket = Histogram::bucketOf(v);
+        ASSERT_LT(bucket, Histogram::Buckets);
+        EXPECT_LE(Histogram::bucketLowerBound(bucket), v);
+        if (bucket + 1 < Histogram::Buckets) {
+            EXPECT_GT(Histogram::bucketLowerBound(bucket + 1), v);
+        }
+        EXPECT_GE(static_cast<double>(Histogram::bucketLowerBound(bucket)),
+                  static_cast<double>(v) * 0.75);
+    }
+    // Powers of two start a bucket, so they are exact Prometheus bounds
+    EXPECT_EQ(Histogram::bucketLowerBound(Histogram::bucketOf(1024)), 1024u);
+}
+
+// Test: Quantiles land in the right bucket
+TEST_F(MetricsTest, HistogramQuantiles) {
+    Histogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        histogram.record(v * 1000);
+    }
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u * 1000u);
+
+    uint64_t p50 = snapshot.quantile(0.5);
+    uint64_t p99 = snapshot.quantile(0.99);
+    EXPECT_LE(p50, 500'000u);
+    EXPECT_GE(p50, 375'000u);
+    EXPECT_LE(p99, 990'000u);
+    EXPECT_GE(p99, 742'000u);
+    EXPECT_EQ(snapshot.countBelow(1 << 20), 1000u);
+    EXPECT_EQ(snapshot.countBelow(1 << 10), 1u);  // Only 1000
+    EXPECT_EQ(snapshot.countBelow(1 << 9), 0u);
+}
+
+// Test: Counts from several threads all arrive
+TEST_F(MetricsTest, StripedCountersSumAcrossThreads) {
+    Counter counter;
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 12; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 1000; ++i) {
+                counter.add();
+                histogram.record(static_cast<uint64_t>(i));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(counter.value(), 12000u);
+    EXPECT_EQ(histogram.snapshot().count, 12000u);
+}
+
+// Test: Text format with cumulative buckets and one HELP per family
+TEST_F(MetricsTest, PrometheusText) {
+    Histogram histogram;
+    histogram.record(1500);
+    histogram.record(3000);
+    histogram.record(3000);
+
+    PrometheusWriter out;
+    out.histogram("latency_seconds", "Latency", histogram.snapshot(), 1024, 4096, 1e-3,
+                  R"(type="ping")");
+    out.counter("hits_total", "Hits", 5, R"(kind="a")");
+    out.counter("hits_total", "Hits", 7, R"(kind="b")");
+    const std::string& text = out.view();
+
+    EXPECT_NE(text.find("# TYPE latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find(R"(latency_seconds_bucket{type="ping",le="1.024"} 0)"), std::string::npos);
+    EXPECT_NE(text.find(R"(latency_seconds_bucket{type="ping",le="2.048"} 1)"), std::string::npos);
+    EXPECT_NE(text.find(R"(latency_seconds_bucket{type="ping",le="4.096"} 3)"), std::string::npos);
+    EXPECT_NE(text.find(R"(latency_seconds_bucket{type="ping",le="+Inf"} 3)"), std::string::npos);
+    EXPECT_NE(text.find(R"(latency_seconds_count{type="ping"} 3)"), std::string::npos);
+    EXPECT_NE(text.find(R"(hits_total{kind="b"} 7)"), std::string::npos);
+    EXPECT_EQ(text.find("# HELP hits_total"), text.rfind("# HELP hits_total"));
+}
+
+// =============================================================================
+// SCRATCH ARENA TESTS
+// =============================================================================
+
+class ScratchArenaTest : public ::testing::Test {};
+
+// Test: Nested scopes share the arena; only the outermost rewinds it
+TEST_F(ScratchArenaTest, RewindsWhenOutermostScopeCloses) {
+    void* first = nullptr;
+    {
+        ScratchArena::Scope outer;
+        first = outer.resource()->allocate(64);
+        {
+            ScratchArena::Scope inner;
+            void* second = inner.resource()->allocate(64);
+            EXPECT_NE(second, first);
+        }
+        // Inner scope closing must not hand first's memory out again
+        void* third = outer.resource()->allocate(64);
+        EXPECT_NE(third, first);
+    }
+    ScratchArena::Scope again;
+    EXPECT_EQ(again.resource()->allocate(64), first);
+}
+
+// Test: Containers past the fixed block still work
+TEST_F(ScratchArenaTest, GrowsPastBlock) {
+    ScratchArena::Scope scratch;
+    std::pmr::vector<uint64_t> values(scratch.resource());
+    for (uint64_t i = 0; i < ScratchArena::BlockBytes; ++i) {
+        values.push_back(i);
+    }
+    EXPECT_EQ(values.back(), ScratchArena::BlockBytes - 1);
+}
+
+// =============================================================================
+// ID128 TESTS
+// =============================================================================
+
+class Id128Test : public ::testing::Test {};
+
+// Test: A generated UUID parses to its bits and formats back unchanged
+TEST_F(Id128Test, UuidRoundTrip) {
+    for (int i = 0; i < 100; ++i) {
+        std::string uuid = generateUUID();
+        auto id = Id128::parseUuid(uuid);
+        ASSERT_TRUE(id.has_value()) << uuid;
+        EXPECT_EQ(id->toUuid(), uuid);
+        EXPECT_EQ(Id128::fromText(uuid), *id);
+
+        std::string raw;
+        id->appendBytes(raw);
+        ASSERT_EQ(raw.size(), 16);
+        EXPECT_EQ(Id128::fromBytes(raw.data()), *id);
+    }
+
+    auto id = Id128::parseUuid("01234567-89ab-4def-8123-456789abcdef");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(id->hi, 0x0123456789ab4defULL);
+    EXPECT_EQ(id->lo, 0x8123456789abcdefULL);
+}
+
+// Test: Only lowercase canonical UUIDs parse
+TEST_F(Id128Test, RejectsNonCanonical) {
+    EXPECT_FALSE(Id128::parseUuid("01234567-89AB-4DEF-8123-456789ABCDEF").has_value());
+    EXPECT_FALSE(Id128::parseUuid("0123456789ab4def8123456789abcdef").has_value());
+    EXPECT_FALSE(Id128::parseUuid("01234567-89ab-4def-8123-456789abcdeg").has_value());
+    EXPECT_FALSE(Id128::parseUuid("user-01234567-89ab-4def-8123-456789abcdef").has_value());
+    EXPECT_FALSE(Id128::parseUuid("").has_value());
+}
+
+// Test: Other text hashes to distinct keys that never look like a v4 UUID
+TEST_F(Id128Test, HashesOtherText) {
+    std::set<std::pair<uint64_t, uint64_t>> seen;
+    for (int i = 0; i < 10000; ++i) {
+        Id128 id = Id128::fromText("stroke-" + std::to_string(i));
+        EXPECT_EQ((id.hi >> 12) & 0xF, 8u);
+        seen.insert({id.hi, id.lo});
+    }
+    EXPECT_EQ(seen.size(), 10000u);
+
+    std::string userId = generateUserId();
+    EXPECT_EQ(Id128::fromText(userId), Id128::fromText(userId));
+    EXPECT_NE(Id128::fromText(userId), Id128::fromText(userId.substr(5)));
+    EXPECT_NE(Id128::fromText("a"), Id128::fromText("A"));
+}
+
 // =============================================================================
 // MAIN
 // =============================================================================
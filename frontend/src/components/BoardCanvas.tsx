@@ -5,7 +5,7 @@
 
 import { useRef, useEffect, useCallback, useState, memo } from 'react';
 import { useDrawing } from '../hooks/useDrawing';
-import { useStrokes, useActiveStroke, useElements, useActiveElement, useActiveTool, useElementActions, usePenColor, useFontSize, useSelection } from '../store/selectors';
+import { useStrokes, useActiveStroke, useElements, useActiveElement, useActiveTool, useElementActions, usePenColor, useFontSize, useSelection, useSetViewport } from '../store/selectors';
 import { getBoundsForSelection } from '../utils/hitTest';
 import { TextInput } from './TextInput';
 import { 
@@ -46,6 +46,12 @@ function BoardCanvasComponent({ width, height, containerRef }: BoardCanvasProps)
   const activeElement = useActiveElement();
   const activeTool = useActiveTool();
   const { selectedStrokeId, selectedElementId } = useSelection();
+  const setViewport = useSetViewport();
+
+  // The canvas has no pan or zoom, so the board area in view is the canvas
+  useEffect(() => {
+    setViewport({ x: 0, y: 0, width, height });
+  }, [width, height, setViewport]);
   
   const {
     handlePointerDown: baseHandlePointerDown,
@@ -3,7 +3,7 @@
  * Ensures messages are processed in sequence order.
  */
 
-import { BaseMessage } from './protocol';
+import { BaseMessage, isBatchMessage } from './protocol';
 
 export type MessageHandler = (message: BaseMessage) => void;
 
@@ -42,6 +42,15 @@ export class Inbox {
    * Sequence numbers are tracked but gaps don't block processing.
    */
   receive(message: BaseMessage): void {
+    // The server coalesces queued messages into one batch frame;
+    // unpack and process members in the order they were queued.
+    if (isBatchMessage(message)) {
+      for (const member of message.data.messages) {
+        this.receive(member);
+      }
+      return;
+    }
+
     const seq = message.seq;
 
     // Categorize message for logging/tracking
@@ -127,6 +136,7 @@ export class Inbox {
         return 'control';
       
       case 'cursor_move':
+      case 'cursor_batch':
         return 'presence';
       
       case 'stroke_start':
@@ -136,6 +146,10 @@ export class Inbox {
         return 'drawing';
       
       case 'room_state':
+      case 'room_state_begin':
+      case 'room_state_chunk':
+      case 'room_state_end':
+      case 'region_state':
         return 'state';
       
       case 'pong':
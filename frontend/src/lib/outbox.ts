@@ -8,9 +8,11 @@ import {
   createCursorMoveMessage,
   createStrokeAddMessage,
   serializeMessage,
+  encodeBinaryMessage,
+  ClientMessage,
 } from './protocol';
 
-export type SendFunction = (message: string) => boolean;
+export type SendFunction = (message: string | ArrayBuffer) => boolean;
 
 interface ThrottledValue {
   x: number;
@@ -37,6 +39,9 @@ export class Outbox {
   private strokeBatchTimeout: ReturnType<typeof setTimeout> | null = null;
   private strokeBatchIntervalMs = 16; // ~60fps batching
 
+  // Send cursor and point messages as binary frames once negotiated
+  private binaryEnabled = false;
+
   constructor(sendFn: SendFunction, cursorThrottleMs: number = ProtocolConstants.CursorThrottleMs) {
     this.sendFn = sendFn;
     this.cursorThrottleMs = cursorThrottleMs;
@@ -49,6 +54,13 @@ export class Outbox {
     this.sendFn = sendFn;
   }
 
+  /**
+   * Switch cursor and stroke point messages to the binary encoding.
+   */
+  setBinaryEnabled(enabled: boolean): void {
+    this.binaryEnabled = enabled;
+  }
+
   /**
    * Queue a cursor move for throttled sending.
    * Only the latest position is kept; intermediate positions are dropped.
@@ -133,7 +145,7 @@ export class Outbox {
 
   private sendCursorNow(x: number, y: number): void {
     const msg = createCursorMoveMessage(x, y);
-    this.sendFn(serializeMessage(msg));
+    this.sendFn(this.serialize(msg));
     this.lastCursorSend = Date.now();
     this.pendingCursor = null;
   }
@@ -152,7 +164,11 @@ export class Outbox {
   private sendStrokePointsNow(strokeId: string, points: [number, number][]): void {
     if (points.length === 0) return;
     const msg = createStrokeAddMessage(strokeId, points);
-    this.sendFn(serializeMessage(msg));
+    this.sendFn(this.serialize(msg));
+  }
+
+  private serialize<T>(msg: ClientMessage<T>): string | ArrayBuffer {
+    return (this.binaryEnabled && encodeBinaryMessage(msg)) || serializeMessage(msg);
   }
 
   private flushStrokePoints(): void {
@@ -10,21 +10,28 @@
 export const MessageType = {
   // Control messages (reliable, low frequency)
   JoinRoom: 'join_room',
+  Resume: 'resume',
   Welcome: 'welcome',
   UserJoined: 'user_joined',
   UserLeft: 'user_left',
 
   // Presence messages (loss-tolerant, high frequency)
   CursorMove: 'cursor_move',
+  CursorBatch: 'cursor_batch',
 
   // Drawing messages (reliable, event-driven)
   StrokeStart: 'stroke_start',
   StrokeAdd: 'stroke_add',
   StrokeEnd: 'stroke_end',
   StrokeMove: 'stroke_move',
+  Viewport: 'viewport',
 
   // State messages (reliable, on-demand)
   RoomState: 'room_state',
+  RoomStateBegin: 'room_state_begin',
+  RoomStateChunk: 'room_state_chunk',
+  RoomStateEnd: 'room_state_end',
+  RegionState: 'region_state',
 
   // Heartbeat messages (reliable, periodic)
   Ping: 'ping',
@@ -32,6 +39,9 @@ export const MessageType = {
 
   // Error messages
   Error: 'error',
+
+  // Transport messages
+  Batch: 'batch',
 } as const;
 
 export type MessageTypeValue = (typeof MessageType)[keyof typeof MessageType];
@@ -45,6 +55,7 @@ export const ErrorCode = {
   RoomNotFound: 'ROOM_NOT_FOUND',
   RoomFull: 'ROOM_FULL',
   InvalidPassword: 'INVALID_PASSWORD',
+  WrongNode: 'WRONG_NODE', // message is the owning node's WebSocket URL
 
   // Message errors
   MalformedMessage: 'MALFORMED_MESSAGE',
@@ -76,7 +87,7 @@ export type ErrorCodeValue = (typeof ErrorCode)[keyof typeof ErrorCode];
 export const ProtocolConstants = {
   // Room limits
   MaxUsersPerRoom: 15,
-  MaxStrokesPerRoom: 1000,
+  MaxStrokesPerRoom: 10000,
   SnapshotStrokeLimit: 500,
   SnapshotStrokeLimitSmall: 200,
 
@@ -242,6 +253,8 @@ export interface Stroke {
   color: string;
   width: number;
   complete: boolean;
+  /** seq of the stroke's stroke_start, if known; orders region_state inserts */
+  seq?: number;
 }
 
 // =============================================================================
@@ -252,6 +265,30 @@ export interface JoinRoomData {
   roomId: string;
   userName: string;
   password?: string;
+  /** Ask the server to send hot-path messages as binary frames */
+  binary?: boolean;
+  /** Accept the board snapshot as room_state_begin/chunk/end */
+  chunked?: boolean;
+  /** Board area on screen; the server then only sends strokes in it */
+  viewX?: number;
+  viewY?: number;
+  viewWidth?: number;
+  viewHeight?: number;
+}
+
+/**
+ * Rejoin after a disconnect. If the server still has every board event
+ * after lastSeq, it replays them instead of sending a snapshot.
+ */
+export interface ResumeData extends JoinRoomData {
+  /** Our userId from the earlier welcome, reclaimed if still free */
+  userId?: string;
+  /** resumeToken from the earlier welcome; proves userId is ours */
+  resumeToken?: string;
+  /** Room epoch from the earlier welcome */
+  epoch: string;
+  /** Highest board event seq applied */
+  lastSeq: number;
 }
 
 export interface CursorMoveData {
@@ -280,6 +317,14 @@ export interface StrokeMoveData {
   dy: number;
 }
 
+/** The board area on screen, in board coordinates */
+export interface ViewportData {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
 // =============================================================================
 // Message Payloads (Server -> Client)
 // =============================================================================
@@ -288,6 +333,14 @@ export interface WelcomeData {
   userId: string;
   color: string;
   users: UserInfo[];
+  /** Server accepted the binary protocol for this session */
+  binary?: boolean;
+  /** Identifies this run of the room; sent back in resume */
+  epoch?: string;
+  /** Missed events follow instead of a snapshot; keep the board */
+  resumed?: boolean;
+  /** Secret for reclaiming userId in the next resume; changes every welcome */
+  resumeToken?: string;
 }
 
 export interface UserJoinedData {
@@ -306,6 +359,10 @@ export interface ServerCursorMoveData {
   y: number;
 }
 
+export interface ServerCursorBatchData {
+  cursors: ServerCursorMoveData[];
+}
+
 export interface ServerStrokeStartData {
   strokeId: string;
   userId: string;
@@ -331,16 +388,51 @@ export interface ServerStrokeMoveData {
   dy: number;
 }
 
+export interface SnapshotStroke {
+  strokeId: string;
+  userId: string;
+  points: [number, number][];
+  color: string;
+  width: number;
+  complete: boolean;
+  /** seq of the stroke's stroke_start */
+  seq: number;
+}
+
 export interface RoomStateData {
-  strokes: Array<{
-    strokeId: string;
-    userId: string;
-    points: [number, number][];
-    color: string;
-    width: number;
-    complete: boolean;
-  }>;
+  strokes: SnapshotStroke[];
+  snapshotSeq: number;
+}
+
+export interface RoomStateBeginData {
   snapshotSeq: number;
+  /** Total strokes across all chunks */
+  strokes: number;
+  chunks: number;
+}
+
+/**
+ * One slice of a chunked snapshot. Chunk 0 holds the newest strokes and
+ * each later chunk older ones; strokes within a chunk are oldest first.
+ */
+export interface RoomStateChunkData {
+  snapshotSeq: number;
+  index: number;
+  strokes: SnapshotStroke[];
+}
+
+export interface RoomStateEndData {
+  snapshotSeq: number;
+}
+
+/**
+ * Strokes that came into view (after a viewport change, or drawn or moved
+ * into it), whole. They replace any copy held; events on them with a seq
+ * below regionSeq are already included.
+ */
+export interface RegionStateData {
+  regionSeq: number;
+  strokes: SnapshotStroke[];
 }
 
 export interface ErrorData {
@@ -348,6 +440,10 @@ export interface ErrorData {
   message: string;
 }
 
+export interface BatchData {
+  messages: BaseMessage[];
+}
+
 // =============================================================================
 // Message Envelope
 // =============================================================================
@@ -389,6 +485,10 @@ export function isCursorMoveMessage(msg: BaseMessage): msg is ServerMessage<Serv
   return msg.type === MessageType.CursorMove;
 }
 
+export function isCursorBatchMessage(msg: BaseMessage): msg is ServerMessage<ServerCursorBatchData> {
+  return msg.type === MessageType.CursorBatch;
+}
+
 export function isStrokeStartMessage(msg: BaseMessage): msg is ServerMessage<ServerStrokeStartData> {
   return msg.type === MessageType.StrokeStart;
 }
@@ -413,6 +513,10 @@ export function isErrorMessage(msg: BaseMessage): msg is ServerMessage<ErrorData
   return msg.type === MessageType.Error;
 }
 
+export function isBatchMessage(msg: BaseMessage): msg is ServerMessage<BatchData> {
+  return msg.type === MessageType.Batch;
+}
+
 // =============================================================================
 // Message Creators
 // =============================================================================
@@ -427,8 +531,27 @@ export function createClientMessage<T>(type: MessageTypeValue, data: T): ClientM
   };
 }
 
-export function createJoinRoomMessage(roomId: string, userName: string, password?: string): ClientMessage<JoinRoomData> {
-  return createClientMessage(MessageType.JoinRoom, { roomId, userName, password });
+export function createJoinRoomMessage(
+  roomId: string,
+  userName: string,
+  password?: string,
+  binary?: boolean,
+  chunked?: boolean,
+  viewport?: ViewportData | null
+): ClientMessage<JoinRoomData> {
+  return createClientMessage(MessageType.JoinRoom, {
+    roomId, userName, password, binary, chunked, ...viewFields(viewport),
+  });
+}
+
+/** The join/resume fields announcing a viewport */
+export function viewFields(viewport?: ViewportData | null): Partial<JoinRoomData> {
+  if (!viewport) return {};
+  return { viewX: viewport.x, viewY: viewport.y, viewWidth: viewport.width, viewHeight: viewport.height };
+}
+
+export function createResumeMessage(data: ResumeData): ClientMessage<ResumeData> {
+  return createClientMessage(MessageType.Resume, data);
 }
 
 export function createCursorMoveMessage(x: number, y: number): ClientMessage<CursorMoveData> {
@@ -451,6 +574,10 @@ export function createStrokeMoveMessage(strokeId: string, dx: number, dy: number
   return createClientMessage(MessageType.StrokeMove, { strokeId, dx, dy });
 }
 
+export function createViewportMessage(viewport: ViewportData): ClientMessage<ViewportData> {
+  return createClientMessage(MessageType.Viewport, viewport);
+}
+
 export function createPingMessage(): ClientMessage<Record<string, never>> {
   return createClientMessage(MessageType.Ping, {});
 }
@@ -459,7 +586,10 @@ export function createPingMessage(): ClientMessage<Record<string, never>> {
 // Message Parsing
 // =============================================================================
 
-export function parseServerMessage(raw: string): BaseMessage | null {
+export function parseServerMessage(raw: string | ArrayBuffer): BaseMessage | null {
+  if (raw instanceof ArrayBuffer) {
+    return decodeBinaryMessage(raw);
+  }
   try {
     const msg = JSON.parse(raw) as BaseMessage;
     if (typeof msg.type !== 'string' || typeof msg.seq !== 'number') {
@@ -477,3 +607,414 @@ export function serializeMessage<T>(msg: ClientMessage<T>): string {
   return JSON.stringify(msg);
 }
 
+
+// =============================================================================
+// Binary Protocol
+// =============================================================================
+//
+// Negotiated with `binary: true` in join_room. Mirrors
+// backend/src/protocol/binary_codec.hpp:
+//   header := u8 tag, varint seq
+//   str    := varint length, UTF-8 bytes
+//   id     := varint 2n, n UTF-8 bytes
+//           | varint 2n+1, n prefix bytes, 16 UUID bytes
+//   points := varint count, count x (f32 x, f32 y)
+// Ids ending in a lowercase canonical UUID send it as raw bytes.
+// All floats are little-endian float32. Control messages stay JSON.
+
+export const BinaryTag = {
+  CursorMove: 0x01,
+  CursorBatch: 0x02,
+  StrokeStart: 0x03,
+  StrokeAdd: 0x04,
+  StrokeEnd: 0x05,
+  StrokeMove: 0x06,
+  RoomState: 0x07,
+  Batch: 0x08,
+  RoomStateBegin: 0x09,
+  RoomStateChunk: 0x0a,
+  RoomStateEnd: 0x0b,
+  RegionState: 0x0c,
+} as const;
+
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
+const UuidLength = 36;
+const UuidPattern = /[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$/;
+const HexDigits = Array.from({ length: 256 }, (_, i) => i.toString(16).padStart(2, '0'));
+
+class BinaryReader {
+  private view: DataView;
+  private bytes: Uint8Array;
+  private pos = 0;
+
+  constructor(buffer: ArrayBuffer, offset = 0, length = buffer.byteLength - offset) {
+    this.view = new DataView(buffer, offset, length);
+    this.bytes = new Uint8Array(buffer, offset, length);
+  }
+
+  u8(): number {
+    this.require(1);
+    return this.view.getUint8(this.pos++);
+  }
+
+  varint(): number {
+    // Values stay far below 2^53, so plain arithmetic is exact
+    let value = 0;
+    let scale = 1;
+    for (let i = 0; i < 10; i++) {
+      const byte = this.u8();
+      value += (byte & 0x7f) * scale;
+      if ((byte & 0x80) === 0) return value;
+      scale *= 128;
+    }
+    throw new RangeError('Varint too long');
+  }
+
+  f32(): number {
+    this.require(4);
+    const value = this.view.getFloat32(this.pos, true);
+    this.pos += 4;
+    return value;
+  }
+
+  str(): string {
+    const length = this.varint();
+    this.require(length);
+    const value = textDecoder.decode(this.bytes.subarray(this.pos, this.pos + length));
+    this.pos += length;
+    return value;
+  }
+
+  id(): string {
+    const header = this.varint();
+    const length = Math.floor(header / 2);
+    this.require(length);
+    let value = textDecoder.decode(this.bytes.subarray(this.pos, this.pos + length));
+    this.pos += length;
+    if (header % 2 === 1) {
+      this.require(16);
+      for (let i = 0; i < 16; i++) {
+        if (i === 4 || i === 6 || i === 8 || i === 10) value += '-';
+        value += HexDigits[this.bytes[this.pos + i]];
+      }
+      this.pos += 16;
+    }
+    return value;
+  }
+
+  points(): [number, number][] {
+    const count = this.varint();
+    this.require(count * 8);
+    const points: [number, number][] = new Array(count);
+    for (let i = 0; i < count; i++) {
+      points[i] = [this.f32(), this.f32()];
+    }
+    return points;
+  }
+
+  /** Take the next length bytes as a sub-reader over the same buffer. */
+  sub(length: number): BinaryReader {
+    this.require(length);
+    const reader = new BinaryReader(
+      this.bytes.buffer as ArrayBuffer,
+      this.bytes.byteOffset + this.pos,
+      length
+    );
+    this.pos += length;
+    return reader;
+  }
+
+  atEnd(): boolean {
+    return this.pos === this.bytes.length;
+  }
+
+  private require(n: number): void {
+    if (this.pos + n > this.bytes.length) {
+      throw new RangeError('Binary message truncated');
+    }
+  }
+}
+
+class BinaryWriter {
+  private bytes = new Uint8Array(64);
+  private view = new DataView(this.bytes.buffer);
+  private pos = 0;
+
+  u8(value: number): void {
+    this.reserve(1);
+    this.view.setUint8(this.pos++, value);
+  }
+
+  varint(value: number): void {
+    do {
+      let byte = value % 128;
+      value = Math.floor(value / 128);
+      if (value > 0) byte |= 0x80;
+      this.u8(byte);
+    } while (value > 0);
+  }
+
+  f32(value: number): void {
+    this.reserve(4);
+    this.view.setFloat32(this.pos, value, true);
+    this.pos += 4;
+  }
+
+  str(value: string): void {
+    const encoded = textEncoder.encode(value);
+    this.varint(encoded.length);
+    this.raw(encoded);
+  }
+
+  id(value: string): void {
+    if (value.length < UuidLength || !UuidPattern.test(value)) {
+      const encoded = textEncoder.encode(value);
+      this.varint(2 * encoded.length);
+      this.raw(encoded);
+      return;
+    }
+    const prefix = textEncoder.encode(value.slice(0, value.length - UuidLength));
+    this.varint(2 * prefix.length + 1);
+    this.raw(prefix);
+    const hex = value.slice(value.length - UuidLength).replace(/-/g, '');
+    const uuid = new Uint8Array(16);
+    for (let i = 0; i < 16; i++) {
+      uuid[i] = parseInt(hex.slice(2 * i, 2 * i + 2), 16);
+    }
+    this.raw(uuid);
+  }
+
+  points(points: [number, number][]): void {
+    this.varint(points.length);
+    for (const [x, y] of points) {
+      this.f32(x);
+      this.f32(y);
+    }
+  }
+
+  private raw(bytes: Uint8Array): void {
+    this.reserve(bytes.length);
+    this.bytes.set(bytes, this.pos);
+    this.pos += bytes.length;
+  }
+
+  finish(): ArrayBuffer {
+    return this.bytes.buffer.slice(0, this.pos);
+  }
+
+  private reserve(n: number): void {
+    if (this.pos + n <= this.bytes.length) return;
+    let size = this.bytes.length * 2;
+    while (size < this.pos + n) size *= 2;
+    const grown = new Uint8Array(size);
+    grown.set(this.bytes.subarray(0, this.pos));
+    this.bytes = grown;
+    this.view = new DataView(grown.buffer);
+  }
+}
+
+function readSnapshotStrokes(reader: BinaryReader): SnapshotStroke[] {
+  const count = reader.varint();
+  const strokes: SnapshotStroke[] = [];
+  for (let i = 0; i < count; i++) {
+    const strokeId = reader.id();
+    const userId = reader.id();
+    const color = reader.str();
+    const width = reader.f32();
+    const complete = reader.u8() !== 0;
+    const seq = reader.varint();
+    strokes.push({ strokeId, userId, color, width, complete, seq, points: reader.points() });
+  }
+  return strokes;
+}
+
+function decodeBinaryBody(reader: BinaryReader): BaseMessage {
+  const tag = reader.u8();
+  const seq = reader.varint();
+  const message = (type: MessageTypeValue, data: unknown): BaseMessage => ({
+    type,
+    seq,
+    timestamp: Date.now(),
+    data,
+  });
+
+  switch (tag) {
+    case BinaryTag.CursorMove: {
+      const data: ServerCursorMoveData = { userId: reader.id(), x: reader.f32(), y: reader.f32() };
+      return message(MessageType.CursorMove, data);
+    }
+
+    case BinaryTag.CursorBatch: {
+      const count = reader.varint();
+      const cursors: ServerCursorMoveData[] = [];
+      for (let i = 0; i < count; i++) {
+        cursors.push({ userId: reader.id(), x: reader.f32(), y: reader.f32() });
+      }
+      const data: ServerCursorBatchData = { cursors };
+      return message(MessageType.CursorBatch, data);
+    }
+
+    case BinaryTag.StrokeStart: {
+      const data: ServerStrokeStartData = {
+        strokeId: reader.id(),
+        userId: reader.id(),
+        color: reader.str(),
+        width: reader.f32(),
+      };
+      return message(MessageType.StrokeStart, data);
+    }
+
+    case BinaryTag.StrokeAdd: {
+      const data: ServerStrokeAddData = {
+        strokeId: reader.id(),
+        userId: reader.id(),
+        points: reader.points(),
+      };
+      return message(MessageType.StrokeAdd, data);
+    }
+
+    case BinaryTag.StrokeEnd: {
+      const data: ServerStrokeEndData = { strokeId: reader.id(), userId: reader.id() };
+      return message(MessageType.StrokeEnd, data);
+    }
+
+    case BinaryTag.StrokeMove: {
+      const data: ServerStrokeMoveData = {
+        strokeId: reader.id(),
+        userId: reader.id(),
+        dx: reader.f32(),
+        dy: reader.f32(),
+      };
+      return message(MessageType.StrokeMove, data);
+    }
+
+    case BinaryTag.RoomState: {
+      const snapshotSeq = reader.varint();
+      const data: RoomStateData = { snapshotSeq, strokes: readSnapshotStrokes(reader) };
+      return message(MessageType.RoomState, data);
+    }
+
+    case BinaryTag.RoomStateBegin: {
+      const data: RoomStateBeginData = {
+        snapshotSeq: reader.varint(),
+        strokes: reader.varint(),
+        chunks: reader.varint(),
+      };
+      return message(MessageType.RoomStateBegin, data);
+    }
+
+    case BinaryTag.RoomStateChunk: {
+      const snapshotSeq = reader.varint();
+      const index = reader.varint();
+      const data: RoomStateChunkData = { snapshotSeq, index, strokes: readSnapshotStrokes(reader) };
+      return message(MessageType.RoomStateChunk, data);
+    }
+
+    case BinaryTag.RoomStateEnd: {
+      const data: RoomStateEndData = { snapshotSeq: reader.varint() };
+      return message(MessageType.RoomStateEnd, data);
+    }
+
+    case BinaryTag.RegionState: {
+      const regionSeq = reader.varint();
+      const data: RegionStateData = { regionSeq, strokes: readSnapshotStrokes(reader) };
+      return message(MessageType.RegionState, data);
+    }
+
+    case BinaryTag.Batch: {
+      const count = reader.varint();
+      const messages: BaseMessage[] = [];
+      for (let i = 0; i < count; i++) {
+        const member = reader.sub(reader.varint());
+        messages.push(decodeBinaryBody(member));
+        if (!member.atEnd()) throw new RangeError('Trailing bytes in batch member');
+      }
+      const data: BatchData = { messages };
+      return message(MessageType.Batch, data);
+    }
+
+    default:
+      throw new RangeError(`Unknown binary tag ${tag}`);
+  }
+}
+
+/**
+ * Decode a binary server message into the same shape JSON parsing produces.
+ */
+export function decodeBinaryMessage(buffer: ArrayBuffer): BaseMessage | null {
+  try {
+    const reader = new BinaryReader(buffer);
+    const msg = decodeBinaryBody(reader);
+    if (!reader.atEnd()) {
+      throw new RangeError('Trailing bytes in binary message');
+    }
+    return msg;
+  } catch (e) {
+    console.error('Failed to decode binary message:', e);
+    return null;
+  }
+}
+
+/**
+ * Encode a client message in the binary format.
+ * Returns null for types that only have a JSON form (join, viewport, ping).
+ */
+export function encodeBinaryMessage<T>(msg: ClientMessage<T>): ArrayBuffer | null {
+  const w = new BinaryWriter();
+  const data = msg.data as unknown;
+
+  switch (msg.type) {
+    case MessageType.CursorMove: {
+      const d = data as CursorMoveData;
+      w.u8(BinaryTag.CursorMove);
+      w.varint(msg.seq);
+      w.f32(d.x);
+      w.f32(d.y);
+      break;
+    }
+
+    case MessageType.StrokeStart: {
+      const d = data as StrokeStartData;
+      w.u8(BinaryTag.StrokeStart);
+      w.varint(msg.seq);
+      w.id(d.strokeId);
+      w.str(d.color);
+      w.f32(d.width);
+      break;
+    }
+
+    case MessageType.StrokeAdd: {
+      const d = data as StrokeAddData;
+      w.u8(BinaryTag.StrokeAdd);
+      w.varint(msg.seq);
+      w.id(d.strokeId);
+      w.points(d.points);
+      break;
+    }
+
+    case MessageType.StrokeEnd: {
+      const d = data as StrokeEndData;
+      w.u8(BinaryTag.StrokeEnd);
+      w.varint(msg.seq);
+      w.id(d.strokeId);
+      break;
+    }
+
+    case MessageType.StrokeMove: {
+      const d = data as StrokeMoveData;
+      w.u8(BinaryTag.StrokeMove);
+      w.varint(msg.seq);
+      w.id(d.strokeId);
+      w.f32(d.dx);
+      w.f32(d.dy);
+      break;
+    }
+
+    default:
+      return null;
+  }
+
+  return w.finish();
+}
@@ -8,6 +8,9 @@ import {
   parseServerMessage,
   createPingMessage,
   serializeMessage,
+  encodeBinaryMessage,
+  isBatchMessage,
+  MessageType,
   ProtocolConstants,
 } from './protocol';
 
@@ -38,6 +41,7 @@ export class WsClient {
   private events: Partial<WsClientEvents> = {};
   private options: Required<WsClientOptions>;
   private intentionalClose = false;
+  private binaryEnabled = false;
 
   constructor(options: WsClientOptions) {
     this.options = {
@@ -69,6 +73,21 @@ export class WsClient {
     return this.status === 'connected' && this.ws?.readyState === WebSocket.OPEN;
   }
 
+  /**
+   * Send hot-path messages as binary frames.
+   * Enable once the server has accepted a join that requested binary.
+   */
+  setBinaryEnabled(enabled: boolean): void {
+    this.binaryEnabled = enabled;
+  }
+
+  /**
+   * Serialize a message the way this connection sends it.
+   */
+  serialize<T>(message: ClientMessage<T>): string | ArrayBuffer {
+    return (this.binaryEnabled && encodeBinaryMessage(message)) || serializeMessage(message);
+  }
+
   /**
    * Connect to WebSocket server.
    */
@@ -78,10 +97,12 @@ export class WsClient {
     }
 
     this.intentionalClose = false;
+    this.binaryEnabled = false;
     this.setStatus('connecting');
 
     try {
       this.ws = new WebSocket(this.options.url);
+      this.ws.binaryType = 'arraybuffer';
       this.setupEventHandlers();
     } catch (error) {
       console.error('Failed to create WebSocket:', error);
@@ -109,7 +130,7 @@ export class WsClient {
     }
 
     try {
-      const raw = serializeMessage(message);
+      const raw = this.serialize(message);
       this.ws!.send(raw);
       return true;
     } catch (error) {
@@ -119,9 +140,9 @@ export class WsClient {
   }
 
   /**
-   * Send raw string message.
+   * Send an already-serialized message.
    */
-  sendRaw(message: string): boolean {
+  sendRaw(message: string | ArrayBuffer): boolean {
     if (!this.isConnected()) {
       console.warn('Cannot send message: not connected');
       return false;
@@ -165,8 +186,10 @@ export class WsClient {
     this.ws.onmessage = (event) => {
       const message = parseServerMessage(event.data);
       if (message) {
-        // Track pong for heartbeat
-        if (message.type === 'pong') {
+        // Track pong for heartbeat (it may arrive inside a batch)
+        if (message.type === MessageType.Pong ||
+            (isBatchMessage(message) &&
+             message.data.messages.some((m) => m.type === MessageType.Pong))) {
           this.lastPongTime = Date.now();
         }
         this.events.onMessage?.(message);
@@ -21,20 +21,31 @@ import {
   ToolType,
   ToolTypeValue,
   MessageType,
+  ErrorCode,
   WelcomeData,
   UserJoinedData,
   UserLeftData,
   ServerCursorMoveData,
+  ServerCursorBatchData,
   ServerStrokeStartData,
   ServerStrokeAddData,
   ServerStrokeEndData,
   ServerStrokeMoveData,
   RoomStateData,
+  RoomStateBeginData,
+  RoomStateChunkData,
+  RoomStateEndData,
+  RegionStateData,
+  SnapshotStroke,
+  ViewportData,
   ErrorData,
   createJoinRoomMessage,
+  createResumeMessage,
   createStrokeStartMessage,
   createStrokeEndMessage,
   createStrokeMoveMessage,
+  createViewportMessage,
+  viewFields,
   ProtocolConstants,
 } from '../lib/protocol';
 import { WsClient, ConnectionStatus } from '../lib/wsClient';
@@ -63,6 +74,12 @@ export interface RoomState {
   roomId: string | null;
   /** Password used for current join attempt (for persistence on success) */
   lastJoinPassword: string | null;
+  /** Room epoch from the last welcome; lets a reconnect resume */
+  roomEpoch: string | null;
+  /** Token from the last welcome that lets a resume reclaim userId */
+  resumeToken: string | null;
+  /** Highest board event seq applied (snapshot or stroke message) */
+  lastBoardSeq: number;
 
   // Participants
   users: Map<string, UserInfo>;
@@ -72,6 +89,15 @@ export interface RoomState {
   strokes: Stroke[];
   activeStroke: Stroke | null;
   currentStrokeId: string | null;
+  /** Chunked snapshot being received, if any */
+  snapshotLoad: SnapshotLoad | null;
+  /** Board area on screen; the server only sends strokes in (or near) it */
+  viewport: ViewportData | null;
+  /**
+   * Per stroke, the regionSeq of the region_state that last replaced it:
+   * events below it are already in that copy. Mutated in place.
+   */
+  strokeSeqFloors: Map<string, number>;
 
   // Elements - New unified element system
   elements: DrawingElement[];
@@ -96,9 +122,12 @@ export interface RoomState {
   disconnect: () => void;
   handleMessage: (msg: BaseMessage) => void;
   
+  setViewport: (viewport: ViewportData) => void;
+
   // Cursor
   sendCursorMove: (x: number, y: number) => void;
   updateRemoteCursor: (userId: string, x: number, y: number) => void;
+  updateRemoteCursors: (updates: ServerCursorMoveData[]) => void;
   
   // Drawing
   startStroke: (isEraser?: boolean) => void;
@@ -130,10 +159,61 @@ export interface RoomState {
   reset: () => void;
 }
 
+/**
+ * Progress of a chunked snapshot (room_state_begin .. room_state_end).
+ */
+export interface SnapshotLoad {
+  snapshotSeq: number;
+  /** Live events for strokes whose chunk has not arrived yet */
+  deferred: BaseMessage[];
+}
+
 // =============================================================================
 // Helper Functions
 // =============================================================================
 
+function fromSnapshotStroke(s: SnapshotStroke): Stroke {
+  return {
+    strokeId: s.strokeId,
+    userId: s.userId,
+    points: s.points.map(([x, y]) => ({ x, y })),
+    color: s.color,
+    width: s.width,
+    complete: s.complete,
+    seq: s.seq,
+  };
+}
+
+/**
+ * Insert a stroke by seq; strokes without one (ours, still drawing) stay on top.
+ */
+function insertBySeq(strokes: Stroke[], stroke: Stroke): void {
+  const seq = stroke.seq ?? Infinity;
+  const at = strokes.findIndex((s) => (s.seq ?? Infinity) > seq);
+  strokes.splice(at < 0 ? strokes.length : at, 0, stroke);
+}
+
+function isBoardEvent(msg: BaseMessage): boolean {
+  return (
+    msg.type === MessageType.StrokeStart ||
+    msg.type === MessageType.StrokeAdd ||
+    msg.type === MessageType.StrokeEnd ||
+    msg.type === MessageType.StrokeMove
+  );
+}
+
+/**
+ * While a chunked snapshot loads, hold a live event for a stroke that is
+ * not on the board yet; its chunk is still on the way. Returns true if
+ * the event was deferred.
+ */
+function deferUntilLoaded(state: RoomState, msg: BaseMessage, strokeId: string): boolean {
+  const load = state.snapshotLoad;
+  if (!load || state.strokes.some((s) => s.strokeId === strokeId)) return false;
+  load.deferred.push(msg);
+  return true;
+}
+
 /**
  * Generate intermediate points along a line for straight edge rendering.
  */
@@ -270,6 +350,15 @@ function elementToPoints(element: DrawingElement): { x: number; y: number }[] {
   }
 }
 
+// =============================================================================
+// Cluster Redirects
+// =============================================================================
+
+// WRONG_NODE redirects followed since the last welcome; caps the hops if
+// nodes disagree about who owns a room (e.g. mid-deploy)
+const MaxNodeRedirects = 3;
+let nodeRedirects = 0;
+
 // =============================================================================
 // Initial State
 // =============================================================================
@@ -285,11 +374,17 @@ const initialState = {
   userColor: null,
   roomId: null,
   lastJoinPassword: null,
+  roomEpoch: null as string | null,
+  resumeToken: null as string | null,
+  lastBoardSeq: 0,
   users: new Map<string, UserInfo>(),
   cursors: new Map<string, CursorState>(),
   strokes: [] as Stroke[],
   activeStroke: null as Stroke | null,
   currentStrokeId: null as string | null,
+  snapshotLoad: null as SnapshotLoad | null,
+  viewport: null as ViewportData | null,
+  strokeSeqFloors: new Map<string, number>(),
   elements: [] as DrawingElement[],
   activeElement: null as DrawingElement | null,
   currentElementId: null as string | null,
@@ -337,9 +432,20 @@ export const useRoomStore = create<RoomState>()(
       });
 
       wsClient.on('onOpen', () => {
-        // Send join room message
-        const joinMsg = createJoinRoomMessage(roomId, userName, password);
-        wsClient.send(joinMsg);
+        // Request binary frames for strokes/cursors; welcome confirms it.
+        // After a drop, resume from the last board event we applied so the
+        // server can replay what we missed instead of resending the board.
+        // With a viewport, the server only sends the strokes in view.
+        const { roomEpoch, userId, resumeToken, lastBoardSeq, viewport } = get();
+        const msg = roomEpoch
+          ? createResumeMessage({
+              roomId, userName, password, binary: true, chunked: true,
+              userId: userId ?? undefined, resumeToken: resumeToken ?? undefined,
+              epoch: roomEpoch, lastSeq: lastBoardSeq,
+              ...viewFields(viewport),
+            })
+          : createJoinRoomMessage(roomId, userName, password, true, true, viewport);
+        wsClient.send(msg);
       });
 
       wsClient.on('onMessage', (msg) => {
@@ -364,6 +470,9 @@ export const useRoomStore = create<RoomState>()(
         userName,
         lastJoinPassword: password ?? null,
         lastError: null,
+        roomEpoch: null,
+        resumeToken: null,
+        lastBoardSeq: 0,
       });
 
       wsClient.connect();
@@ -387,6 +496,8 @@ export const useRoomStore = create<RoomState>()(
         ...initialState,
         penColor: get().penColor,
         penWidth: get().penWidth,
+        viewport: get().viewport,
+        strokeSeqFloors: new Map(),
       });
     },
 
@@ -412,9 +523,25 @@ export const useRoomStore = create<RoomState>()(
     handleMessage: (msg: BaseMessage) => {
       const state = get();
 
+      // Track how far the board is applied, for resume
+      if (isBoardEvent(msg) && msg.seq > state.lastBoardSeq) {
+        set({ lastBoardSeq: msg.seq });
+      }
+
+      // Drop events a region_state copy of the stroke already includes
+      if (isBoardEvent(msg) && state.strokeSeqFloors.size > 0) {
+        const strokeId = (msg.data as { strokeId: string }).strokeId;
+        const floor = state.strokeSeqFloors.get(strokeId);
+        if (floor !== undefined) {
+          if (msg.seq < floor) return;
+          state.strokeSeqFloors.delete(strokeId);
+        }
+      }
+
       switch (msg.type) {
         case MessageType.Welcome: {
           const data = msg.data as WelcomeData;
+          nodeRedirects = 0;
           const usersMap = new Map<string, UserInfo>();
           
           for (const user of data.users) {
@@ -432,11 +559,18 @@ export const useRoomStore = create<RoomState>()(
             );
           }
 
+          // Once the server accepts binary, our hot-path messages use it too
+          const binary = data.binary === true;
+          state.wsClient?.setBinaryEnabled(binary);
+          state.outbox?.setBinaryEnabled(binary);
+
           set({
             userId: data.userId,
             userColor: data.color,
             users: usersMap,
             lastError: null,
+            roomEpoch: data.epoch ?? null,
+            resumeToken: data.resumeToken ?? null,
           });
           break;
         }
@@ -472,6 +606,16 @@ export const useRoomStore = create<RoomState>()(
           break;
         }
 
+        case MessageType.CursorBatch: {
+          const data = msg.data as ServerCursorBatchData;
+          // The batch goes to every participant, including ourselves
+          const remote = data.cursors.filter((c) => c.userId !== state.userId);
+          if (remote.length > 0) {
+            state.updateRemoteCursors(remote);
+          }
+          break;
+        }
+
         case MessageType.StrokeStart: {
           const data = msg.data as ServerStrokeStartData;
           // Don't add our own strokes from server
@@ -510,6 +654,7 @@ export const useRoomStore = create<RoomState>()(
             color: data.color,
             width: data.width,
             complete: false,
+            seq: msg.seq,
           };
           
           set({ strokes: [...state.strokes, newStroke] });
@@ -522,6 +667,7 @@ export const useRoomStore = create<RoomState>()(
           if (data.userId === state.userId) break;
           // Skip text strokes (they're handled in StrokeStart)
           if (data.strokeId.startsWith('txt:')) break;
+          if (deferUntilLoaded(state, msg, data.strokeId)) break;
 
           const strokes = state.strokes.map((stroke) => {
             if (stroke.strokeId === data.strokeId) {
@@ -544,6 +690,7 @@ export const useRoomStore = create<RoomState>()(
           if (data.userId === state.userId) break;
           // Skip text strokes (they're already complete from StrokeStart)
           if (data.strokeId.startsWith('txt:')) break;
+          if (deferUntilLoaded(state, msg, data.strokeId)) break;
           
           const strokes = state.strokes.map((stroke) => {
             if (stroke.strokeId === data.strokeId) {
@@ -560,6 +707,7 @@ export const useRoomStore = create<RoomState>()(
           const data = msg.data as ServerStrokeMoveData;
           // Don't process our own stroke_move - we already applied locally
           if (data.userId === state.userId) break;
+          if (deferUntilLoaded(state, msg, data.strokeId)) break;
 
           const strokes = state.strokes.map((s) => {
             if (s.strokeId !== data.strokeId) return s;
@@ -574,22 +722,88 @@ export const useRoomStore = create<RoomState>()(
 
         case MessageType.RoomState: {
           const data = msg.data as RoomStateData;
-          
-          const strokes: Stroke[] = data.strokes.map((s) => ({
-            strokeId: s.strokeId,
-            userId: s.userId,
-            points: s.points.map(([x, y]) => ({ x, y })),
-            color: s.color,
-            width: s.width,
-            complete: s.complete,
-          }));
-          
+          state.strokeSeqFloors.clear();
+          set({
+            strokes: data.strokes.map(fromSnapshotStroke),
+            snapshotLoad: null,
+            lastBoardSeq: data.snapshotSeq - 1,
+          });
+          break;
+        }
+
+        case MessageType.RoomStateBegin: {
+          const data = msg.data as RoomStateBeginData;
+          state.strokeSeqFloors.clear();
+          set({
+            strokes: [],
+            snapshotLoad: { snapshotSeq: data.snapshotSeq, deferred: [] },
+            lastBoardSeq: data.snapshotSeq - 1,
+          });
+          break;
+        }
+
+        case MessageType.RoomStateChunk: {
+          const data = msg.data as RoomStateChunkData;
+          const load = state.snapshotLoad;
+          if (!load || load.snapshotSeq !== data.snapshotSeq) break;
+
+          // Chunks arrive newest first, so each one goes beneath what is drawn
+          const chunk = data.strokes.map(fromSnapshotStroke);
+          set({ strokes: [...chunk, ...state.strokes] });
+
+          // Replay live events that were waiting for these strokes
+          const ids = new Set(chunk.map((s) => s.strokeId));
+          const ready = load.deferred.filter((m) => ids.has((m.data as { strokeId: string }).strokeId));
+          if (ready.length > 0) {
+            load.deferred = load.deferred.filter((m) => !ready.includes(m));
+            for (const m of ready) {
+              get().handleMessage(m);
+            }
+          }
+          break;
+        }
+
+        case MessageType.RoomStateEnd: {
+          const data = msg.data as RoomStateEndData;
+          // Anything still deferred refers to a stroke no longer on the board
+          if (state.snapshotLoad?.snapshotSeq === data.snapshotSeq) {
+            set({ snapshotLoad: null });
+          }
+          break;
+        }
+
+        case MessageType.RegionState: {
+          const data = msg.data as RegionStateData;
+          // Replace the copies we hold and slot new strokes in by seq. Our
+          // stroke in progress stays as drawn locally.
+          const incoming = new Map(data.strokes.map((s) => [s.strokeId, s]));
+          incoming.delete(state.currentStrokeId ?? '');
+          const strokes = state.strokes.map((s) => {
+            const fresh = incoming.get(s.strokeId);
+            if (!fresh) return s;
+            incoming.delete(s.strokeId);
+            return fromSnapshotStroke(fresh);
+          });
+          for (const s of incoming.values()) {
+            insertBySeq(strokes, fromSnapshotStroke(s));
+          }
+          for (const s of data.strokes) {
+            state.strokeSeqFloors.set(s.strokeId, data.regionSeq);
+          }
           set({ strokes });
           break;
         }
 
         case MessageType.Error: {
           const data = msg.data as ErrorData;
+          // Clustered server: another node owns this room, join it there
+          if (data.code === ErrorCode.WrongNode && state.roomId && state.userName &&
+              nodeRedirects < MaxNodeRedirects) {
+            nodeRedirects++;
+            get().connect(data.message, state.roomId, state.userName,
+                          state.lastJoinPassword ?? undefined);
+            break;
+          }
           console.error('[RoomStore] Server error:', data.code, data.message);
           set({ lastError: data.message });
           break;
@@ -604,6 +818,18 @@ export const useRoomStore = create<RoomState>()(
       }
     },
 
+    setViewport: (viewport: ViewportData) => {
+      const { wsClient, connectionStatus, viewport: current } = get();
+      if (current && current.x === viewport.x && current.y === viewport.y &&
+          current.width === viewport.width && current.height === viewport.height) {
+        return;
+      }
+      set({ viewport });
+      if (wsClient && connectionStatus === 'connected') {
+        wsClient.send(createViewportMessage(viewport));
+      }
+    },
+
     // =========================================================================
     // Cursor
     // =========================================================================
@@ -616,24 +842,31 @@ export const useRoomStore = create<RoomState>()(
     },
 
     updateRemoteCursor: (userId: string, x: number, y: number) => {
+      get().updateRemoteCursors([{ userId, x, y }]);
+    },
+
+    updateRemoteCursors: (updates: ServerCursorMoveData[]) => {
       const state = get();
-      const user = state.users.get(userId);
       const now = Date.now();
-      
+
+      // One store update per tick, however many cursors moved
       const cursors = new Map(state.cursors);
-      const existing = cursors.get(userId);
-      
-      cursors.set(userId, {
-        userId,
-        x,
-        y,
-        displayX: existing?.displayX ?? x,
-        displayY: existing?.displayY ?? y,
-        lastUpdate: now,
-        userName: user?.name ?? 'Unknown',
-        color: user?.color ?? '#888888',
-      });
-      
+      for (const { userId, x, y } of updates) {
+        const user = state.users.get(userId);
+        const existing = cursors.get(userId);
+
+        cursors.set(userId, {
+          userId,
+          x,
+          y,
+          displayX: existing?.displayX ?? x,
+          displayY: existing?.displayY ?? y,
+          lastUpdate: now,
+          userName: user?.name ?? 'Unknown',
+          color: user?.color ?? '#888888',
+        });
+      }
+
       set({ cursors });
     },
 
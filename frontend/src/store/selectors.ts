@@ -228,6 +228,10 @@ export function useSetPenWidth() {
   return useRoomStore((state) => state.setPenWidth);
 }
 
+export function useSetViewport() {
+  return useRoomStore((state) => state.setViewport);
+}
+
 // =============================================================================
 // Combined Selectors
 // =============================================================================
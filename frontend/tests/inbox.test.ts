@@ -0,0 +1,67 @@
+/**
+ * Unit tests for inbox message routing.
+ */
+
+import { describe, it, expect, vi } from 'vitest';
+import { Inbox } from '../src/lib/inbox';
+import { BaseMessage } from '../src/lib/protocol';
+
+function message(type: string, seq: number, data: unknown = {}): BaseMessage {
+  return { type, seq, timestamp: 0, data } as BaseMessage;
+}
+
+describe('Inbox batch unpacking', () => {
+  it('should deliver batch members in order', () => {
+    const handler = vi.fn();
+    const inbox = new Inbox(handler);
+
+    inbox.receive(message('batch', 0, {
+      messages: [
+        message('stroke_start', 3),
+        message('stroke_add', 4),
+        message('user_joined', 5),
+      ],
+    }));
+
+    expect(handler).toHaveBeenCalledTimes(3);
+    expect(handler.mock.calls.map(([m]) => m.type)).toEqual([
+      'stroke_start',
+      'stroke_add',
+      'user_joined',
+    ]);
+  });
+
+  it('should not deliver the batch envelope itself', () => {
+    const handler = vi.fn();
+    const inbox = new Inbox(handler);
+
+    inbox.receive(message('batch', 0, { messages: [] }));
+
+    expect(handler).not.toHaveBeenCalled();
+  });
+
+  it('should still drop stale cursor moves inside a batch', () => {
+    const handler = vi.fn();
+    const inbox = new Inbox(handler);
+
+    inbox.receive(message('cursor_move', 10));
+    inbox.receive(message('batch', 0, {
+      messages: [message('cursor_move', 9), message('cursor_move', 11)],
+    }));
+
+    expect(handler.mock.calls.map(([m]) => m.seq)).toEqual([10, 11]);
+  });
+});
+
+describe('Inbox cursor batches', () => {
+  it('should treat cursor_batch as presence and drop stale ticks', () => {
+    const handler = vi.fn();
+    const inbox = new Inbox(handler);
+
+    inbox.receive(message('cursor_batch', 20, { cursors: [] }));
+    inbox.receive(message('cursor_batch', 18, { cursors: [] }));
+    inbox.receive(message('cursor_batch', 21, { cursors: [] }));
+
+    expect(handler.mock.calls.map(([m]) => m.seq)).toEqual([20, 21]);
+  });
+});
@@ -0,0 +1,128 @@
+/**
+ * Unit tests for the binary wire protocol.
+ */
+
+import { describe, it, expect } from 'vitest';
+import {
+  BinaryTag,
+  decodeBinaryMessage,
+  encodeBinaryMessage,
+  createCursorMoveMessage,
+  createStrokeAddMessage,
+  createPingMessage,
+  parseServerMessage,
+  ServerStrokeAddData,
+  BatchData,
+} from '../src/lib/protocol';
+
+/** Build a binary message the way the server does. */
+function build(write: (b: number[]) => void): ArrayBuffer {
+  const bytes: number[] = [];
+  write(bytes);
+  return new Uint8Array(bytes).buffer;
+}
+
+function varint(b: number[], value: number): void {
+  do {
+    let byte = value % 128;
+    value = Math.floor(value / 128);
+    if (value > 0) byte |= 0x80;
+    b.push(byte);
+  } while (value > 0);
+}
+
+function str(b: number[], value: string): void {
+  const encoded = new TextEncoder().encode(value);
+  varint(b, encoded.length);
+  b.push(...encoded);
+}
+
+function f32(b: number[], value: number): void {
+  const view = new DataView(new ArrayBuffer(4));
+  view.setFloat32(0, value, true);
+  b.push(...new Uint8Array(view.buffer));
+}
+
+describe('Binary protocol decoding', () => {
+  it('should decode stroke_add into the JSON message shape', () => {
+    const buffer = build((b) => {
+      b.push(BinaryTag.StrokeAdd);
+      varint(b, 300);
+      str(b, 'stroke-1');
+      str(b, 'user-1');
+      varint(b, 2);
+      f32(b, 1.5); f32(b, 2.5);
+      f32(b, 3); f32(b, 4);
+    });
+
+    const msg = parseServerMessage(buffer);
+    expect(msg?.type).toBe('stroke_add');
+    expect(msg?.seq).toBe(300);
+    const data = msg?.data as ServerStrokeAddData;
+    expect(data.strokeId).toBe('stroke-1');
+    expect(data.userId).toBe('user-1');
+    expect(data.points).toEqual([[1.5, 2.5], [3, 4]]);
+  });
+
+  it('should unpack binary batches', () => {
+    const member = (seq: number) => build((b) => {
+      b.push(BinaryTag.StrokeEnd);
+      varint(b, seq);
+      str(b, `stroke-${seq}`);
+      str(b, 'user-1');
+    });
+    const members = [member(1), member(2)].map((m) => Array.from(new Uint8Array(m)));
+
+    const buffer = build((b) => {
+      b.push(BinaryTag.Batch);
+      varint(b, 0);
+      varint(b, members.length);
+      for (const m of members) {
+        varint(b, m.length);
+        b.push(...m);
+      }
+    });
+
+    const msg = decodeBinaryMessage(buffer);
+    expect(msg?.type).toBe('batch');
+    const data = msg?.data as BatchData;
+    expect(data.messages.map((m) => m.seq)).toEqual([1, 2]);
+    expect(data.messages[1].type).toBe('stroke_end');
+  });
+
+  it('should reject truncated messages', () => {
+    const buffer = build((b) => {
+      b.push(BinaryTag.CursorMove);
+      varint(b, 1);
+      str(b, 'user-1');
+      f32(b, 1);
+    });
+    expect(decodeBinaryMessage(buffer)).toBeNull();
+  });
+});
+
+describe('Binary protocol encoding', () => {
+  it('should encode cursor_move as tag, seq, x, y', () => {
+    const msg = createCursorMoveMessage(10, 20);
+    const buffer = encodeBinaryMessage(msg)!;
+    const view = new DataView(buffer);
+
+    expect(view.getUint8(0)).toBe(BinaryTag.CursorMove);
+    // seq < 128 fits in one varint byte
+    expect(buffer.byteLength).toBe(1 + 1 + 8);
+    expect(view.getFloat32(2, true)).toBe(10);
+    expect(view.getFloat32(6, true)).toBe(20);
+  });
+
+  it('should pack stroke points as float32 pairs', () => {
+    const points: [number, number][] = Array.from({ length: 50 }, (_, i) => [i + 0.5, i + 0.25]);
+    const msg = createStrokeAddMessage('stroke-1', points);
+    const buffer = encodeBinaryMessage(msg)!;
+
+    expect(buffer.byteLength).toBeLessThan(JSON.stringify(msg).length / 2);
+  });
+
+  it('should leave control messages as JSON', () => {
+    expect(encodeBinaryMessage(createPingMessage())).toBeNull();
+  });
+});
@@ -174,6 +174,62 @@ describe('RoomStore', () => {
       expect(newState.strokes[0]?.points).toHaveLength(2);
     });
 
+    it('should render a chunked snapshot progressively', () => {
+      const state = useRoomStore.getState();
+      const stroke = (strokeId: string) => ({
+        strokeId,
+        userId: 'user-123',
+        points: [[10, 20]] as [number, number][],
+        color: '#000000',
+        width: 2,
+        complete: false,
+      });
+      const send = (type: string, data: unknown, seq = 100) =>
+        state.handleMessage({ type, seq, timestamp: Date.now(), data } as never);
+
+      send(MessageType.RoomStateBegin, { snapshotSeq: 100, strokes: 3, chunks: 2 });
+      send(MessageType.RoomStateChunk, { snapshotSeq: 100, index: 0, strokes: [stroke('s2'), stroke('s3')] });
+      expect(useRoomStore.getState().strokes.map((s) => s.strokeId)).toEqual(['s2', 's3']);
+
+      // A live event for a stroke in a later chunk waits for that chunk
+      send(MessageType.StrokeAdd, { strokeId: 's1', userId: 'user-123', points: [[30, 40]] }, 101);
+      expect(useRoomStore.getState().strokes).toHaveLength(2);
+
+      send(MessageType.RoomStateChunk, { snapshotSeq: 100, index: 1, strokes: [stroke('s1')] });
+      const strokes = useRoomStore.getState().strokes;
+      expect(strokes.map((s) => s.strokeId)).toEqual(['s1', 's2', 's3']);
+      expect(strokes[0]?.points).toHaveLength(2);
+
+      send(MessageType.RoomStateEnd, { snapshotSeq: 100 });
+      expect(useRoomStore.getState().snapshotLoad).toBeNull();
+    });
+
+    it('should track the board seq and room epoch for resume', () => {
+      const state = useRoomStore.getState();
+      state.handleMessage({
+        type: MessageType.Welcome,
+        seq: 1,
+        timestamp: Date.now(),
+        data: { userId: 'me', color: '#000000', users: [], epoch: 'e1' },
+      });
+      state.handleMessage({
+        type: MessageType.RoomState,
+        seq: 10,
+        timestamp: Date.now(),
+        data: { strokes: [], snapshotSeq: 10 },
+      });
+      expect(useRoomStore.getState().roomEpoch).toBe('e1');
+      expect(useRoomStore.getState().lastBoardSeq).toBe(9);
+
+      state.handleMessage({
+        type: MessageType.StrokeStart,
+        seq: 12,
+        timestamp: Date.now(),
+        data: { strokeId: 's1', userId: 'other', color: '#000000', width: 2 },
+      });
+      expect(useRoomStore.getState().lastBoardSeq).toBe(12);
+    });
+
     it('should handle error message', () => {
       const state = useRoomStore.getState();
 